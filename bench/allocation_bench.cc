@@ -0,0 +1,146 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/segment.h"
+#include "moderndbs/slotted_page.h"
+
+using BufferManager = moderndbs::BufferManager;
+using FSISegment = moderndbs::FSISegment;
+using SPSegment = moderndbs::SPSegment;
+using SchemaSegment = moderndbs::SchemaSegment;
+using SlottedPage = moderndbs::SlottedPage;
+using TID = moderndbs::TID;
+
+namespace {
+
+/// The number of heap allocations while they are counted
+std::atomic<uint64_t> allocations{0};
+/// Are the heap allocations counted? Only the benchmarks of this file count them, the others do not pay for it.
+std::atomic<bool> counting{false};
+
+/// Allocate memory from the heap for the replaced operator new.
+void *allocate(size_t size) {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (auto memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+/// Start to count the heap allocations.
+/// Returns the number of allocations that were counted before.
+uint64_t start_counting() {
+    counting.store(true);
+    return allocations.load();
+}
+
+/// Stop counting and report the heap allocations per iteration of a benchmark, the hot paths should not allocate.
+void count_allocations(benchmark::State &state, uint64_t before) {
+    counting.store(false);
+    state.counters["allocations"] = benchmark::Counter(static_cast<double>(allocations.load() - before),
+                                                       benchmark::Counter::kAvgIterations);
+}
+
+/// Resize records back and forth, so that pages are compacted and records move to other pages and back.
+void BM_SPSegmentResize(benchmark::State &state) {
+    constexpr uint32_t kPageSize = 1024;
+    for (auto segment_id : { 940, 941, 942 }) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(kPageSize, 1024);
+    SchemaSegment schema_segment(940, buffer_manager);
+    schema_segment.set_schema(std::make_unique<moderndbs::schema::Schema>(std::vector<moderndbs::schema::Table>{}));
+    FSISegment fsi_segment(941, buffer_manager, schema_segment);
+    SPSegment sp_segment(942, buffer_manager, schema_segment, fsi_segment);
+
+    std::vector<TID> tids;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        tids.push_back(sp_segment.allocate(60));
+    }
+    std::vector<uint32_t> sizes;
+    std::mt19937 engine{0};
+    for (uint32_t i = 0; i < 4096; ++i) {
+        sizes.push_back(20 + engine() % 400);
+    }
+    /// one round to let the segment reach its size and the threads' buffers grow
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        sp_segment.resize(tids[i % tids.size()], sizes[i]);
+    }
+
+    size_t i = 0;
+    uint64_t before = start_counting();
+    for (auto _ : state) {
+        sp_segment.resize(tids[i % tids.size()], sizes[i % sizes.size()]);
+        ++i;
+    }
+    count_allocations(state, before);
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// Grow records on a fragmented page, which compacts it.
+void BM_SlottedPageCompactify(benchmark::State &state) {
+    constexpr uint32_t kPageSize = 4096;
+    std::vector<char> buffer(kPageSize);
+    auto page = new(buffer.data()) SlottedPage(kPageSize);
+    std::vector<uint16_t> slots;
+    while (page->get_required_space(48) <= page->header.free_space) {
+        slots.push_back(page->allocate(48, kPageSize));
+    }
+    /// every other record shrinks, which leaves fragmented free space
+    for (size_t i = 0; i < slots.size(); i += 2) {
+        page->relocate(slots[i], 16, kPageSize);
+    }
+    page->compactify(kPageSize);
+
+    size_t i = 1;
+    uint64_t before = start_counting();
+    for (auto _ : state) {
+        /// shrinking and growing a record again forces a compaction once the fragmented space is used up
+        page->relocate(slots[i], 16, kPageSize);
+        page->relocate(slots[i], 48, kPageSize);
+        i = (i + 2) % slots.size();
+    }
+    count_allocations(state, before);
+    state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+/// The allocation functions of the binary are replaced, so that the allocations can be counted
+/// (the nothrow versions call them, the aligned ones are left alone and stay uncounted)
+void *operator new(size_t size) {
+    return allocate(size);
+}
+
+void *operator new[](size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+    std::free(memory);
+}
+
+BENCHMARK(BM_SPSegmentResize);
+BENCHMARK(BM_SlottedPageCompactify);
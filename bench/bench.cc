@@ -0,0 +1,7 @@
+// ---------------------------------------------------------------------------
+// MODERNDBS
+// ---------------------------------------------------------------------------
+#include <benchmark/benchmark.h>
+// ---------------------------------------------------------------------------
+BENCHMARK_MAIN();
+// ---------------------------------------------------------------------------
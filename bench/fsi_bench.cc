@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/segment.h"
+
+using BufferManager = moderndbs::BufferManager;
+using FSISegment = moderndbs::FSISegment;
+using SPSegment = moderndbs::SPSegment;
+using SchemaSegment = moderndbs::SchemaSegment;
+using TID = moderndbs::TID;
+
+namespace {
+
+constexpr uint32_t kPageSize = 4096;
+constexpr uint32_t kRecords = 20000;
+
+/// Draw a record size: small records, a log-normal mix or large records.
+uint32_t get_record_size(int64_t distribution, std::mt19937_64 &rng) {
+    switch (distribution) {
+        case 0:
+            return std::uniform_int_distribution<uint32_t>(20, 200)(rng);
+        case 1:
+            return static_cast<uint32_t>(std::clamp(std::lognormal_distribution<double>(5.0, 1.0)(rng), 8.0, 2000.0));
+        default:
+            return std::uniform_int_distribution<uint32_t>(500, 2000)(rng);
+    }
+}
+
+/// Replay inserts and deletes (every 4th insert deletes a random record) and report
+/// the number of pages and the fill factor for an encoding and a fit policy.
+void BM_FSIFragmentation(benchmark::State &state) {
+    auto encoding = static_cast<FSISegment::Encoding>(state.range(0));
+    auto policy = static_cast<FSISegment::FitPolicy>(state.range(1));
+    uint64_t pages = 0;
+    uint64_t live_bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto buffer_manager = std::make_unique<BufferManager>(kPageSize, 8192);
+        SchemaSegment schema_segment(910, *buffer_manager);
+        schema_segment.set_schema(std::make_unique<moderndbs::schema::Schema>(std::vector<moderndbs::schema::Table>{}));
+        FSISegment fsi_segment(911, *buffer_manager, schema_segment, policy, encoding);
+        SPSegment sp_segment(912, *buffer_manager, schema_segment, fsi_segment);
+        std::mt19937_64 rng(42);
+        std::vector<std::pair<TID, uint32_t>> records;
+        live_bytes = 0;
+        state.ResumeTiming();
+
+        for (uint32_t i = 0; i < kRecords; ++i) {
+            auto size = get_record_size(state.range(2), rng);
+            records.emplace_back(sp_segment.allocate(size), size);
+            live_bytes += size;
+            if (i % 4 == 3) {
+                auto victim = std::uniform_int_distribution<size_t>(0, records.size() - 1)(rng);
+                sp_segment.erase(records[victim].first);
+                live_bytes -= records[victim].second;
+                records[victim] = records.back();
+                records.pop_back();
+            }
+        }
+
+        state.PauseTiming();
+        pages = schema_segment.get_sp_count();
+        buffer_manager.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * kRecords);
+    state.counters["pages"] = static_cast<double>(pages);
+    state.counters["fill"] = static_cast<double>(live_bytes) / static_cast<double>(pages * kPageSize);
+}
+
+void FragmentationArguments(benchmark::internal::Benchmark *benchmark) {
+    for (int64_t encoding : { FSISegment::kLinear, FSISegment::kLogarithmic }) {
+        for (int64_t policy : { FSISegment::kFirstFit, FSISegment::kBestFit, FSISegment::kNextFit }) {
+            for (int64_t distribution = 0; distribution < 3; ++distribution) {
+                benchmark->Args({ encoding, policy, distribution });
+            }
+        }
+    }
+}
+
+/// Open the free-space inventory of an empty table with small pages and track its first page, as every table
+/// of a schema does.
+void BM_FSIOpen(benchmark::State &state) {
+    BufferManager buffer_manager(1024, 16);
+    SchemaSegment schema_segment(913, buffer_manager);
+    schema_segment.set_schema(std::make_unique<moderndbs::schema::Schema>(std::vector<moderndbs::schema::Table>{}));
+    for (auto _ : state) {
+        FSISegment fsi_segment(914, buffer_manager, schema_segment);
+        fsi_segment.update(0, 512);
+    }
+    buffer_manager.truncate(914, 0);
+}
+
+}  // namespace
+
+BENCHMARK(BM_FSIOpen);
+BENCHMARK(BM_FSIFragmentation)->ArgNames({ "encoding", "policy", "sizes" })->Apply(FragmentationArguments)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "moderndbs/btree.h"
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/hash_index.h"
+#include "moderndbs/predicate.h"
+#include "moderndbs/record.h"
+#include "moderndbs/segment.h"
+
+using BufferManager = moderndbs::BufferManager;
+using FSISegment = moderndbs::FSISegment;
+using Predicate = moderndbs::Predicate;
+using SchemaSegment = moderndbs::SchemaSegment;
+using SPSegment = moderndbs::SPSegment;
+using TID = moderndbs::TID;
+
+namespace schema = moderndbs::schema;
+
+namespace {
+
+constexpr uint32_t kPageSize = 4096;
+
+using Key = moderndbs::IndexKey<8>;
+using BTree = moderndbs::BTree<Key, TID, std::less<Key>, kPageSize>;
+using HashIndex = moderndbs::HashIndex<Key, TID, Key::Hash, kPageSize>;
+
+/// A table of `state.range(0)` records with a primary key, indexed by a B+-tree and a hash index.
+/// Every benchmark looks up the records by key in random order.
+struct IndexedTable {
+    BufferManager buffer_manager{kPageSize, 1 << 15};
+    std::unique_ptr<SchemaSegment> schema_segment;
+    std::unique_ptr<FSISegment> fsi_segment;
+    std::unique_ptr<SPSegment> sp_segment;
+    std::unique_ptr<BTree> btree;
+    std::unique_ptr<HashIndex> hash_index;
+    /// The keys in random order
+    std::vector<int64_t> keys;
+    /// The TIDs of the records in random order
+    std::vector<TID> tids;
+
+    explicit IndexedTable(uint64_t record_count) {
+        for (auto segment_id : { 930, 931, 932, 933, 934 }) {
+            std::remove(std::to_string(segment_id).c_str());
+        }
+        schema_segment = std::make_unique<SchemaSegment>(930, buffer_manager);
+        schema_segment->set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{
+            schema::Table("orders", std::vector<schema::Column>{
+                schema::Column("o_id", schema::Type::Integer()),
+                schema::Column("o_total", schema::Type::Numeric(12, 2)),
+                schema::Column("o_comment", schema::Type::Varchar(40)),
+            }, std::vector<std::string>{ "o_id" }),
+        }));
+        const auto &table = schema_segment->get_schema()->tables[0];
+        fsi_segment = std::make_unique<FSISegment>(931, buffer_manager, *schema_segment, FSISegment::kNextFit,
+                                                   FSISegment::kLinear, &table);
+        sp_segment = std::make_unique<SPSegment>(932, buffer_manager, *schema_segment, *fsi_segment, &table);
+        btree = std::make_unique<BTree>(933, buffer_manager);
+        hash_index = std::make_unique<HashIndex>(934, buffer_manager);
+
+        const auto &codec = *sp_segment->get_codec();
+        for (uint64_t i = 0; i < record_count; ++i) {
+            keys.push_back(static_cast<int64_t>(i));
+        }
+        std::shuffle(keys.begin(), keys.end(), std::mt19937_64{0});
+        for (auto key : keys) {
+            auto record = codec.encode({ key, key * 100, std::string("a comment of some length") });
+            auto tid = sp_segment->allocate(record.size());
+            sp_segment->write(tid, record.data(), record.size());
+            tids.push_back(tid);
+            auto encoded_key = get_key(key);
+            btree->insert(encoded_key, tid);
+            hash_index->insert(encoded_key, tid);
+        }
+        std::shuffle(keys.begin(), keys.end(), std::mt19937_64{1});
+        std::shuffle(tids.begin(), tids.end(), std::mt19937_64{2});
+    }
+
+    /// Encode a primary key.
+    Key get_key(int64_t key) const {
+        Key encoded_key;
+        sp_segment->get_codec()->encode_key({ key }, encoded_key.bytes.data());
+        return encoded_key;
+    }
+};
+
+/// Find a record by scanning the table with an equality predicate.
+void BM_IndexLookupScan(benchmark::State &state) {
+    IndexedTable table(static_cast<uint64_t>(state.range(0)));
+    size_t i = 0;
+    for (auto _ : state) {
+        auto tids = table.sp_segment->scan({ Predicate::Compare(0, Predicate::kEqual, table.keys[i]) });
+        benchmark::DoNotOptimize(tids);
+        i = (i + 1) % table.keys.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// Find a record with the B+-tree.
+void BM_IndexLookupBTree(benchmark::State &state) {
+    IndexedTable table(static_cast<uint64_t>(state.range(0)));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.btree->lookup(table.get_key(table.keys[i])));
+        i = (i + 1) % table.keys.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// Find a record with the hash index.
+void BM_IndexLookupHash(benchmark::State &state) {
+    IndexedTable table(static_cast<uint64_t>(state.range(0)));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.hash_index->lookup(table.get_key(table.keys[i])));
+        i = (i + 1) % table.keys.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// The number of TIDs that an index probe produces
+constexpr size_t kProbeSize = 1024;
+
+/// Read the records of a probe one at a time.
+void BM_ProbeRead(benchmark::State &state) {
+    IndexedTable table(static_cast<uint64_t>(state.range(0)));
+    std::vector<std::byte> records(kProbeSize * 64);
+    size_t begin = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < kProbeSize; ++i) {
+            benchmark::DoNotOptimize(table.sp_segment->read(table.tids[begin + i], &records[i * 64], 64));
+        }
+        begin = (begin + kProbeSize) % (table.tids.size() - kProbeSize);
+    }
+    state.SetItemsProcessed(state.iterations() * kProbeSize);
+}
+
+/// Read the records of a probe with one batch, which fixes every page once.
+void BM_ProbeReadBatch(benchmark::State &state) {
+    IndexedTable table(static_cast<uint64_t>(state.range(0)));
+    std::vector<std::byte> records(kProbeSize * 64);
+    std::vector<uint32_t> sizes(kProbeSize);
+    size_t begin = 0;
+    for (auto _ : state) {
+        /// the TIDs are shuffled, so every slice of them is a random probe
+        table.sp_segment->read_batch(&table.tids[begin], kProbeSize, records.data(), 64, sizes.data());
+        begin = (begin + kProbeSize) % (table.tids.size() - kProbeSize);
+        benchmark::DoNotOptimize(sizes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kProbeSize);
+}
+
+}  // namespace
+
+BENCHMARK(BM_IndexLookupScan)->RangeMultiplier(8)->Range(1 << 10, 1 << 16);
+BENCHMARK(BM_IndexLookupBTree)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK(BM_IndexLookupHash)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK(BM_ProbeRead)->RangeMultiplier(8)->Range(1 << 13, 1 << 19);
+BENCHMARK(BM_ProbeReadBatch)->RangeMultiplier(8)->Range(1 << 13, 1 << 19);
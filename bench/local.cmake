@@ -1,3 +1,30 @@
 # ---------------------------------------------------------------------------
 # MODERNDBS
 # ---------------------------------------------------------------------------
+
+# ---------------------------------------------------------------------------
+# Files
+# ---------------------------------------------------------------------------
+
+set(BENCH_CC
+    bench/allocation_bench.cc
+    bench/fsi_bench.cc
+    bench/index_bench.cc
+    bench/schema_bench.cc
+    bench/segment_bench.cc
+)
+
+# ---------------------------------------------------------------------------
+# Benchmarks
+# ---------------------------------------------------------------------------
+
+add_executable(benchmarks bench/bench.cc ${BENCH_CC})
+target_link_libraries(benchmarks moderndbs benchmark Threads::Threads)
+
+# ---------------------------------------------------------------------------
+# Linting
+# ---------------------------------------------------------------------------
+
+add_clang_tidy_target(lint_bench "${BENCH_CC}")
+add_dependencies(lint_bench benchmark)
+list(APPEND lint_targets lint_bench)
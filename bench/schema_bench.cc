@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/segment.h"
+
+using BufferManager = moderndbs::BufferManager;
+using SchemaSegment = moderndbs::SchemaSegment;
+
+namespace schema = moderndbs::schema;
+
+namespace {
+
+/// Create a schema of tables with eight columns each.
+std::unique_ptr<schema::Schema> make_schema(uint64_t table_count) {
+    std::vector<schema::Table> tables;
+    tables.reserve(table_count);
+    for (uint64_t i = 0; i < table_count; ++i) {
+        auto id = "table_" + std::to_string(i);
+        tables.emplace_back(id, std::vector<schema::Column>{
+            schema::Column(id + "_key", schema::Type::Integer()),
+            schema::Column(id + "_name", schema::Type::Varchar(25)),
+            schema::Column(id + "_address", schema::Type::Varchar(40)),
+            schema::Column(id + "_nation", schema::Type::Integer()),
+            schema::Column(id + "_phone", schema::Type::Char(15)),
+            schema::Column(id + "_balance", schema::Type::Numeric(12, 2)),
+            schema::Column(id + "_created", schema::Type::Timestamp()),
+            schema::Column(id + "_comment", schema::Type::Varchar(117)),
+        }, std::vector<std::string>{ id + "_key" });
+    }
+    return std::make_unique<schema::Schema>(std::move(tables));
+}
+
+/// Load a catalog of `state.range(0)` tables.
+void BM_SchemaRead(benchmark::State &state) {
+    BufferManager buffer_manager(4096, 16);
+    auto table_count = static_cast<uint64_t>(state.range(0));
+    {
+        SchemaSegment schema_segment(920, buffer_manager);
+        schema_segment.set_schema(make_schema(table_count));
+        schema_segment.write();
+    }
+
+    for (auto _ : state) {
+        SchemaSegment schema_segment(920, buffer_manager);
+        schema_segment.read();
+        benchmark::DoNotOptimize(schema_segment.get_schema());
+    }
+    state.SetItemsProcessed(state.iterations() * table_count);
+}
+
+/// Store a catalog of `state.range(0)` tables.
+void BM_SchemaWrite(benchmark::State &state) {
+    BufferManager buffer_manager(4096, 16);
+    SchemaSegment schema_segment(921, buffer_manager);
+    auto table_count = static_cast<uint64_t>(state.range(0));
+
+    for (auto _ : state) {
+        /// only a changed schema is written
+        state.PauseTiming();
+        schema_segment.set_schema(make_schema(table_count));
+        state.ResumeTiming();
+        schema_segment.write();
+    }
+    state.SetItemsProcessed(state.iterations() * table_count);
+}
+
+}  // namespace
+
+BENCHMARK(BM_SchemaRead)->RangeMultiplier(8)->Range(1, 1 << 15);
+BENCHMARK(BM_SchemaWrite)->RangeMultiplier(8)->Range(1, 1 << 15);
@@ -0,0 +1,164 @@
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/segment.h"
+
+using BufferManager = moderndbs::BufferManager;
+using FSISegment = moderndbs::FSISegment;
+using SPSegment = moderndbs::SPSegment;
+using SchemaSegment = moderndbs::SchemaSegment;
+using TID = moderndbs::TID;
+using WALSegment = moderndbs::WALSegment;
+
+namespace {
+
+/// Allocate records in a segment whose first `state.range(0)` pages are full.
+/// The throughput should not depend on the size of the segment.
+void BM_SPSegmentAllocate(benchmark::State &state) {
+    constexpr uint32_t kPageSize = 1024;
+    BufferManager buffer_manager(kPageSize, 1024);
+    SchemaSegment schema_segment(900, buffer_manager);
+    schema_segment.set_schema(std::make_unique<moderndbs::schema::Schema>(std::vector<moderndbs::schema::Table>{}));
+    FSISegment fsi_segment(901, buffer_manager, schema_segment);
+    SPSegment sp_segment(902, buffer_manager, schema_segment, fsi_segment);
+
+    /// one large record fills a page
+    auto full_pages = static_cast<uint64_t>(state.range(0));
+    while (schema_segment.get_sp_count() < full_pages) {
+        sp_segment.allocate(kPageSize - 128);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sp_segment.allocate(64));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["pages"] = static_cast<double>(schema_segment.get_sp_count());
+}
+
+/// Find pages in a free-space inventory where only the last page has room.
+void BM_FSIFind(benchmark::State &state) {
+    BufferManager buffer_manager(1024, 1024);
+    SchemaSegment schema_segment(903, buffer_manager);
+    FSISegment fsi_segment(904, buffer_manager, schema_segment);
+    auto pages = static_cast<uint64_t>(state.range(0));
+    for (uint64_t page = 0; page < pages; ++page) {
+        schema_segment.increase_sp_count();
+        fsi_segment.update(page, 0);
+    }
+    fsi_segment.update(pages - 1, 512);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fsi_segment.find(256));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// Recover a segment whose records were all written with a log, with (`state.range(0)` = 1) and without a
+/// checkpoint at the end. Without one, recovery reads the whole log and fixes the page of every record.
+void BM_WALRecovery(benchmark::State &state) {
+    constexpr uint32_t kPageSize = 1024;
+    for (auto segment_id : { 943, 944, 945, 946 }) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    {
+        BufferManager buffer_manager(kPageSize, 256);
+        SchemaSegment schema_segment(943, buffer_manager);
+        schema_segment.set_schema(std::make_unique<moderndbs::schema::Schema>(std::vector<moderndbs::schema::Table>{}));
+        FSISegment fsi_segment(944, buffer_manager, schema_segment);
+        WALSegment wal(946, buffer_manager);
+        SPSegment sp_segment(945, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+        std::vector<std::byte> record(40);
+        for (uint32_t i = 0; i < 20000; ++i) {
+            auto tid = sp_segment.allocate(40);
+            sp_segment.write(tid, record.data(), 40);
+        }
+        if (state.range(0) != 0) {
+            wal.checkpoint();
+        }
+    }
+
+    WALSegment::Statistics statistics;
+    for (auto _ : state) {
+        BufferManager buffer_manager(kPageSize, 256);
+        SchemaSegment schema_segment(943, buffer_manager);
+        schema_segment.read();
+        FSISegment fsi_segment(944, buffer_manager, schema_segment);
+        WALSegment wal(946, buffer_manager);
+        SPSegment sp_segment(945, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+        wal.recover();
+        statistics = wal.get_statistics();
+    }
+    state.counters["scanned_records"] = static_cast<double>(statistics.scanned_records);
+}
+
+/// Restart a buffer manager and read random records of a hot set that fills it, without (`state.range(0)` = 0) and
+/// with a warm-up from the pages that were resident before. The reads start while the warm-up is running (1) or after
+/// it finished (2).
+void BM_BufferWarmUp(benchmark::State &state) {
+    constexpr uint32_t kPageSize = 1024;
+    constexpr uint32_t kPageCount = 1024;
+    for (auto segment_id : { 947, 948, 949, 950 }) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    /// the records of the first pages are hot
+    std::vector<TID> tids;
+    std::vector<std::byte> record(100);
+    {
+        BufferManager buffer_manager(kPageSize, kPageCount);
+        buffer_manager.warm_up(950);
+        SchemaSegment schema_segment(947, buffer_manager);
+        schema_segment.set_schema(std::make_unique<moderndbs::schema::Schema>(std::vector<moderndbs::schema::Table>{}));
+        FSISegment fsi_segment(948, buffer_manager, schema_segment);
+        SPSegment sp_segment(949, buffer_manager, schema_segment, fsi_segment);
+        for (uint32_t i = 0; i < 40000; ++i) {
+            tids.push_back(sp_segment.allocate(100));
+        }
+        tids.erase(tids.begin() + tids.size() / 6, tids.end());
+        for (auto tid : tids) {
+            sp_segment.read(tid, record.data(), 100);
+        }
+    }
+
+    std::mt19937 engine{0};
+    BufferManager::Statistics statistics;
+    double first_hit_rate = 0;
+    for (auto _ : state) {
+        BufferManager buffer_manager(kPageSize, kPageCount);
+        if (state.range(0) != 0) {
+            buffer_manager.warm_up(950);
+        }
+        if (state.range(0) == 2) {
+            buffer_manager.wait_for_warm_up();
+        }
+        SchemaSegment schema_segment(947, buffer_manager);
+        schema_segment.read();
+        FSISegment fsi_segment(948, buffer_manager, schema_segment);
+        SPSegment sp_segment(949, buffer_manager, schema_segment, fsi_segment);
+        for (uint32_t i = 0; i < 10000; ++i) {
+            sp_segment.read(tids[engine() % tids.size()], record.data(), 100);
+            if (i == 999) {
+                auto first = buffer_manager.get_statistics();
+                first_hit_rate = static_cast<double>(first.hits) / static_cast<double>(first.hits + first.misses);
+            }
+        }
+        buffer_manager.wait_for_warm_up();
+        statistics = buffer_manager.get_statistics();
+    }
+    state.counters["warm_up_ms"] = static_cast<double>(statistics.warm_up_time.count()) / 1000;
+    state.counters["warmed_pages"] = static_cast<double>(statistics.warmed_pages);
+    state.counters["hit_rate_1k"] = first_hit_rate;
+    state.counters["hit_rate_10k"] =
+        static_cast<double>(statistics.hits) / static_cast<double>(statistics.hits + statistics.misses);
+}
+
+}  // namespace
+
+BENCHMARK(BM_SPSegmentAllocate)->RangeMultiplier(4)->Range(1 << 6, 1 << 16);
+BENCHMARK(BM_FSIFind)->RangeMultiplier(8)->Range(1 << 6, 1 << 24);
+BENCHMARK(BM_WALRecovery)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BufferWarmUp)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMillisecond);
@@ -8,7 +8,15 @@
 
 set(
     INCLUDE_H
+    include/moderndbs/btree.h
     include/moderndbs/buffer_manager.h
+    include/moderndbs/checkpointer.h
     include/moderndbs/file.h
+    include/moderndbs/fixed_page.h
+    include/moderndbs/hash_index.h
+    include/moderndbs/pax_page.h
+    include/moderndbs/predicate.h
+    include/moderndbs/record.h
     include/moderndbs/schema.h
+    include/moderndbs/vacuum.h
 )
@@ -0,0 +1,368 @@
+#ifndef INCLUDE_MODERNDBS_BTREE_H_
+#define INCLUDE_MODERNDBS_BTREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/segment.h"
+
+namespace moderndbs {
+
+/// A B+-tree whose nodes are pages of the buffer manager.
+///
+/// Page 0 of the segment stores the number of allocated pages, page 1 is always the root. When the root
+/// is split, its entries move to two new pages, so the root never changes its page.
+///
+/// Readers use latch coupling with shared latches. Writers first try to latch only the leaf exclusively
+/// (optimistic latch coupling); if the leaf is full, they restart with exclusive latch coupling and split
+/// every full node on their way down, so a split never has to propagate upwards. Latches are always
+/// acquired top-down and from left to right, so the tree is free of deadlocks.
+///
+/// Keys and values have to be trivially copyable. Nodes are not merged when entries are erased.
+template <typename KeyT, typename ValueT, typename ComparatorT, size_t PageSize>
+class BTree: public Segment {
+    static_assert(std::is_trivially_copyable_v<KeyT>, "keys are copied with memcpy");
+    static_assert(std::is_trivially_copyable_v<ValueT>, "values are copied with memcpy");
+
+    public:
+    /// The header of every node
+    struct Node {
+        /// The level in the tree (0 for leaves)
+        uint16_t level;
+        /// The number of keys
+        uint16_t count;
+
+        /// Is the node a leaf?
+        bool is_leaf() const { return level == 0; }
+    };
+
+    /// An inner node.
+    /// The subtree children[i] holds the keys that are <= keys[i],
+    /// children[count] holds the keys behind keys[count - 1].
+    struct InnerNode: public Node {
+        /// The maximum number of keys
+        static constexpr uint32_t kCapacity = (PageSize - 3 * sizeof(uint64_t)) / (sizeof(KeyT) + sizeof(uint64_t));
+
+        /// The separators
+        KeyT keys[kCapacity];
+        /// The page ids of the children
+        uint64_t children[kCapacity + 1];
+
+        /// Get the position of the child whose subtree contains a key.
+        uint16_t lower_bound(const KeyT &key) const {
+            return static_cast<uint16_t>(std::lower_bound(keys, keys + this->count, key, ComparatorT()) - keys);
+        }
+        /// Is the node full?
+        bool is_full() const { return this->count == kCapacity; }
+    };
+
+    /// A leaf node.
+    struct LeafNode: public Node {
+        /// The maximum number of entries
+        static constexpr uint32_t kCapacity = (PageSize - 3 * sizeof(uint64_t)) / (sizeof(KeyT) + sizeof(ValueT));
+
+        /// The page id of the next leaf (0 for the last leaf)
+        uint64_t next;
+        /// The keys
+        KeyT keys[kCapacity];
+        /// The values
+        ValueT values[kCapacity];
+
+        /// Get the position of the first key that is not less than a key.
+        uint16_t lower_bound(const KeyT &key) const {
+            return static_cast<uint16_t>(std::lower_bound(keys, keys + this->count, key, ComparatorT()) - keys);
+        }
+        /// Does the entry at a position have a key?
+        bool has_key(uint16_t position, const KeyT &key) const {
+            return position < this->count && !ComparatorT()(key, keys[position]);
+        }
+        /// Is the node full?
+        bool is_full() const { return this->count == kCapacity; }
+    };
+
+    static_assert(sizeof(InnerNode) <= PageSize, "inner nodes must fit on a page");
+    static_assert(sizeof(LeafNode) <= PageSize, "leaf nodes must fit on a page");
+    static_assert(InnerNode::kCapacity >= 3 && LeafNode::kCapacity >= 2, "the keys are too large for the page size");
+
+    /// The page that stores the number of allocated pages
+    static constexpr uint64_t kMetaPage = 0;
+    /// The page of the root
+    static constexpr uint64_t kRootPage = 1;
+
+    /// Constructor
+    /// Opens the tree that is stored in the segment or creates an empty one.
+    /// @param[in] segment_id       Id of the segment that the tree is stored in.
+    /// @param[in] buffer_manager   The buffer manager that should be used by the tree.
+    BTree(uint16_t segment_id, BufferManager &buffer_manager)
+        : Segment(segment_id, buffer_manager) {
+        if (buffer_manager.get_page_size() < PageSize) {
+            throw std::invalid_argument("the pages of the buffer manager are smaller than the nodes");
+        }
+        auto& meta = buffer_manager.fix_page(get_page_id(kMetaPage), true);
+        auto *page_count = reinterpret_cast<uint64_t*>(meta.get_data());
+        bool is_new = *page_count == 0;
+        if (is_new) {
+            auto& root = buffer_manager.fix_page(get_page_id(kRootPage), true);
+            auto *leaf = reinterpret_cast<LeafNode*>(root.get_data());
+            leaf->level = 0;
+            leaf->count = 0;
+            leaf->next = 0;
+            buffer_manager.unfix_page(root, true);
+            *page_count = kRootPage + 1;
+        }
+        buffer_manager.unfix_page(meta, is_new);
+    }
+
+    /// Lookup an entry in the tree.
+    /// @param[in] key      The key that should be searched.
+    std::optional<ValueT> lookup(const KeyT &key) {
+        auto *page = &buffer_manager.fix_page(get_page_id(kRootPage), false);
+        while (!as_node(page)->is_leaf()) {
+            auto *inner = as_inner(page);
+            auto *child = &buffer_manager.fix_page(get_page_id(inner->children[inner->lower_bound(key)]), false);
+            buffer_manager.unfix_page(*page, false);
+            page = child;
+        }
+        auto *leaf = as_leaf(page);
+        auto position = leaf->lower_bound(key);
+        std::optional<ValueT> result;
+        if (leaf->has_key(position, key)) {
+            result = leaf->values[position];
+        }
+        buffer_manager.unfix_page(*page, false);
+        return result;
+    }
+
+    /// Call the callback for the entries with lower <= key <= upper in ascending order.
+    /// The callback returns false to stop the scan. It must not modify the tree.
+    /// @param[in] lower    The smallest key.
+    /// @param[in] upper    The largest key.
+    /// @param[in] callback The callback.
+    void scan(const KeyT &lower, const KeyT &upper, const std::function<bool(const KeyT&, const ValueT&)> &callback) {
+        ComparatorT less;
+        auto *page = &buffer_manager.fix_page(get_page_id(kRootPage), false);
+        while (!as_node(page)->is_leaf()) {
+            auto *inner = as_inner(page);
+            auto *child = &buffer_manager.fix_page(get_page_id(inner->children[inner->lower_bound(lower)]), false);
+            buffer_manager.unfix_page(*page, false);
+            page = child;
+        }
+        auto position = as_leaf(page)->lower_bound(lower);
+        while (true) {
+            auto *leaf = as_leaf(page);
+            for (; position < leaf->count; ++position) {
+                if (less(upper, leaf->keys[position]) || !callback(leaf->keys[position], leaf->values[position])) {
+                    buffer_manager.unfix_page(*page, false);
+                    return;
+                }
+            }
+            if (leaf->next == 0) {
+                break;
+            }
+            /// the next leaf is latched before the current one is released
+            auto *next = &buffer_manager.fix_page(get_page_id(leaf->next), false);
+            buffer_manager.unfix_page(*page, false);
+            page = next;
+            position = 0;
+        }
+        buffer_manager.unfix_page(*page, false);
+    }
+
+    /// Insert a new entry into the tree.
+    /// Returns false if the key already exists, the tree is not changed then.
+    /// @param[in] key      The key that should be inserted.
+    /// @param[in] value    The value that should be inserted.
+    bool insert(const KeyT &key, const ValueT &value) {
+        /// most inserts do not split a node, so we only latch the leaf exclusively
+        auto *page = fix_leaf_optimistic(key);
+        if (page != nullptr) {
+            auto *leaf = as_leaf(page);
+            if (!leaf->is_full() || leaf->has_key(leaf->lower_bound(key), key)) {
+                bool inserted = insert_into_leaf(leaf, key, value);
+                buffer_manager.unfix_page(*page, inserted);
+                return inserted;
+            }
+            buffer_manager.unfix_page(*page, false);
+        }
+
+        /// split every full node on the way down
+        page = &buffer_manager.fix_page(get_page_id(kRootPage), true);
+        bool is_dirty = is_full(page);
+        if (is_dirty) {
+            split_root(page);
+        }
+        while (!as_node(page)->is_leaf()) {
+            auto *inner = as_inner(page);
+            auto position = inner->lower_bound(key);
+            auto *child = &buffer_manager.fix_page(get_page_id(inner->children[position]), true);
+            bool child_is_dirty = is_full(child);
+            if (child_is_dirty) {
+                auto [separator, sibling] = split_node(child);
+                insert_into_inner(inner, position, separator, sibling->get_page_id() & kPageMask);
+                is_dirty = true;
+                if (ComparatorT()(separator, key)) {
+                    buffer_manager.unfix_page(*child, true);
+                    child = sibling;
+                } else {
+                    buffer_manager.unfix_page(*sibling, true);
+                }
+            }
+            buffer_manager.unfix_page(*page, is_dirty);
+            page = child;
+            is_dirty = child_is_dirty;
+        }
+        bool inserted = insert_into_leaf(as_leaf(page), key, value);
+        buffer_manager.unfix_page(*page, is_dirty || inserted);
+        return inserted;
+    }
+
+    /// Erase an entry in the tree.
+    /// Returns false if the key does not exist.
+    /// @param[in] key      The key that should be erased.
+    bool erase(const KeyT &key) {
+        auto *page = fix_leaf_optimistic(key);
+        while (page == nullptr) {
+            /// the root is a leaf, unless it was split in the meantime
+            page = &buffer_manager.fix_page(get_page_id(kRootPage), true);
+            if (!as_node(page)->is_leaf()) {
+                buffer_manager.unfix_page(*page, false);
+                page = fix_leaf_optimistic(key);
+            }
+        }
+        auto *leaf = as_leaf(page);
+        auto position = leaf->lower_bound(key);
+        bool erased = leaf->has_key(position, key);
+        if (erased) {
+            std::memmove(&leaf->keys[position], &leaf->keys[position + 1], (leaf->count - position - 1) * sizeof(KeyT));
+            std::memmove(&leaf->values[position], &leaf->values[position + 1],
+                         (leaf->count - position - 1) * sizeof(ValueT));
+            --leaf->count;
+        }
+        buffer_manager.unfix_page(*page, erased);
+        return erased;
+    }
+
+    protected:
+    /// The bits of a page id that identify the page within the segment
+    static constexpr uint64_t kPageMask = (1ull << 48) - 1;
+
+    /// Get the page id of a page in the segment.
+    uint64_t get_page_id(uint64_t page) const { return (static_cast<uint64_t>(segment_id) << 48) | page; }
+
+    static Node *as_node(BufferFrame *page) { return reinterpret_cast<Node*>(page->get_data()); }
+    static InnerNode *as_inner(BufferFrame *page) { return reinterpret_cast<InnerNode*>(page->get_data()); }
+    static LeafNode *as_leaf(BufferFrame *page) { return reinterpret_cast<LeafNode*>(page->get_data()); }
+
+    /// Is a node full?
+    static bool is_full(BufferFrame *page) {
+        return as_node(page)->is_leaf() ? as_leaf(page)->is_full() : as_inner(page)->is_full();
+    }
+
+    /// Descend with shared latches and latch the leaf that might contain a key exclusively.
+    /// Returns nullptr if the root is a leaf.
+    BufferFrame *fix_leaf_optimistic(const KeyT &key) {
+        auto *page = &buffer_manager.fix_page(get_page_id(kRootPage), false);
+        if (as_node(page)->is_leaf()) {
+            buffer_manager.unfix_page(*page, false);
+            return nullptr;
+        }
+        while (true) {
+            auto *inner = as_inner(page);
+            bool child_is_leaf = inner->level == 1;
+            auto child_page = inner->children[inner->lower_bound(key)];
+            auto *child = &buffer_manager.fix_page(get_page_id(child_page), child_is_leaf);
+            buffer_manager.unfix_page(*page, false);
+            page = child;
+            if (child_is_leaf) {
+                return page;
+            }
+        }
+    }
+
+    /// Allocate a new page and latch it exclusively.
+    BufferFrame *allocate_page() {
+        auto& meta = buffer_manager.fix_page(get_page_id(kMetaPage), false);
+        auto page = __atomic_fetch_add(reinterpret_cast<uint64_t*>(meta.get_data()), 1, __ATOMIC_RELAXED);
+        buffer_manager.unfix_page(meta, true);
+        return &buffer_manager.fix_page(get_page_id(page), true);
+    }
+
+    /// Split a full node.
+    /// Returns the separator and the new right sibling, which is latched exclusively.
+    std::pair<KeyT, BufferFrame*> split_node(BufferFrame *page) {
+        auto *sibling = allocate_page();
+        if (as_node(page)->is_leaf()) {
+            auto *left = as_leaf(page);
+            auto *right = as_leaf(sibling);
+            uint16_t keep = left->count / 2;
+            right->level = 0;
+            right->count = static_cast<uint16_t>(left->count - keep);
+            right->next = left->next;
+            std::memcpy(right->keys, left->keys + keep, right->count * sizeof(KeyT));
+            std::memcpy(right->values, left->values + keep, right->count * sizeof(ValueT));
+            left->count = keep;
+            left->next = sibling->get_page_id() & kPageMask;
+            return { left->keys[keep - 1], sibling };
+        }
+        auto *left = as_inner(page);
+        auto *right = as_inner(sibling);
+        uint16_t keep = left->count / 2;
+        right->level = left->level;
+        right->count = static_cast<uint16_t>(left->count - keep - 1);
+        std::memcpy(right->keys, left->keys + keep + 1, right->count * sizeof(KeyT));
+        std::memcpy(right->children, left->children + keep + 1, (right->count + 1) * sizeof(uint64_t));
+        left->count = keep;
+        return { left->keys[keep], sibling };
+    }
+
+    /// Split the full root.
+    /// Its entries move to two new pages, so that the root keeps its page.
+    void split_root(BufferFrame *root) {
+        auto *left = allocate_page();
+        std::memcpy(left->get_data(), root->get_data(), PageSize);
+        auto [separator, right] = split_node(left);
+        auto *node = as_inner(root);
+        node->level = static_cast<uint16_t>(as_node(left)->level + 1);
+        node->count = 1;
+        node->keys[0] = separator;
+        node->children[0] = left->get_page_id() & kPageMask;
+        node->children[1] = right->get_page_id() & kPageMask;
+        buffer_manager.unfix_page(*left, true);
+        buffer_manager.unfix_page(*right, true);
+    }
+
+    /// Insert a separator and the child behind it into an inner node that is not full.
+    static void insert_into_inner(InnerNode *node, uint16_t position, const KeyT &separator, uint64_t child) {
+        std::memmove(&node->keys[position + 1], &node->keys[position], (node->count - position) * sizeof(KeyT));
+        std::memmove(&node->children[position + 2], &node->children[position + 1],
+                     (node->count - position) * sizeof(uint64_t));
+        node->keys[position] = separator;
+        node->children[position + 1] = child;
+        ++node->count;
+    }
+
+    /// Insert an entry into a leaf.
+    /// Returns false if the key already exists. The leaf must not be full otherwise.
+    static bool insert_into_leaf(LeafNode *leaf, const KeyT &key, const ValueT &value) {
+        auto position = leaf->lower_bound(key);
+        if (leaf->has_key(position, key)) {
+            return false;
+        }
+        std::memmove(&leaf->keys[position + 1], &leaf->keys[position], (leaf->count - position) * sizeof(KeyT));
+        std::memmove(&leaf->values[position + 1], &leaf->values[position], (leaf->count - position) * sizeof(ValueT));
+        std::memcpy(&leaf->keys[position], &key, sizeof(KeyT));
+        std::memcpy(&leaf->values[position], &value, sizeof(ValueT));
+        ++leaf->count;
+        return true;
+    }
+};
+
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_BTREE_H_
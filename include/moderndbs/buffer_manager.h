@@ -1,11 +1,22 @@
 #ifndef INCLUDE_MODERNDBS_BUFFER_MANAGER_H
 #define INCLUDE_MODERNDBS_BUFFER_MANAGER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
+#include "moderndbs/file.h"
 
 
 namespace moderndbs {
@@ -14,11 +25,44 @@ class BufferFrame {
 private:
     friend class BufferManager;
 
+    /// The page id
+    uint64_t page_id;
+    /// The page data
     std::vector<char> data;
+    /// The latch that protects the page data
+    std::shared_mutex latch;
+    /// The number of threads that fixed the page
+    uint32_t fix_count = 0;
+    /// Was the page locked exclusively?
+    bool exclusive = false;
+    /// Was the page modified since it was loaded?
+    bool dirty = false;
+    /// Is the page being read from disk? Threads that fix it wait until it is loaded
+    bool loading = false;
+    /// The position of the page in the FIFO or LRU list
+    std::list<BufferFrame*>::iterator position;
+    /// Is the page in the LRU list?
+    bool in_lru = false;
+    /// The LSN of the last logged change, the log has to be flushed up to it
+    /// before the page is written
+    uint64_t lsn = 0;
+    /// The LSN of the first logged change since the page was last written
+    /// (0 if there is none), recovery has to redo the log from there on
+    std::atomic<uint64_t> recovery_lsn = 0;
 
 public:
     /// Returns a pointer to this page's data.
     char* get_data();
+    /// Returns the id of the page.
+    uint64_t get_page_id() const { return page_id; }
+    /// Remembers the LSN of a logged change of the page.
+    /// Requires an exclusive latch on the page.
+    void set_lsn(uint64_t new_lsn) {
+        lsn = new_lsn;
+        if (recovery_lsn.load(std::memory_order_relaxed) == 0) {
+            recovery_lsn.store(new_lsn, std::memory_order_relaxed);
+        }
+    }
 };
 
 
@@ -32,9 +76,72 @@ public:
 
 
 class BufferManager {
+public:
+    /// Counters since the buffer manager was created
+    struct Statistics {
+        /// The number of fixes of pages that were in memory
+        uint64_t hits = 0;
+        /// The number of fixes that read the page from disk
+        uint64_t misses = 0;
+        /// The number of pages that the warm-up loaded
+        uint64_t warmed_pages = 0;
+        /// The time that the warm-up took
+        std::chrono::microseconds warm_up_time{0};
+        /// Is the warm-up running?
+        bool is_warming_up = false;
+    };
+
 private:
     size_t page_size;
-    std::unordered_map<uint64_t, BufferFrame> pages;
+    size_t page_count;
+    /// Protects the page table, the lists and the files
+    mutable std::mutex directory_latch;
+    /// Signaled when a page was loaded or written to evict it
+    std::condition_variable io_done;
+    /// The number of dirty pages that are written to evict them
+    size_t evictions = 0;
+    /// The pages in memory
+    std::unordered_map<uint64_t, std::unique_ptr<BufferFrame>> pages;
+    /// Pages that were fixed once (2Q)
+    std::list<BufferFrame*> fifo;
+    /// Pages that were fixed again (2Q)
+    std::list<BufferFrame*> lru;
+    /// The file of every segment
+    std::unordered_map<uint16_t, std::unique_ptr<File>> files;
+    /// Flushes the write-ahead log up to an LSN (if there is a log)
+    std::function<void(uint64_t)> flush_log;
+    /// The number of completed page writes and of pages that left memory
+    /// (evictions, truncations and failed reads), pages that were read
+    /// without the directory latch are only loaded if it did not change
+    uint64_t generation = 0;
+    /// The counters
+    Statistics statistics;
+    /// The file that the ids of the resident pages are saved in (optional)
+    std::unique_ptr<File> hot_pages_file;
+    /// Protects the file of the resident pages
+    std::mutex hot_pages_latch;
+    /// Loads the saved pages in the background
+    std::thread warm_up_thread;
+    /// Should the warm-up stop?
+    std::atomic<bool> stop_warm_up = false;
+
+    /// Get the file of a segment.
+    File &get_file(uint16_t segment_id);
+    /// Read a page from disk.
+    void read_page(File &file, BufferFrame &page);
+    /// Write a page to disk.
+    void write_page(BufferFrame &page);
+    /// Write a fixed page to disk without holding the directory latch.
+    /// Requires a shared latch on the page.
+    void write_fixed_page(BufferFrame &page);
+    /// Load a page and increment its fix count without latching it.
+    BufferFrame &pin_page(uint64_t page_id);
+    /// Evict an unfixed page, FIFO first.
+    /// A dirty page is written without the directory latch instead, the caller has to check for a free frame again.
+    /// Returns false if all pages are fixed.
+    bool evict(std::unique_lock<std::mutex> &directory_guard);
+    /// Load the pages whose ids were saved while there are free frames.
+    void load_hot_pages();
 
 public:
     /// Constructor.
@@ -43,7 +150,8 @@ public:
     //                        memory at the same time.
     BufferManager(size_t page_size, size_t page_count);
 
-    /// Destructor. Writes all dirty pages to disk.
+    /// Destructor. Stops the warm-up, saves the ids of the resident pages and
+    /// writes all dirty pages to disk.
     ~BufferManager();
 
     /// Returns size of a page
@@ -62,11 +170,88 @@ public:
     ///                      non-exclusively (shared).
     BufferFrame& fix_page(uint64_t page_id, bool exclusive);
 
+    /// Like `fix_page()`, but returns nullptr instead of waiting when another
+    /// thread holds a conflicting latch on the page. Threads that already hold
+    /// page latches use it to fix pages out of order without deadlocking.
+    BufferFrame* try_fix_page(uint64_t page_id, bool exclusive);
+
+    /// Announces that a page will be fixed soon. When the page is not in
+    /// memory, it is read ahead from disk in the background, without loading
+    /// it into the buffer or changing the replacement order.
+    /// Is thread-safe.
+    /// @param[in] page_id   Page id of the page that will be fixed.
+    void prefetch(uint64_t page_id);
+
     /// Takes a `BufferFrame` reference that was returned by an earlier call to
     /// `fix_page()` and unfixes it. When `is_dirty` is / true, the page is
     /// written back to disk eventually.
     void unfix_page(BufferFrame& page, bool is_dirty);
 
+    /// Removes the pages of a segment from `page_count` on and cuts its file
+    /// off behind them. Unfixed pages are dropped from memory, fixed pages are
+    /// kept but no longer written back, unless they are modified again.
+    /// Is thread-safe, but the caller has to ensure that the pages do not
+    /// hold data anymore.
+    /// @param[in] segment_id The segment.
+    /// @param[in] page_count The number of pages that the segment keeps.
+    void truncate(uint16_t segment_id, uint64_t page_count);
+
+    /// Sets the function that flushes the write-ahead log up to an LSN.
+    /// Before a page with a logged change is written, the log is flushed up
+    /// to the LSN of its last change (write-ahead logging). An empty function
+    /// removes the log.
+    /// Is not thread-safe.
+    /// @param[in] flush     The function.
+    void set_log(std::function<void(uint64_t)> flush);
+
+    /// Returns the page id and the recovery LSN of every page with logged
+    /// changes that were not written yet (the dirty page table of the log).
+    /// The recovery LSN is the LSN of the first change since the page was
+    /// last written.
+    /// Is thread-safe.
+    std::vector<std::pair<uint64_t, uint64_t>> get_dirty_page_table() const;
+
+    /// Writes pages to disk if they are dirty while other threads keep using
+    /// them. Every page is latched shared while it is written, pages that are
+    /// not in memory anymore were written when they were evicted.
+    /// Is thread-safe, but the calling thread must not hold page latches.
+    /// @param[in] page_ids  The page ids.
+    void flush_pages(const std::vector<uint64_t> &page_ids);
+
+    /// Writes all dirty pages of a segment to disk like `flush_pages()`.
+    /// @param[in] segment_id The segment.
+    void flush_segment(uint16_t segment_id);
+
+    /// Starts to load the pages whose ids were saved in a file by an earlier
+    /// buffer manager in a background thread, while other threads already
+    /// use the buffer. The pages are read in page id order (by segment and
+    /// offset), runs of consecutive pages with a single read, into free
+    /// frames only: the warm-up stops when the buffer is full, and pages that
+    /// are in memory already are not read again. The loaded pages are
+    /// appended to the FIFO list.
+    /// The ids of the resident pages are saved to the same file when
+    /// `save_resident_pages()` is called and when the buffer manager is
+    /// destroyed.
+    /// Is not thread-safe, must be called at most once.
+    /// @param[in] file_id   The id that the file is named after, like the
+    ///                      file of a segment.
+    void warm_up(uint16_t file_id);
+
+    /// Waits until the warm-up finished.
+    /// Is not thread-safe.
+    void wait_for_warm_up();
+
+    /// Saves the ids of the resident pages to the file of `warm_up()`, most
+    /// recently used first (the LRU list from its end, then the FIFO list
+    /// from its end), so that a smaller buffer loads the hottest pages.
+    /// Does nothing if there is no such file.
+    /// Is thread-safe.
+    void save_resident_pages();
+
+    /// Returns the counters.
+    /// Is thread-safe.
+    Statistics get_statistics() const;
+
     /// Returns the page ids of all pages (fixed and unfixed) that are in the
     /// FIFO list in FIFO order.
     /// Is not thread-safe.
@@ -91,6 +276,64 @@ public:
 };
 
 
+
+/// Keeps a page fixed while it is in scope. The page is unfixed when the guard
+/// is destroyed or released, dirty if `mark_dirty()` was called.
+class PageGuard {
+private:
+    BufferManager *buffer_manager = nullptr;
+    BufferFrame *page = nullptr;
+    bool is_dirty = false;
+
+public:
+    /// Constructor for an empty guard.
+    PageGuard() = default;
+    /// Constructor that fixes a page.
+    PageGuard(BufferManager &buffer_manager, uint64_t page_id, bool exclusive)
+        : buffer_manager(&buffer_manager), page(&buffer_manager.fix_page(page_id, exclusive)) {}
+    /// Constructor that takes over a fixed page.
+    PageGuard(BufferManager &buffer_manager, BufferFrame &page)
+        : buffer_manager(&buffer_manager), page(&page) {}
+    /// Destructor. Unfixes the page.
+    ~PageGuard() { release(); }
+
+    PageGuard(const PageGuard&) = delete;
+    PageGuard &operator=(const PageGuard&) = delete;
+    PageGuard(PageGuard &&other) noexcept
+        : buffer_manager(other.buffer_manager), page(other.page), is_dirty(other.is_dirty) {
+        other.page = nullptr;
+    }
+    PageGuard &operator=(PageGuard &&other) noexcept {
+        if (this != &other) {
+            release();
+            buffer_manager = other.buffer_manager;
+            page = other.page;
+            is_dirty = other.is_dirty;
+            other.page = nullptr;
+        }
+        return *this;
+    }
+
+    /// Does the guard hold a page?
+    explicit operator bool() const { return page != nullptr; }
+    /// Returns the id of the page.
+    uint64_t get_page_id() const { return page->get_page_id(); }
+    /// Returns a pointer to the page's data.
+    char *get_data() const { return page->get_data(); }
+    /// Write the page back to disk when it is unfixed.
+    void mark_dirty() { is_dirty = true; }
+    /// Remember the LSN of a logged change of the page.
+    void set_lsn(uint64_t lsn) { page->set_lsn(lsn); }
+    /// Unfix the page before the guard goes out of scope.
+    void release() {
+        if (page != nullptr) {
+            buffer_manager->unfix_page(*page, is_dirty);
+            page = nullptr;
+            is_dirty = false;
+        }
+    }
+};
+
 }  // namespace moderndbs
 
 #endif
@@ -0,0 +1,53 @@
+#ifndef INCLUDE_MODERNDBS_CHECKPOINTER_H_
+#define INCLUDE_MODERNDBS_CHECKPOINTER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "moderndbs/segment.h"
+
+namespace moderndbs {
+
+/// Takes fuzzy checkpoints of a write-ahead log in a background thread.
+/// A checkpoint is taken when enough log was appended since the last one began or when the interval passed,
+/// whatever happens first, so that recovery never has to read much more log than that.
+/// The checkpointer has to be destroyed before the segments of the log.
+class Checkpointer {
+    public:
+    /// Constructor. Starts the background thread.
+    /// @param[in] wal              The log.
+    /// @param[in] log_size         The number of log bytes after which a checkpoint is taken.
+    /// @param[in] interval         The time after which a checkpoint is taken (if anything was logged).
+    explicit Checkpointer(WALSegment &wal, uint64_t log_size = 64ull << 20,
+                          std::chrono::milliseconds interval = std::chrono::seconds(30));
+    /// Destructor. Stops the background thread after its current checkpoint.
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer &operator=(const Checkpointer&) = delete;
+
+    protected:
+    /// The loop of the background thread
+    void run();
+
+    /// The log
+    WALSegment &wal;
+    /// The number of log bytes after which a checkpoint is taken
+    uint64_t log_size;
+    /// The time after which a checkpoint is taken
+    std::chrono::milliseconds interval;
+    /// Protects the stop flag
+    std::mutex mutex;
+    /// Wakes the thread up when it should stop
+    std::condition_variable stop_condition;
+    /// Should the thread stop?
+    bool stopped = false;
+    /// The background thread
+    std::thread thread;
+};
+
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_CHECKPOINTER_H_
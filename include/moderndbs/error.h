@@ -11,6 +11,11 @@ struct NotImplementedException: std::runtime_error {
     NotImplementedException() : std::runtime_error("Not implemented") {}
 };
 
+struct RecordCodecError: std::runtime_error {
+    // Constructor
+    explicit RecordCodecError(const std::string &what) : std::runtime_error(what) {}
+};
+
 struct SchemaParseError: std::exception {
     // Constructor
     explicit SchemaParseError(const char *what): message_(what) {}
@@ -41,6 +41,14 @@ public:
     ///                    Must be able to hold at least `size` bytes.
     virtual void read_block(size_t offset, size_t size, char* block) = 0;
 
+    /// Announces that a block of the file will be read soon, so that it can
+    /// be read ahead in the background. Does not wait for the block.
+    /// Is thread-safe w.r.t concurrent calls to `read_block()` and
+    /// `write_block()`.
+    /// @param[in] offset The offset of the block.
+    /// @param[in] size   The size of the block.
+    virtual void prefetch_block(size_t offset, size_t size) = 0;
+
     /// Reads a block of the file and returns it.
     std::unique_ptr<char[]> read_block(size_t offset, size_t size) {
         auto block = std::make_unique<char[]>(size);
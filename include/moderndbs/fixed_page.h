@@ -0,0 +1,89 @@
+#ifndef INCLUDE_MODERNDBS_FIXED_PAGE_H_
+#define INCLUDE_MODERNDBS_FIXED_PAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace moderndbs {
+
+/// A page of records that all have the same size, used for tables without varchar columns.
+/// The page is structured as follows:
+///   1) The header
+///   2) A bitmap of the occupied slots
+///   3) The records, the record of slot N is stored at records_begin + N * record_size
+/// There is no slot directory, so a TID is turned into an address without branches.
+/// Records cannot grow, so they are never redirected.
+struct FixedPage {
+    /// The size and position of the records, computed once per table.
+    struct Layout {
+        /// Constructor
+        /// @param[in] record_size  The size of every record.
+        /// @param[in] page_size    The size of a buffer frame.
+        Layout(uint32_t record_size, uint32_t page_size);
+
+        /// The size of every record
+        uint32_t record_size;
+        /// The maximum number of records per page
+        uint16_t capacity;
+        /// The offset of the first record
+        uint32_t records_begin;
+    };
+
+    struct alignas(8) Header {
+        // Constructor
+        explicit Header(const Layout &layout);
+
+        /// One past the last occupied slot
+        uint16_t slot_count;
+        /// To speed up the search for a free slot
+        uint16_t first_free_slot;
+        /// Number of occupied slots
+        uint16_t record_count;
+        /// Maximum number of slots
+        uint16_t capacity;
+        /// The LSN of the last logged change of the page (0 if it was never logged)
+        uint64_t lsn;
+    };
+
+    /// Constructor.
+    /// @param[in] layout       The record layout.
+    explicit FixedPage(const Layout &layout);
+
+    /// Get the data of the page.
+    std::byte *get_data() { return reinterpret_cast<std::byte*>(this); }
+    /// Get the data of the page.
+    const std::byte *get_data() const { return reinterpret_cast<const std::byte*>(this); }
+    /// Get the bitmap of the occupied slots.
+    uint64_t *get_bitmap() { return reinterpret_cast<uint64_t*>(get_data() + sizeof(FixedPage)); }
+    /// Get the bitmap of the occupied slots.
+    const uint64_t *get_bitmap() const { return reinterpret_cast<const uint64_t*>(get_data() + sizeof(FixedPage)); }
+
+    /// Is a slot occupied?
+    bool is_occupied(uint16_t slot_id) const { return (get_bitmap()[slot_id / 64] >> (slot_id % 64)) & 1; }
+    /// Is there a free slot?
+    bool has_free_slot() const { return header.first_free_slot < header.capacity; }
+    /// Get the record of a slot.
+    std::byte *get_record(const Layout &layout, uint16_t slot_id) {
+        return get_data() + layout.records_begin + slot_id * layout.record_size;
+    }
+
+    /// Allocate a slot.
+    /// The caller has to ensure that there is a free slot.
+    uint16_t allocate();
+
+    /// Allocate a specific free slot, e.g. to restore a record with its TID.
+    /// @param[in] slot_id      The slot.
+    void allocate_at(uint16_t slot_id);
+
+    /// Erase a slot.
+    /// @param[in] slot_id      The slot.
+    void erase(uint16_t slot_id);
+
+    /// The header.
+    /// Like a slotted page, the page resides on the buffer frame.
+    Header header;
+};
+
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_FIXED_PAGE_H_
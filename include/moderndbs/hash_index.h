@@ -0,0 +1,371 @@
+#ifndef INCLUDE_MODERNDBS_HASH_INDEX_H_
+#define INCLUDE_MODERNDBS_HASH_INDEX_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/segment.h"
+
+namespace moderndbs {
+
+/// An extendible hash index whose buckets are pages of the buffer manager.
+///
+/// Page 0 of the segment stores the global depth and the pages of the directory. The directory maps the lowest
+/// `global depth` bits of a hash value to a bucket page. A full bucket is split into two buckets with a larger
+/// local depth; only if its local depth equals the global depth, the directory is doubled first by copying its
+/// entries. No entry is rehashed except the ones of the split bucket.
+///
+/// Every operation latches page 0 and the directory page shared until it has latched its bucket, so a writer that
+/// latches page 0 exclusively to split a bucket can latch all other pages in any order without deadlocks. Lookups and
+/// most inserts only wait for the latch of their bucket.
+///
+/// Keys and values have to be trivially copyable and keys have to be comparable with ==. Buckets are not merged when
+/// entries are erased.
+template <typename KeyT, typename ValueT, typename HashT, size_t PageSize>
+class HashIndex: public Segment {
+    static_assert(std::is_trivially_copyable_v<KeyT>, "keys are copied with memcpy");
+    static_assert(std::is_trivially_copyable_v<ValueT>, "values are copied with memcpy");
+
+    public:
+    /// The header page
+    struct Header {
+        /// The number of allocated pages
+        uint64_t page_count;
+        /// The number of hash bits that select a directory entry
+        uint32_t global_depth;
+        /// The number of directory pages
+        uint32_t directory_page_count;
+
+        /// The maximum number of directory pages
+        static constexpr uint32_t kMaxDirectoryPages = (PageSize - 2 * sizeof(uint64_t)) / sizeof(uint64_t);
+        /// The directory pages
+        uint64_t directory_pages[kMaxDirectoryPages];
+    };
+
+    /// A bucket.
+    /// The entries are sorted by the upper 32 bits of their hash values (their fingerprints), so that a lookup
+    /// binary searches the fingerprints and only compares the keys with a matching fingerprint.
+    struct Bucket {
+        /// The maximum number of entries
+        static constexpr uint32_t kCapacity = (PageSize - sizeof(uint64_t) - alignof(KeyT)) /
+            (sizeof(uint32_t) + sizeof(KeyT) + sizeof(ValueT));
+
+        /// The number of hash bits that all keys of the bucket share
+        uint32_t local_depth;
+        /// The number of entries
+        uint32_t count;
+        /// The fingerprints
+        uint32_t fingerprints[kCapacity];
+        /// The keys
+        KeyT keys[kCapacity];
+        /// The values
+        ValueT values[kCapacity];
+
+        /// Get the position of a key.
+        /// Returns count if the bucket does not contain the key.
+        uint32_t find(const KeyT &key, uint32_t fingerprint) const {
+            auto position = static_cast<uint32_t>(
+                std::lower_bound(fingerprints, fingerprints + count, fingerprint) - fingerprints);
+            for (; position < count && fingerprints[position] == fingerprint; ++position) {
+                if (keys[position] == key) {
+                    return position;
+                }
+            }
+            return count;
+        }
+        /// Is the bucket full?
+        bool is_full() const { return count == kCapacity; }
+    };
+
+    /// The number of directory entries per page
+    static constexpr uint64_t kEntriesPerPage = PageSize / sizeof(uint64_t);
+
+    static_assert(sizeof(Header) <= PageSize, "the header must fit on a page");
+    static_assert(sizeof(Bucket) <= PageSize, "buckets must fit on a page");
+    static_assert(Bucket::kCapacity >= 2, "the entries are too large for the page size");
+
+    /// The page that stores the header
+    static constexpr uint64_t kHeaderPage = 0;
+
+    /// Constructor
+    /// Opens the index that is stored in the segment or creates an empty one.
+    /// @param[in] segment_id       Id of the segment that the index is stored in.
+    /// @param[in] buffer_manager   The buffer manager that should be used by the index.
+    HashIndex(uint16_t segment_id, BufferManager &buffer_manager)
+        : Segment(segment_id, buffer_manager) {
+        if (buffer_manager.get_page_size() < PageSize) {
+            throw std::invalid_argument("the pages of the buffer manager are smaller than the buckets");
+        }
+        auto& page = buffer_manager.fix_page(get_page_id(kHeaderPage), true);
+        auto *header = reinterpret_cast<Header*>(page.get_data());
+        bool is_new = header->page_count == 0;
+        if (is_new) {
+            /// a single bucket that all directory entries refer to
+            header->page_count = 1;
+            header->global_depth = 0;
+            header->directory_page_count = 1;
+            header->directory_pages[0] = allocate_page(*header);
+            auto bucket_page = allocate_page(*header);
+            auto& directory = buffer_manager.fix_page(get_page_id(header->directory_pages[0]), true);
+            reinterpret_cast<uint64_t*>(directory.get_data())[0] = bucket_page;
+            buffer_manager.unfix_page(directory, true);
+            auto& bucket = buffer_manager.fix_page(get_page_id(bucket_page), true);
+            auto *node = reinterpret_cast<Bucket*>(bucket.get_data());
+            node->local_depth = 0;
+            node->count = 0;
+            buffer_manager.unfix_page(bucket, true);
+        }
+        buffer_manager.unfix_page(page, is_new);
+    }
+
+    /// Lookup an entry in the index.
+    /// @param[in] key      The key that should be searched.
+    std::optional<ValueT> lookup(const KeyT &key) {
+        auto hash = get_hash(key);
+        auto *page = fix_bucket(hash, false);
+        auto *bucket = as_bucket(page);
+        auto position = bucket->find(key, get_fingerprint(hash));
+        std::optional<ValueT> result;
+        if (position < bucket->count) {
+            result = bucket->values[position];
+        }
+        buffer_manager.unfix_page(*page, false);
+        return result;
+    }
+
+    /// Insert a new entry into the index.
+    /// Returns false if the key already exists, the index is not changed then.
+    /// @param[in] key      The key that should be inserted.
+    /// @param[in] value    The value that should be inserted.
+    bool insert(const KeyT &key, const ValueT &value) {
+        auto hash = get_hash(key);
+        auto fingerprint = get_fingerprint(hash);
+        auto *page = fix_bucket(hash, true);
+        auto *bucket = as_bucket(page);
+        if (bucket->find(key, fingerprint) < bucket->count) {
+            buffer_manager.unfix_page(*page, false);
+            return false;
+        }
+        if (!bucket->is_full()) {
+            insert_into_bucket(bucket, key, value, fingerprint);
+            buffer_manager.unfix_page(*page, true);
+            return true;
+        }
+        buffer_manager.unfix_page(*page, false);
+
+        /// split the bucket of the key until it has room, nobody else can access the directory meanwhile
+        auto& header_page = buffer_manager.fix_page(get_page_id(kHeaderPage), true);
+        auto *header = reinterpret_cast<Header*>(header_page.get_data());
+        bool is_dirty = false;
+        while (true) {
+            auto bucket_page = get_entry(*header, hash & get_mask(header->global_depth));
+            page = &buffer_manager.fix_page(get_page_id(bucket_page), true);
+            bucket = as_bucket(page);
+            if (bucket->find(key, fingerprint) < bucket->count) {
+                /// another thread inserted the key in the meantime
+                buffer_manager.unfix_page(*page, false);
+                buffer_manager.unfix_page(header_page, is_dirty);
+                return false;
+            }
+            if (!bucket->is_full()) {
+                break;
+            }
+            if (bucket->local_depth == header->global_depth) {
+                try {
+                    grow_directory(*header);
+                } catch (...) {
+                    buffer_manager.unfix_page(*page, false);
+                    buffer_manager.unfix_page(header_page, is_dirty);
+                    throw;
+                }
+            }
+            split_bucket(*header, page, hash);
+            buffer_manager.unfix_page(*page, true);
+            is_dirty = true;
+        }
+        insert_into_bucket(bucket, key, value, fingerprint);
+        buffer_manager.unfix_page(*page, true);
+        buffer_manager.unfix_page(header_page, is_dirty);
+        return true;
+    }
+
+    /// Erase an entry in the index.
+    /// Returns false if the key does not exist.
+    /// @param[in] key      The key that should be erased.
+    bool erase(const KeyT &key) {
+        auto hash = get_hash(key);
+        auto *page = fix_bucket(hash, true);
+        auto *bucket = as_bucket(page);
+        auto position = bucket->find(key, get_fingerprint(hash));
+        bool erased = position < bucket->count;
+        if (erased) {
+            auto moved = bucket->count - position - 1;
+            std::memmove(&bucket->fingerprints[position], &bucket->fingerprints[position + 1],
+                         moved * sizeof(uint32_t));
+            std::memmove(&bucket->keys[position], &bucket->keys[position + 1], moved * sizeof(KeyT));
+            std::memmove(&bucket->values[position], &bucket->values[position + 1], moved * sizeof(ValueT));
+            --bucket->count;
+        }
+        buffer_manager.unfix_page(*page, erased);
+        return erased;
+    }
+
+    protected:
+    /// Get the page id of a page in the segment.
+    uint64_t get_page_id(uint64_t page) const { return (static_cast<uint64_t>(segment_id) << 48) | page; }
+
+    static Bucket *as_bucket(BufferFrame *page) { return reinterpret_cast<Bucket*>(page->get_data()); }
+
+    /// Get the mask of the lowest `depth` bits.
+    static uint64_t get_mask(uint32_t depth) { return depth == 64 ? ~0ull : (1ull << depth) - 1; }
+
+    /// Get the hash value of a key.
+    /// The hash value is mixed, so that weak hash functions (like the identity) still spread the keys evenly.
+    static uint64_t get_hash(const KeyT &key) {
+        uint64_t hash = HashT()(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+    /// Get the fingerprint of a hash value.
+    /// The directory uses the lower bits, so the fingerprint uses the upper ones.
+    static uint32_t get_fingerprint(uint64_t hash) { return static_cast<uint32_t>(hash >> 32); }
+
+    /// Allocate a new page.
+    /// The caller has to latch the header page exclusively.
+    static uint64_t allocate_page(Header &header) { return header.page_count++; }
+
+    /// Get a directory entry.
+    /// The caller has to latch the header page.
+    uint64_t get_entry(const Header &header, uint64_t entry) {
+        auto& page = buffer_manager.fix_page(get_page_id(header.directory_pages[entry / kEntriesPerPage]), false);
+        auto bucket_page = reinterpret_cast<uint64_t*>(page.get_data())[entry % kEntriesPerPage];
+        buffer_manager.unfix_page(page, false);
+        return bucket_page;
+    }
+
+    /// Latch the bucket that might contain the keys with a hash value.
+    BufferFrame *fix_bucket(uint64_t hash, bool exclusive) {
+        auto& header_page = buffer_manager.fix_page(get_page_id(kHeaderPage), false);
+        auto *header = reinterpret_cast<Header*>(header_page.get_data());
+        auto entry = hash & get_mask(header->global_depth);
+        auto& directory = buffer_manager.fix_page(get_page_id(header->directory_pages[entry / kEntriesPerPage]), false);
+        auto bucket_page = reinterpret_cast<uint64_t*>(directory.get_data())[entry % kEntriesPerPage];
+        auto *page = &buffer_manager.fix_page(get_page_id(bucket_page), exclusive);
+        buffer_manager.unfix_page(directory, false);
+        buffer_manager.unfix_page(header_page, false);
+        return page;
+    }
+
+    /// Double the directory.
+    /// The new entries refer to the same buckets as the old ones with the same lower bits.
+    void grow_directory(Header &header) {
+        if (header.global_depth == 64) {
+            throw std::length_error("too many hash collisions");
+        }
+        uint64_t size = 1ull << header.global_depth;
+        auto required_pages = static_cast<uint32_t>((2 * size + kEntriesPerPage - 1) / kEntriesPerPage);
+        if (required_pages > Header::kMaxDirectoryPages) {
+            throw std::length_error("the hash directory is full");
+        }
+        while (header.directory_page_count < required_pages) {
+            header.directory_pages[header.directory_page_count++] = allocate_page(header);
+        }
+        for (uint64_t entry = 0; entry < size; entry += kEntriesPerPage) {
+            /// a directory page is copied at once, or the first page is copied into its second half
+            auto count = std::min(size, kEntriesPerPage);
+            auto& source = buffer_manager.fix_page(get_page_id(header.directory_pages[entry / kEntriesPerPage]), true);
+            auto target_entry = entry + size;
+            if (target_entry / kEntriesPerPage == entry / kEntriesPerPage) {
+                auto *entries = reinterpret_cast<uint64_t*>(source.get_data());
+                std::memcpy(entries + target_entry % kEntriesPerPage, entries, count * sizeof(uint64_t));
+            } else {
+                auto& target = buffer_manager.fix_page(
+                    get_page_id(header.directory_pages[target_entry / kEntriesPerPage]), true);
+                std::memcpy(target.get_data(), source.get_data(), count * sizeof(uint64_t));
+                buffer_manager.unfix_page(target, true);
+            }
+            buffer_manager.unfix_page(source, true);
+        }
+        ++header.global_depth;
+    }
+
+    /// Split a full bucket whose local depth is smaller than the global depth.
+    /// Afterwards, `page` refers to the bucket of the hash value.
+    void split_bucket(Header &header, BufferFrame *&page, uint64_t hash) {
+        auto *bucket = as_bucket(page);
+        auto depth = bucket->local_depth;
+        auto sibling_page = allocate_page(header);
+        auto *sibling = &buffer_manager.fix_page(get_page_id(sibling_page), true);
+        auto *other = as_bucket(sibling);
+        other->local_depth = depth + 1;
+        other->count = 0;
+        bucket->local_depth = depth + 1;
+
+        /// the entries whose bit `depth` is set move to the sibling, both buckets stay sorted
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < bucket->count; ++i) {
+            if ((get_hash(bucket->keys[i]) >> depth) & 1) {
+                append_to_bucket(other, bucket, i);
+            } else {
+                bucket->fingerprints[count] = bucket->fingerprints[i];
+                bucket->keys[count] = bucket->keys[i];
+                bucket->values[count] = bucket->values[i];
+                ++count;
+            }
+        }
+        bucket->count = count;
+
+        /// redirect the directory entries that end with 1 and the lower bits of the bucket
+        uint64_t low_bits = (hash & get_mask(depth)) | (1ull << depth);
+        uint64_t size = 1ull << header.global_depth;
+        for (uint64_t entry = low_bits; entry < size; entry += 2ull << depth) {
+            auto directory_page = header.directory_pages[entry / kEntriesPerPage];
+            auto& directory = buffer_manager.fix_page(get_page_id(directory_page), true);
+            reinterpret_cast<uint64_t*>(directory.get_data())[entry % kEntriesPerPage] = sibling_page;
+            buffer_manager.unfix_page(directory, true);
+        }
+
+        if ((hash >> depth) & 1) {
+            buffer_manager.unfix_page(*page, true);
+            page = sibling;
+        } else {
+            buffer_manager.unfix_page(*sibling, true);
+        }
+    }
+
+    /// Insert an entry into a bucket that is not full.
+    static void insert_into_bucket(Bucket *bucket, const KeyT &key, const ValueT &value, uint32_t fingerprint) {
+        auto position = static_cast<uint32_t>(
+            std::upper_bound(bucket->fingerprints, bucket->fingerprints + bucket->count, fingerprint) -
+            bucket->fingerprints);
+        auto moved = bucket->count - position;
+        std::memmove(&bucket->fingerprints[position + 1], &bucket->fingerprints[position], moved * sizeof(uint32_t));
+        std::memmove(&bucket->keys[position + 1], &bucket->keys[position], moved * sizeof(KeyT));
+        std::memmove(&bucket->values[position + 1], &bucket->values[position], moved * sizeof(ValueT));
+        bucket->fingerprints[position] = fingerprint;
+        std::memcpy(&bucket->keys[position], &key, sizeof(KeyT));
+        std::memcpy(&bucket->values[position], &value, sizeof(ValueT));
+        ++bucket->count;
+    }
+
+    /// Append an entry of another bucket to a bucket whose entries have smaller fingerprints.
+    static void append_to_bucket(Bucket *bucket, const Bucket *other, uint32_t position) {
+        bucket->fingerprints[bucket->count] = other->fingerprints[position];
+        bucket->keys[bucket->count] = other->keys[position];
+        bucket->values[bucket->count] = other->values[position];
+        ++bucket->count;
+    }
+};
+
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_HASH_INDEX_H_
@@ -0,0 +1,155 @@
+#ifndef INCLUDE_MODERNDBS_PAX_PAGE_H_
+#define INCLUDE_MODERNDBS_PAX_PAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "moderndbs/record.h"
+#include "moderndbs/slotted_page.h"
+
+namespace moderndbs {
+
+/// A page that partitions its records by column (PAX).
+/// The page is structured as follows:
+///   1) The header
+///   2) The slots (one per record, with the same encoding as the slots of a SlottedPage)
+///   3) One minipage for the null bitmaps
+///   4) One minipage per fixed-width column, holding the values of all records of the page
+///   5) A heap that grows downwards from the end of the page and holds the variable section
+///      of every record (preceded by the original TID for redirect targets)
+/// The slot of a record references its variable section in the heap.
+struct PaxPage {
+    using Slot = SlottedPage::Slot;
+
+    /// A contiguous part of a record that is stored in a minipage
+    struct Minipage {
+        /// The offset within the record
+        uint32_t record_offset;
+        /// The width of a value
+        uint32_t width;
+        /// The offset of the minipage within the page
+        uint32_t page_offset;
+    };
+
+    /// The position of the minipages, computed once per table.
+    struct Layout {
+        /// Constructor
+        /// @param[in] codec        The codec of the table.
+        /// @param[in] page_size    The size of a buffer frame.
+        Layout(const RecordCodec &codec, uint32_t page_size);
+
+        /// The maximum number of records per page
+        uint16_t capacity;
+        /// The minipages, starting with the null bitmaps followed by the fixed-width columns
+        std::vector<Minipage> minipages;
+        /// The minipage of every column (-1 for varchar columns)
+        std::vector<int32_t> column_minipages;
+        /// The size of the null bitmap and the fixed-width columns of a record
+        uint32_t fixed_size;
+        /// The lower end of the heap
+        uint32_t heap_begin;
+    };
+
+    struct alignas(8) Header {
+        // Constructor
+        Header(const Layout &layout, uint32_t page_size);
+
+        /// Number of currently used slots
+        uint16_t slot_count;
+        /// To speed up the search for a free slot
+        uint16_t first_free_slot;
+        /// Maximum number of slots
+        uint16_t capacity;
+        /// Lower end of the heap
+        uint32_t data_start;
+        /// Space in the heap that would be available after compactification
+        uint32_t free_space;
+        /// Lower bound of the heap
+        uint32_t heap_begin;
+        /// The LSN of the last logged change of the page (0 if it was never logged)
+        uint64_t lsn;
+    };
+
+    /// Constructor.
+    /// @param[in] layout       The minipage layout.
+    /// @param[in] page_size    The size of a buffer frame.
+    PaxPage(const Layout &layout, uint32_t page_size);
+
+    /// Get the data of the page.
+    std::byte *get_data() { return reinterpret_cast<std::byte*>(this); }
+    /// Get the data of the page.
+    const std::byte *get_data() const { return reinterpret_cast<const std::byte*>(this); }
+    /// Get the slots of the page.
+    Slot *get_slots() { return reinterpret_cast<Slot*>(get_data() + sizeof(PaxPage)); }
+    /// Get the slots of the page.
+    const Slot *get_slots() const { return reinterpret_cast<const Slot*>(get_data() + sizeof(PaxPage)); }
+
+    /// Get the value of a fixed-width column.
+    /// @param[in] minipage     The minipage of the column.
+    /// @param[in] slot_id      The slot.
+    const std::byte *get_value(const Minipage &minipage, uint16_t slot_id) const {
+        return get_data() + minipage.page_offset + slot_id * minipage.width;
+    }
+
+    /// Is there a free slot?
+    bool has_free_slot() const { return header.first_free_slot < header.capacity; }
+    /// Get the heap space that is available without compactification.
+    uint32_t get_fragmented_free_space() const { return header.data_start - header.heap_begin; }
+
+    /// Allocate a slot.
+    /// The caller has to ensure that there is a free slot and that heap_size <= header.free_space.
+    /// @param[in] heap_size    The size of the variable section.
+    /// @param[in] page_size    The size of a buffer frame.
+    uint16_t allocate(uint32_t heap_size, uint32_t page_size);
+
+    /// Allocate a specific empty slot, e.g. to restore a record with its TID.
+    /// The caller has to ensure that slot_id < header.capacity and that heap_size <= header.free_space.
+    /// @param[in] slot_id      The slot.
+    /// @param[in] heap_size    The size of the variable section.
+    /// @param[in] page_size    The size of a buffer frame.
+    void allocate_at(uint16_t slot_id, uint32_t heap_size, uint32_t page_size);
+
+    /// Change the size of the variable section of a slot.
+    /// The caller has to ensure that the new size fits on the page.
+    /// @param[in] slot_id      The slot.
+    /// @param[in] heap_size    The new size of the variable section.
+    /// @param[in] page_size    The size of a buffer frame.
+    void relocate(uint16_t slot_id, uint32_t heap_size, uint32_t page_size);
+
+    /// Release the record of a slot and turn it into a redirect.
+    /// @param[in] slot_id      The slot.
+    /// @param[in] target       The TID the record was moved to.
+    void set_redirect(uint16_t slot_id, TID target);
+
+    /// Store the variable section of a redirect on the page again.
+    /// The caller has to ensure that heap_size <= header.free_space.
+    /// @param[in] slot_id      The slot of the redirect.
+    /// @param[in] heap_size    The size of the variable section.
+    /// @param[in] page_size    The size of a buffer frame.
+    void restore(uint16_t slot_id, uint32_t heap_size, uint32_t page_size);
+
+    /// Erase a slot.
+    /// @param[in] slot_id      The slot.
+    void erase(uint16_t slot_id);
+
+    /// Copy a record between a buffer and the page.
+    /// Returns the number of bytes that were copied.
+    /// @param[in] layout       The minipage layout.
+    /// @param[in] slot_id      The slot.
+    /// @param[in] record       The buffer.
+    /// @param[in] size         The size of the buffer.
+    /// @param[in] to_page      Copy from the buffer to the page?
+    uint32_t copy(const Layout &layout, uint16_t slot_id, std::byte *record, uint32_t size, bool to_page);
+
+    /// Compact the heap.
+    /// @param[in] page_size    The size of a buffer frame.
+    /// @param[in] last         A slot whose variable section should end up at the lower end of the heap (optional).
+    void compactify(uint32_t page_size, const Slot *last = nullptr);
+
+    /// The header.
+    Header header;
+};
+
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_PAX_PAGE_H_
@@ -0,0 +1,84 @@
+#ifndef INCLUDE_MODERNDBS_PREDICATE_H_
+#define INCLUDE_MODERNDBS_PREDICATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace moderndbs {
+
+/// A simple predicate on a fixed-width column.
+struct Predicate {
+    /// Comparison class
+    enum Comparison: uint8_t {
+        kEqual,
+        kNotEqual,
+        kLess,
+        kLessEqual,
+        kGreater,
+        kGreaterEqual,
+        /// lower <= value <= upper
+        kBetween,
+    };
+
+    /// The column
+    uint32_t column;
+    /// The comparison
+    Comparison comparison;
+    /// The constant (or the lower bound) for Integer, Timestamp and Numeric columns
+    int64_t lower;
+    /// The upper bound (kBetween only)
+    int64_t upper;
+    /// The constant for Char columns (kEqual and kNotEqual only)
+    std::string string;
+
+    /// Static methods to construct a predicate
+    static Predicate Compare(uint32_t column, Comparison comparison, int64_t value);
+    static Predicate Between(uint32_t column, int64_t lower, int64_t upper);
+    static Predicate Equal(uint32_t column, std::string value);
+    static Predicate NotEqual(uint32_t column, std::string value);
+};
+
+namespace simd {
+
+/// The SIMD kernels evaluate predicates on a page's worth of values and AND their result into a
+/// bitmask with one bit per value. The best kernel for the CPU (AVX2, SSE4.2 or scalar) is chosen at runtime.
+
+/// Evaluate a comparison on contiguous int64 values.
+/// @param[in] values       The values.
+/// @param[in] count        The number of values.
+/// @param[in] comparison   The comparison.
+/// @param[in] lower        The constant (or the lower bound).
+/// @param[in] upper        The upper bound (kBetween only).
+/// @param[in,out] mask     The bitmask ((count + 63) / 64 words).
+void filter_int64(const int64_t *values, uint32_t count, Predicate::Comparison comparison,
+                  int64_t lower, int64_t upper, uint64_t *mask);
+
+/// Scalar version of filter_int64.
+void filter_int64_scalar(const int64_t *values, uint32_t count, Predicate::Comparison comparison,
+                         int64_t lower, int64_t upper, uint64_t *mask);
+
+/// Evaluate (in)equality on fixed-width strings that are stored `width` bytes apart.
+/// @param[in] values       The values.
+/// @param[in] width        The width of a value.
+/// @param[in] count        The number of values.
+/// @param[in] constant     The constant (zero-padded to `width` bytes).
+/// @param[in] equal        Test for equality (or inequality)?
+/// @param[in,out] mask     The bitmask ((count + 63) / 64 words).
+void filter_char(const std::byte *values, uint32_t width, uint32_t count, const std::byte *constant, bool equal,
+                 uint64_t *mask);
+
+/// Convert a bitmask into a selection vector.
+/// Returns the number of selected positions.
+/// @param[in] mask         The bitmask.
+/// @param[in] count        The number of bits.
+/// @param[out] selection   The selected positions (at least `count` entries).
+uint32_t to_selection_vector(const uint64_t *mask, uint32_t count, uint16_t *selection);
+
+/// Get the name of the kernels that are used on this CPU ("avx2", "sse4.2" or "scalar").
+const char *get_kernel_name();
+
+}  // namespace simd
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_PREDICATE_H_
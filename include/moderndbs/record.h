@@ -0,0 +1,231 @@
+#ifndef INCLUDE_MODERNDBS_RECORD_H_
+#define INCLUDE_MODERNDBS_RECORD_H_
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include "moderndbs/schema.h"
+
+namespace moderndbs {
+
+/// A single column value.
+/// Integer, Timestamp and Numeric values are represented as int64_t (a Numeric is stored
+/// as scaled fixed-point value, i.e. 12.34 with precision 2 is stored as 1234).
+/// Char and Varchar values are represented as strings.
+/// std::monostate represents NULL.
+using Value = std::variant<std::monostate, int64_t, std::string>;
+
+/// C++ representation of the values of a column type.
+template <schema::Type::Class C> struct ColumnTraits;
+template <> struct ColumnTraits<schema::Type::kInteger> { using value_type = int64_t; };
+template <> struct ColumnTraits<schema::Type::kTimestamp> { using value_type = int64_t; };
+template <> struct ColumnTraits<schema::Type::kNumeric> { using value_type = int64_t; };
+template <> struct ColumnTraits<schema::Type::kChar> { using value_type = std::string_view; };
+template <> struct ColumnTraits<schema::Type::kVarchar> { using value_type = std::string_view; };
+
+/// Hash a byte string with 64-bit FNV-1a and the finalizer of MurmurHash3.
+/// Unlike std::hash, the value does not depend on the standard library, so it may decide what is stored on disk.
+inline uint64_t hash_bytes(const std::byte *data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ std::to_integer<uint64_t>(data[i])) * 1099511628211ull;
+    }
+    /// FNV-1a spreads the last bytes poorly over the upper bits
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/// A fixed-size key that is compared bytewise, e.g. a primary key encoded by RecordCodec::encode_key().
+/// N has to be at least the size of the encoded key, the remaining bytes stay zero.
+template <size_t N>
+struct IndexKey {
+    /// The encoded key
+    std::array<std::byte, N> bytes{};
+
+    /// Compare two keys.
+    bool operator<(const IndexKey &other) const { return std::memcmp(bytes.data(), other.bytes.data(), N) < 0; }
+    /// Compare two keys.
+    bool operator==(const IndexKey &other) const { return bytes == other.bytes; }
+
+    /// Hash function for hash indexes
+    struct Hash {
+        uint64_t operator()(const IndexKey &key) const { return hash_bytes(key.bytes.data(), N); }
+    };
+};
+
+/// Encodes the tuples of a table into untyped records and back.
+/// The codec is created once per table and precomputes the offsets of all columns.
+/// A record is structured as follows:
+///   1) The null bitmap (one bit per column, set if the column is NULL)
+///   2) The fixed-width area, every Integer, Timestamp, Numeric (8 bytes each) and
+///      Char(n) column (n bytes, zero-padded) at a precomputed offset
+///   3) The varchar offset table, one uint16_t per Varchar column holding the end offset of
+///      its value relative to the beginning of the varchar payload
+///   4) The varchar payload
+/// Everything after 2) is called the variable section of a record. Its offsets are relative
+/// to its own start, so it can be moved independently of the fixed-width area.
+class RecordCodec {
+    public:
+    /// The precomputed layout of a column
+    struct ColumnLayout {
+        /// The type class
+        schema::Type::Class tclass;
+        /// The offset of the value within the record (fixed-width columns only)
+        uint32_t offset;
+        /// The width of the value (fixed-width columns) or the maximum length (varchars)
+        uint32_t width;
+        /// The index within the varchar offset table (varchar columns only)
+        uint16_t var_index;
+    };
+
+    /// Constructor
+    /// @param[in] table            The table whose tuples should be encoded.
+    explicit RecordCodec(const schema::Table &table);
+    /// The column lookup refers to the names of the codec, so it must not be copied
+    RecordCodec(const RecordCodec&) = delete;
+    RecordCodec &operator=(const RecordCodec&) = delete;
+
+    /// Get the number of columns.
+    uint32_t get_column_count() const { return static_cast<uint32_t>(columns.size()); }
+    /// Get the layout of a column.
+    const ColumnLayout &get_column(uint32_t column) const { return columns[column]; }
+    /// Get the index of a column by name.
+    /// Returns get_column_count() if there is no such column.
+    uint32_t find_column(std::string_view name) const;
+    /// Get the size of the null bitmap.
+    uint32_t get_null_bytes() const { return null_bytes; }
+    /// Get the size of the null bitmap and the fixed-width area, i.e. the offset of the variable section.
+    uint32_t get_fixed_size() const { return fixed_size; }
+    /// Get the number of varchar columns.
+    uint32_t get_varchar_count() const { return varchar_count; }
+    /// Is every column of the table fixed-width? (Every record then has get_fixed_size() bytes)
+    bool is_fixed_width() const { return varchar_count == 0; }
+    /// Get the maximum size of an encoded record.
+    uint32_t get_max_size() const { return max_size; }
+    /// Get the number of primary key columns.
+    uint32_t get_key_column_count() const { return static_cast<uint32_t>(key_columns.size()); }
+    /// Get the size of an encoded primary key.
+    uint32_t get_key_size() const { return key_size; }
+
+    /// Get the size of an encoded tuple.
+    /// @param[in] tuple            The tuple.
+    uint32_t get_encoded_size(const std::vector<Value> &tuple) const;
+    /// Encode a tuple.
+    /// Throws a RecordCodecError if the tuple does not match the table.
+    /// Returns the size of the encoded record.
+    /// @param[in] tuple            The tuple.
+    /// @param[out] record          The buffer that is written.
+    /// @param[in] capacity         The capacity of the buffer.
+    uint32_t encode(const std::vector<Value> &tuple, std::byte *record, uint32_t capacity) const;
+    /// Encode a tuple into a freshly allocated buffer.
+    /// @param[in] tuple            The tuple.
+    std::vector<std::byte> encode(const std::vector<Value> &tuple) const;
+    /// Decode a record.
+    /// @param[in] record           The encoded record.
+    std::vector<Value> decode(const std::byte *record) const;
+    /// Decode a single column without materializing the tuple.
+    /// @param[in] record           The encoded record.
+    /// @param[in] column           The column.
+    Value get_value(const std::byte *record, uint32_t column) const;
+    /// Get the size of an encoded record.
+    /// @param[in] record           The encoded record.
+    uint32_t get_record_size(const std::byte *record) const;
+
+    /// Encode the primary key of a tuple.
+    /// Encoded keys have get_key_size() bytes and compare like the key values when compared with memcmp:
+    /// integers are stored big-endian with a flipped sign bit, strings are zero-padded to their maximum length.
+    /// Throws a RecordCodecError if a key value is NULL or does not match its column.
+    /// @param[in] key              The values of the primary key columns.
+    /// @param[out] encoded_key     The buffer that is written.
+    void encode_key(const std::vector<Value> &key, std::byte *encoded_key) const;
+    /// Encode the primary key of a record.
+    /// @param[in] record           The encoded record.
+    /// @param[out] encoded_key     The buffer that is written.
+    void encode_key(const std::byte *record, std::byte *encoded_key) const;
+    /// Encode the primary key of a record that might be too short for its key, e.g. a record on a page.
+    /// Returns false if a key column is missing from the record or NULL.
+    /// @param[in] record           The encoded record.
+    /// @param[in] size             The size of the record.
+    /// @param[out] encoded_key     The buffer that is written.
+    bool try_encode_key(const std::byte *record, uint32_t size, std::byte *encoded_key) const;
+
+    /// Is a column NULL?
+    /// @param[in] record           The encoded record.
+    /// @param[in] column           The column.
+    bool is_null(const std::byte *record, uint32_t column) const {
+        return (std::to_integer<uint8_t>(record[column >> 3]) >> (column & 7)) & 1;
+    }
+
+    /// Read a single column with a statically known type.
+    /// The caller has to ensure that the column has type class C and is not NULL.
+    /// @param[in] record           The encoded record.
+    /// @param[in] column           The column.
+    template <schema::Type::Class C>
+    typename ColumnTraits<C>::value_type get(const std::byte *record, uint32_t column) const {
+        const auto &layout = columns[column];
+        assert(layout.tclass == C);
+        if constexpr (C == schema::Type::kVarchar) {
+            auto [begin, end] = get_varchar_bounds(record, layout.var_index);
+            return std::string_view(reinterpret_cast<const char *>(record) + begin, end - begin);
+        } else if constexpr (C == schema::Type::kChar) {
+            auto data = reinterpret_cast<const char *>(record) + layout.offset;
+            return std::string_view(data, strnlen(data, layout.width));
+        } else {
+            int64_t value;
+            std::memcpy(&value, record + layout.offset, sizeof(value));
+            return value;
+        }
+    }
+
+    private:
+    /// Encode a single primary key column.
+    /// Returns the position behind the encoded value.
+    std::byte *encode_key_column(uint32_t column, const Value &value, std::byte *encoded_key) const;
+
+    /// Get the begin and end offset of a varchar value within the record.
+    std::pair<uint32_t, uint32_t> get_varchar_bounds(const std::byte *record, uint16_t var_index) const {
+        auto table = record + fixed_size;
+        uint16_t begin = 0;
+        uint16_t end;
+        if (var_index > 0) {
+            std::memcpy(&begin, table + (var_index - 1) * sizeof(uint16_t), sizeof(uint16_t));
+        }
+        std::memcpy(&end, table + var_index * sizeof(uint16_t), sizeof(uint16_t));
+        uint32_t payload = fixed_size + varchar_count * sizeof(uint16_t);
+        return { payload + begin, payload + end };
+    }
+
+    /// The column names
+    std::vector<std::string> names;
+    /// The columns by name
+    std::unordered_map<std::string_view, uint32_t> column_ids;
+    /// The column layouts
+    std::vector<ColumnLayout> columns;
+    /// The size of the null bitmap
+    uint32_t null_bytes;
+    /// The size of the null bitmap and the fixed-width area
+    uint32_t fixed_size;
+    /// The number of varchar columns
+    uint32_t varchar_count;
+    /// The maximum size of a record
+    uint32_t max_size;
+    /// The primary key columns
+    std::vector<uint32_t> key_columns;
+    /// The size of an encoded primary key
+    uint32_t key_size = 0;
+};
+
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_RECORD_H_
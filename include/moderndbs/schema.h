@@ -59,16 +59,29 @@ struct Column {
 };
 
 struct Table {
+    /// Storage layout of the records
+    enum Layout: uint8_t {
+        /// Row-wise slotted pages
+        kRowStore,
+        /// Column-partitioned pages (PAX)
+        kPAX,
+    };
+
     /// Name of the table
     const std::string id;
     /// Columns
     const std::vector<Column> columns;
     /// Primary key
     const std::vector<std::string> primary_key;
+    /// Storage layout
+    const Layout layout;
 
     /// Constructor
-    Table(std::string id, std::vector<Column> columns, std::vector<std::string> primary_key)
-        : id(std::move(id)), columns(std::move(columns)), primary_key(std::move(primary_key)) {}
+    Table(std::string id, std::vector<Column> columns, std::vector<std::string> primary_key, Layout layout = kRowStore)
+        : id(std::move(id)), columns(std::move(columns)), primary_key(std::move(primary_key)), layout(layout) {}
+
+    /// Get layout name
+    const char *layout_name() const;
 };
 
 struct Schema {
@@ -1,8 +1,23 @@
 #ifndef INCLUDE_MODERNDBS_SEGMENT_H_
 #define INCLUDE_MODERNDBS_SEGMENT_H_
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "moderndbs/buffer_manager.h"
+#include "moderndbs/file.h"
+#include "moderndbs/fixed_page.h"
+#include "moderndbs/pax_page.h"
+#include "moderndbs/predicate.h"
+#include "moderndbs/record.h"
 #include "moderndbs/slotted_page.h"
 #include "moderndbs/schema.h"
 
@@ -24,16 +39,63 @@ class Segment {
     BufferManager& buffer_manager;
 };
 
+/// The segments that store the records of a table
+struct TableSegments {
+    /// The segment id of the slotted pages
+    uint16_t sp_segment_id = 0;
+    /// The segment id of the free-space inventory
+    uint16_t fsi_segment_id = 0;
+    /// The segment id of the zone maps
+    uint16_t zone_map_segment_id = 0;
+    /// The segment id of the Bloom filter
+    uint16_t bloom_filter_segment_id = 0;
+    /// The number of slotted pages.
+    /// Threads that create a slotted page increment it concurrently.
+    std::atomic<uint64_t> sp_count = 0;
+    /// The number of slotted pages that records may have been forwarded from (0 if none were).
+    /// The vacuum forwards the records of the pages that it removes, the segment then finds them when it is opened.
+    std::atomic<uint64_t> forward_limit = 0;
+
+    TableSegments() = default;
+    TableSegments(const TableSegments &other) { *this = other; }
+    TableSegments &operator=(const TableSegments &other) {
+        sp_segment_id = other.sp_segment_id;
+        fsi_segment_id = other.fsi_segment_id;
+        zone_map_segment_id = other.zone_map_segment_id;
+        bloom_filter_segment_id = other.bloom_filter_segment_id;
+        sp_count = other.sp_count.load();
+        forward_limit = other.forward_limit.load();
+        return *this;
+    }
+};
+
 class SchemaSegment: public Segment {
     friend class SPSegment;
     friend class FSISegment;
 
     protected:
+    /// Build the lookup tables and record layouts of the tables.
+    void index_tables();
+    /// Get the segments that are shared by the schema followed by those of every table.
+    std::vector<TableSegments> collect_segments() const;
+
     /// schema of SchemaSegment
     std::unique_ptr<Schema> schema;
-    uint16_t fsi_segment_id = 0;
-    uint16_t sp_segment_id = 0;
-    uint64_t number_of_sp = 0;
+    /// The segments that are shared by the whole schema
+    TableSegments segments;
+    /// The segments of every table.
+    /// They are allocated individually, so that they keep their address when the schema changes.
+    std::vector<std::unique_ptr<TableSegments>> table_segments;
+    /// The ids of the tables by name
+    std::unordered_map<std::string_view, uint32_t> table_ids;
+    /// The record layout of every table
+    std::vector<std::unique_ptr<RecordCodec>> codecs;
+    /// The length of the serialized schema on disk (in #bytes)
+    uint64_t schema_size = 0;
+    /// The segments when the header was stored last
+    std::vector<TableSegments> stored_segments;
+    /// Did the schema change since it was written last?
+    bool schema_changed = false;
 
     public:
     /// Constructor
@@ -41,7 +103,12 @@ class SchemaSegment: public Segment {
     /// @param[in] buffer_manager   The buffer manager that should be used by the schema segment.
     SchemaSegment(uint16_t segment_id, BufferManager& buffer_manager);
 
+    /// Destructor
+    /// Stores the header if it changed.
+    ~SchemaSegment();
+
     /// Set the schema of the schema segment
+    /// Tables that were part of the previous schema keep their segments.
     void set_schema(std::unique_ptr<schema::Schema> new_schema);
 
     /// Get the schema of the schema segment
@@ -54,6 +121,13 @@ class SchemaSegment: public Segment {
     /// Get the segment id of the free-space inventory associated with the schema.
     uint16_t get_fsi_segment();
 
+    /// Set the segment id of the zone maps.
+    /// @param[in] segment_id   Id of the zone maps that are associated with the schema.
+    void set_zone_map_segment(uint16_t segment_id);
+
+    /// Get the segment id of the zone maps associated with the schema.
+    uint16_t get_zone_map_segment();
+
     /// Set the segment id of the slotted pages.
     /// @param[in] segment_id   Id of the slotted pages that are associated with the schema.
     void set_sp_segment(uint16_t segment_id);
@@ -64,31 +138,93 @@ class SchemaSegment: public Segment {
     /// Get the number of slotted pages.
     uint64_t get_sp_count();
 
+    /// Increase the number of slotted pages.
+    /// This only changes the count in memory, it is stored with the header at the next checkpoint.
     void increase_sp_count();
 
+    /// A table or column that does not exist
+    static constexpr uint32_t kNotFound = ~0u;
+
+    /// Get the id of a table (its index in the schema).
+    /// Returns kNotFound if there is no such table.
+    /// @param[in] name         The name of the table.
+    uint32_t find_table(std::string_view name) const;
+
+    /// Get the index of a column.
+    /// Returns kNotFound if there is no such column.
+    /// @param[in] table        The id of the table.
+    /// @param[in] name         The name of the column.
+    uint32_t find_column(uint32_t table, std::string_view name) const;
+
+    /// Get the record layout of a table.
+    /// @param[in] table        The id of the table.
+    const RecordCodec &get_codec(uint32_t table) const { return *codecs[table]; }
+
+    /// Get the segments that store the records of a table.
+    /// Every table of the schema has its own slotted pages, free-space inventory, zone maps and Bloom filter.
+    /// Throws std::invalid_argument if the table is not part of the schema.
+    /// @param[in] table        The table, nullptr for the segments that are shared by the whole schema.
+    TableSegments &get_segments(const schema::Table *table);
+
     /// Read the schema from disk.
-    /// The schema segment should be structured as follows:
-    ///   1) The segment id of the slotted pages segment
-    ///   2) The segment id of the free-space inventory segment
-    ///   3) The size of the slotted pages segment (in #pages)
-    ///   4) The length of the serialized schema (in #bytes)
-    ///   5) The serialized schema
+    /// The schema segment starts with the header:
+    ///   1) A magic number and the version of the catalog format
+    ///   2) The number of tables
+    ///   3) The length of the serialized schema (in #bytes)
+    ///   4) The segment ids and the number of slotted pages that are shared by the schema and of every table
+    /// The serialized schema follows the header, it is a binary format of fixed-width integers and
+    /// length-prefixed strings.
     ///
-    /// Note that the serialized schema *could* be larger than 1 page.
+    /// The schema is parsed directly from the bytes on disk without an intermediate representation.
+    /// Throws a SchemaParseError if the segment is corrupt or has an unknown version.
     void read();
     /// Write the schema to disk.
-    /// Note that we need to track the number of slotted pages in the schema segment.
-    /// For this assignment, you can simply write out the schema segment whenever you allocate a slotted page.
+    /// The schema is only rewritten if it changed.
     void write();
+    /// Store the header and a changed schema in their pages.
+    /// The header changes whenever a slotted page is allocated, so it is not written to disk right away.
+    /// The buffer manager writes the pages back when they are evicted or flushed.
+    void checkpoint();
+
+    /// Export the schema as JSON.
+    /// The JSON is meant for debugging only, it is never read back.
+    std::string to_json() const;
 };
 
 class FSISegment: public Segment {
     public:
+    /// How free space is mapped to the 16 classes
+    enum Encoding: uint8_t {
+        /// Every class covers page_size / 16 bytes
+        kLinear,
+        /// The classes halve every two steps (page_size / sqrt(2), page_size / 2, ...), which resolves small
+        /// amounts of free space much better
+        kLogarithmic,
+    };
+
+    /// How a page is chosen among those with enough free space
+    enum FitPolicy: uint8_t {
+        /// The first page
+        kFirstFit,
+        /// A page with the smallest class that is large enough
+        kBestFit,
+        /// The first page after the page that was found last
+        kNextFit,
+    };
+
     /// Constructor
     /// @param[in] segment_id       Id of the segment that the fsi is stored in.
     /// @param[in] buffer_manager   The buffer manager that should be used by the fsi segment.
     /// @param[in] schema           The schema segment that the fsi belongs to.
-    FSISegment(uint16_t segment_id, BufferManager &buffer_manager, SchemaSegment &schema);
+    /// @param[in] policy           The fit policy.
+    /// @param[in] encoding         The encoding of the free space (has to be the same whenever the segment is opened).
+    /// @param[in] table            The table whose slotted pages are tracked (optional).
+    ///                             Without a table, the fsi tracks the slotted pages that are shared by the schema.
+    FSISegment(uint16_t segment_id, BufferManager &buffer_manager, SchemaSegment &schema,
+               FitPolicy policy = kNextFit, Encoding encoding = kLinear, const schema::Table *table = nullptr);
+
+    /// Destructor
+    ~FSISegment();
 
     /// Update a the free space of a page.
     /// The free space inventory encodes the free space of a target page in 4 bits.
@@ -99,34 +235,275 @@ class FSISegment: public Segment {
     void update(uint64_t target_page, uint32_t free_space);
 
     /// Find a page that has enough free space.
+    /// The pages are organized in a tree whose inner nodes store the free-space classes that occur below them,
+    /// so find and update are logarithmic in the number of pages for every fit policy.
+    /// update and find are thread-safe: entries are changed with compare-and-swap and every summary is
+    /// recomputed until it is stable, so no lock is needed.
     /// @param[in] free_space       The required space.
     std::pair<bool, uint64_t> find(uint32_t required_space);
 
-    std::vector<uint8_t> bitmap;
+    /// Get the segments of the table whose slotted pages are tracked.
+    TableSegments &get_segments() { return segments; }
+
+    protected:
+    /// No page has enough space
+    static constexpr uint64_t kNoPage = ~0ull;
+
+    /// Get the largest class that guarantees at most `free_space` bytes.
+    uint8_t encode(uint32_t free_space) const;
+    /// Get the smallest class that guarantees at least `required_space` bytes (16 if there is none).
+    uint8_t encode_required(uint32_t required_space) const;
+    /// Make sure that the summary covers a leaf page.
+    void grow(uint64_t leaf);
+    /// Get an entry of the summary (0 if its chunk does not exist yet).
+    uint32_t load(size_t level, uint64_t index) const;
+    /// Get an entry of the summary, allocating its chunk if necessary.
+    std::atomic<uint32_t> &get(size_t level, uint64_t index);
+    /// Propagate a changed entry of the summary towards the root.
+    void propagate(uint64_t leaf);
+    /// Find the first leaf page at or after `begin` that might have a page with one of the classes.
+    uint64_t find_leaf(uint64_t begin, uint16_t classes) const;
+    /// Find the first slotted page at or after `begin` with one of the classes.
+    uint64_t find_from(uint64_t begin, uint16_t classes, uint64_t page_count);
+
+    /// A chunk of entries of the summary
+    using Chunk = std::atomic<uint32_t>;
+    /// A directory of chunks
+    using Directory = std::atomic<Chunk*>;
+
+    /// A level of the summary, stored in chunks that are allocated on demand.
+    /// The chunks are found through directories that are allocated on demand as well, so an empty segment only
+    /// needs the small array of directory pointers.
+    struct Level {
+        /// The number of entries
+        uint64_t size;
+        /// The directories
+        std::unique_ptr<std::atomic<Directory*>[]> directories;
+    };
+
+    /// The segments of the table
+    TableSegments &segments;
+    /// The fit policy
+    FitPolicy policy;
+    /// The smallest free space of every class
+    std::array<uint32_t, 16> boundaries;
+    /// The number of slotted pages per leaf page
+    uint64_t entries_per_page;
+    /// The number of groups of 64 entries per leaf page
+    uint64_t groups_per_page;
+    /// The in-memory summary of the leaf pages, from the bottom to the root.
+    /// levels[0] stores a bitmask of the classes on every leaf page, every further level combines the masks of 64
+    /// entries of the level below. The tree has a fixed height that covers 2^40 slotted pages.
+    /// Leaf pages that were not visited since the segment was opened might have any class until they are read.
+    std::vector<Level> levels;
+    /// The number of leaf pages that the summary covers
+    std::atomic<uint64_t> leaf_count{0};
+    /// The page that was found last
+    std::atomic<uint64_t> cursor{0};
+};
+
+class ZoneMapSegment: public Segment {
+    public:
+    /// The values of a column on a page
+    struct Zone {
+        /// The smallest value (if value_count > 0)
+        int64_t min;
+        /// The largest value (if value_count > 0)
+        int64_t max;
+        /// The number of NULL values
+        uint32_t null_count;
+        /// The number of non-NULL values
+        uint32_t value_count;
+    };
+
+    /// Constructor
+    /// @param[in] segment_id       Id of the segment that the zone maps are stored in.
+    /// @param[in] buffer_manager   The buffer manager that should be used by the zone map segment.
+    /// @param[in] schema           The schema segment that the zone maps belong to.
+    /// @param[in] table            The table whose records are summarized.
+    ZoneMapSegment(uint16_t segment_id, BufferManager &buffer_manager, SchemaSegment &schema, const schema::Table &table);
+
+    /// Get the columns that have zones (Integer, Timestamp and Numeric columns).
+    const std::vector<uint32_t> &get_columns() const { return columns; }
+
+    /// Reset the zones of a (new or empty) slotted page.
+    /// @param[in] target_page      The (slotted) page number.
+    void reset(uint64_t target_page);
+
+    /// Add the values of a record to the zones of a page.
+    /// `values` and `nulls` hold one entry per column returned by get_columns().
+    /// @param[in] target_page      The (slotted) page number.
+    /// @param[in] values           The values.
+    /// @param[in] nulls            Which values are NULL.
+    void add(uint64_t target_page, const int64_t *values, const bool *nulls);
+
+    /// Remove the values of a record from the zones of a page.
+    /// Only the counts are updated, min and max stay conservative until the page is reset.
+    /// @param[in] target_page      The (slotted) page number.
+    /// @param[in] values           The values.
+    /// @param[in] nulls            Which values are NULL.
+    void remove(uint64_t target_page, const int64_t *values, const bool *nulls);
+
+    /// Get the zone of a column on a page.
+    /// Returns false if the page has no zones.
+    /// @param[in] target_page      The (slotted) page number.
+    /// @param[in] column           The column.
+    std::pair<bool, Zone> get_zone(uint64_t target_page, uint32_t column);
+
+    /// Can a page contain records that satisfy a conjunction of predicates?
+    /// @param[in] target_page      The (slotted) page number.
+    /// @param[in] predicates       The predicates.
+    bool may_match(uint64_t target_page, const std::vector<Predicate> &predicates);
+
+    protected:
+    /// Fix the page that holds the zones of a slotted page.
+    /// Returns the frame and the offset of the entry.
+    std::pair<BufferFrame*, size_t> fix_entry(uint64_t target_page, bool exclusive);
+
+    /// The zone-mapped columns
+    std::vector<uint32_t> columns;
+    /// The index of every column within the zones of a page (-1 if the column has no zone)
+    std::vector<int32_t> zone_indexes;
+    /// The size of the entry of a slotted page
+    size_t entry_size;
+    /// The number of entries per page
+    size_t entries_per_page;
+};
+
+/// A blocked Bloom filter over the primary keys of a table.
+/// Every key sets one bit in each of the eight 64-bit words of a single 64-byte block, so a probe touches one cache
+/// line. The filter is sized once for an expected number of keys and a false-positive rate; it answers false
+/// positives more often if it holds more keys, until it is rebuilt. Keys are never removed.
+class BloomFilterSegment: public Segment {
+    public:
+    /// The size of a block
+    static constexpr uint32_t kBlockSize = 64;
+    /// The number of 64-bit words of a block
+    static constexpr uint32_t kBlockWords = kBlockSize / sizeof(uint64_t);
+
+    /// Constructor
+    /// Opens the filter that is stored in the segment or creates an empty one.
+    /// @param[in] segment_id           Id of the segment that the filter is stored in.
+    /// @param[in] buffer_manager       The buffer manager that should be used by the filter.
+    /// @param[in] schema               The schema segment that the filter belongs to.
+    /// @param[in] table                The table whose keys are filtered.
+    /// @param[in] expected_keys        The number of keys that the filter is sized for.
+    /// @param[in] false_positive_rate  The false-positive rate with the expected number of keys.
+    BloomFilterSegment(uint16_t segment_id, BufferManager &buffer_manager, SchemaSegment &schema,
+                       const schema::Table &table, uint64_t expected_keys, double false_positive_rate = 0.01);
+
+    /// Get the number of blocks that a filter needs.
+    /// @param[in] expected_keys        The number of keys.
+    /// @param[in] false_positive_rate  The false-positive rate.
+    static uint64_t get_block_count(uint64_t expected_keys, double false_positive_rate);
+    /// Get the number of blocks of the filter.
+    uint64_t get_block_count() const { return block_count; }
+
+    /// Add a key.
+    /// @param[in] key          The encoded key.
+    /// @param[in] size         The size of the key.
+    void add(const std::byte *key, uint32_t size);
+    /// Might the filter contain a key?
+    /// @param[in] key          The encoded key.
+    /// @param[in] size         The size of the key.
+    bool may_contain(const std::byte *key, uint32_t size) const;
+    /// Remove all keys.
+    void clear();
+
+    /// Start to build the filter again in memory. Keys that are added meanwhile are added to both filters.
+    void begin_rebuild();
+    /// Add a key to the filter that is built again (does nothing if there is no rebuild).
+    /// @param[in] key          The encoded key.
+    /// @param[in] size         The size of the key.
+    void add_rebuilt(const std::byte *key, uint32_t size);
+    /// Replace the filter with the one that was built again, a page of blocks at a time.
+    /// Lookups see either block, both contain the keys that were added, so they never miss a key.
+    void end_rebuild();
+    /// Is the filter built again?
+    bool is_rebuilding() const { return rebuilding; }
+
+    /// Does a block contain all bits of a hash value? Uses AVX2 if the CPU supports it.
+    /// @param[in] block        The block.
+    /// @param[in] hash         The lower 32 bits of the hash value.
+    static bool block_contains(const std::byte *block, uint32_t hash);
+    /// Scalar version of block_contains.
+    static bool block_contains_scalar(const std::byte *block, uint32_t hash);
+
+    protected:
+    /// Fix the page that holds a block.
+    /// Returns the frame and the offset of the block.
+    std::pair<BufferFrame*, size_t> fix_block(uint64_t block, bool exclusive) const;
+
+    /// The number of blocks
+    uint64_t block_count;
+    /// The number of blocks per page
+    uint64_t blocks_per_page;
+    /// Is the filter built again?
+    std::atomic<bool> rebuilding = false;
+    /// The words of the filter that is built again (empty if there is no rebuild)
+    std::vector<uint64_t> rebuilt;
+    /// Protects the filter that is built again (it is acquired while a block is latched)
+    std::mutex rebuild_latch;
 };
 
+class WALSegment;
+
+/// The slotted pages of a table.
+/// All operations are thread-safe, readers latch pages shared and writers exclusively.
 class SPSegment: public moderndbs::Segment {
     public:
+    /// The format of the pages of a slotted pages segment
+    enum PageFormat: uint8_t {
+        /// Row-wise slotted pages
+        kSlotted,
+        /// Column-partitioned pages (PAX)
+        kPAX,
+        /// Row-wise pages without slots for tables whose records all have the same size
+        kFixed,
+    };
+
     /// Constructor
     /// @param[in] segment_id       Id of the segment that the schema is stored in.
     /// @param[in] buffer_manager   The buffer manager that should be used by the slotted pages segment.
     /// @param[in] schema           The schema segment that the fsi belongs to.
     /// @param[in] fsi              The free-space inventory that is associated with the schema.
-    SPSegment(uint16_t segment_id, BufferManager &buffer_manager, SchemaSegment &schema, FSISegment &fsi);
+    /// @param[in] table            The table whose records are stored in the segment (optional).
+    ///                             The table determines the page format.
+    /// @param[in] zone_maps        The zone maps of the table (optional).
+    /// @param[in] bloom_filter     The Bloom filter over the primary keys of the table (optional).
+    ///                             Records must be written completely at once then.
+    /// @param[in] wal              The write-ahead log that the changes are logged in (optional).
+    SPSegment(uint16_t segment_id, BufferManager &buffer_manager, SchemaSegment &schema, FSISegment &fsi,
+              const schema::Table *table = nullptr, ZoneMapSegment *zone_maps = nullptr,
+              BloomFilterSegment *bloom_filter = nullptr, WALSegment *wal = nullptr);
 
     /// Allocate a new record.
     /// Returns a TID that stores the page as well as the slot of the allocated record.
     /// The allocate method should use the free-space inventory to find a suitable page quickly.
+    /// Every thread keeps inserting into its own page and only asks the free-space inventory once it is full.
     /// @param[in] size         The size that should be allocated.
     TID allocate(uint32_t size) ;
 
     /// Read the data of the record into a buffer.
+    /// Returns the number of bytes that were read.
     /// @param[in] tid          The TID that identifies the record.
     /// @param[in] record       The buffer that is read into.
     /// @param[in] capacity     The capacity of the buffer that is read into.
     uint32_t read(TID tid, std::byte *record, uint32_t capacity) const;
 
+    /// Read a batch of records, e.g. the TIDs of an index probe.
+    /// The TIDs are visited in page order, so that every page is fixed once while the next pages are prefetched.
+    /// Redirected records are read in a second pass, again in page order.
+    /// The TIDs may be in any order and may contain duplicates.
+    /// @param[in] tids         The TIDs that identify the records.
+    /// @param[in] count        The number of TIDs.
+    /// @param[out] records     The output arena, record i is read to `records + i * capacity`.
+    /// @param[in] capacity     The capacity of every record in the arena.
+    /// @param[out] sizes       The number of bytes that were read for every record.
+    void read_batch(const TID *tids, size_t count, std::byte *records, uint32_t capacity, uint32_t *sizes) const;
+
     /// Write a record.
+    /// Returns the number of bytes that were written.
     /// @param[in] tid          The TID that identifies the record.
     /// @param[in] record       The buffer that is written.
     /// @param[in] record_size  The capacity of the buffer that is written.
@@ -135,6 +512,9 @@ class SPSegment: public moderndbs::Segment {
     /// Resize a record.
     /// Resize should first check whether the new size still fits on the page.
     /// If not, it should create a redirect record.
+    /// A record is redirected at most once, and it returns to its page when it fits there again
+    /// (which is also checked when it is written).
+    /// Records of fixed-width tables cannot grow beyond their size.
     /// @param[in] tid          The TID that identifies the record.
     /// @param[in] new_length   The new length of the record.
     void resize(TID tid, uint32_t new_length);
@@ -143,11 +523,521 @@ class SPSegment: public moderndbs::Segment {
     /// @param[in] tid          The TID that identifies the record.
     void erase(TID tid);
 
+    /// Scan a fixed-width column of the table.
+    /// Calls the callback with the TID and the encoded value of every record (nullptr if the value is NULL).
+    /// On PAX pages, only the minipage of the column is accessed.
+    /// @param[in] column       The column.
+    /// @param[in] callback     The callback.
+    void scan_column(uint32_t column, const std::function<void(TID, const std::byte*)> &callback) const;
+
+    /// Find the records that satisfy a conjunction of predicates on fixed-width columns.
+    /// The predicates are evaluated on a page's worth of values at once using SIMD kernels.
+    /// Pages whose zone maps exclude a match are skipped without fixing them.
+    /// Returns the TIDs of the matching records.
+    /// @param[in] predicates   The predicates.
+    std::vector<TID> scan(const std::vector<Predicate> &predicates) const;
+
+    /// Might the table contain a record with a primary key?
+    /// Returns false only if there is no such record, without accessing the slotted pages.
+    /// Returns true if the table has no Bloom filter.
+    /// @param[in] key          The values of the primary key columns.
+    bool may_contain(const std::vector<Value> &key) const;
+
+    /// Rebuild the Bloom filter from the records, e.g. after records were erased.
+    /// Can run concurrently with all other operations, lookups do not miss a key meanwhile.
+    void rebuild_bloom_filter();
+
+    /// Counters of redirected records since the segment was opened
+    struct RedirectStatistics {
+        /// The number of records that were moved off their page
+        uint64_t moved_records = 0;
+        /// The number of records that returned to their page
+        uint64_t returned_records = 0;
+        /// The number of reads and writes that fixed a second page to follow a redirect
+        uint64_t redirected_accesses = 0;
+    };
+
+    /// Get the counters of redirected records.
+    RedirectStatistics get_redirect_statistics() const;
+
+    /// Count the records that are currently redirected (or forwarded) by scanning the pages.
+    uint64_t count_redirected_records() const;
+
+    /// The work done by the vacuum
+    struct VacuumStatistics {
+        /// The number of pages that were visited
+        uint64_t visited_pages = 0;
+        /// The number of records that were moved back to their page or to a lower page
+        uint64_t moved_records = 0;
+        /// The number of fragmented pages that were compacted
+        uint64_t compacted_pages = 0;
+        /// The number of empty pages that were removed from the end of the segment
+        uint64_t truncated_pages = 0;
+        /// The number of records whose page was removed, they are found through their TIDs in a map
+        uint64_t forwarded_records = 0;
+        /// The number of times that the Bloom filter was rebuilt
+        uint64_t rebuilt_filters = 0;
+    };
+
+    /// Reorganize some pages, continuing where the last call stopped and walking towards the first page.
+    /// Redirected records return to their page if possible or move to lower pages, the records of a sparse last
+    /// page move to lower pages as well, fragmented pages are compacted, and pages at the end of the segment that
+    /// are empty or only hold redirects are removed from the file. The records of removed pages are forwarded:
+    /// a map from their TIDs to where they are replaces the redirects, so TIDs stay valid. A pass over the segment
+    /// ends with a rebuild of the Bloom filter if records were erased, which drops their keys.
+    /// Can run concurrently with all other operations (but not with itself).
+    /// @param[in] page_count   The maximum number of pages to visit.
+    VacuumStatistics vacuum(uint64_t page_count);
+
+    /// Get the page format.
+    PageFormat get_page_format() const { return page_format; }
+
+    /// Get the record codec of the table (nullptr if the segment has no table).
+    const RecordCodec *get_codec() const { return codec.get(); }
+
     protected:
+    friend class WALSegment;
+
+    /// Scratch space of a scan
+    struct ScanState {
+        /// The bitmask of the matching slots
+        std::vector<uint64_t> mask;
+        /// Gathered integer values
+        std::vector<int64_t> values;
+        /// Gathered char values
+        std::vector<std::byte> strings;
+        /// A zero-padded char constant
+        std::vector<std::byte> constant;
+        /// The selection vector
+        std::vector<uint16_t> selection;
+    };
+
+    /// Get the buffer manager page id of a page.
+    uint64_t get_page_id(uint64_t page) const { return (static_cast<uint64_t>(segment_id) << 48) | page; }
+    /// Initialize a new page.
+    void init_page(char *page) const;
+    /// Get a slot of a page.
+    SlottedPage::Slot &get_slot(char *page, uint16_t slot_id) const;
+    /// Get the number of slots of a page.
+    uint16_t get_slot_count(char *page) const;
+    /// Does a slot hold a record that is not a redirect?
+    bool is_record(char *page, uint16_t slot_id) const;
+    /// Does a slot hold the target of a record that the vacuum forwarded?
+    bool is_forwarded(char *page, uint16_t slot_id) const;
+    /// Mark a redirect target as the target of a forwarded record.
+    void set_forwarded(char *page, uint16_t slot_id) const;
+    /// Is the slot of a TID reserved for a forwarded record, i.e. does it redirect to itself?
+    bool is_reserved(char *page, TID tid) const;
+    /// Does the page of a TID lack its record, as the page of a forwarded record does?
+    /// The slot is missing, empty or reserved then.
+    bool is_forwarded_home(char *page, TID tid) const;
+    /// Get the TID of the record in a slot (the original TID for redirect targets).
+    TID get_tid(char *page, uint64_t page_id, uint16_t slot_id) const;
+    /// Get the null bitmap of a record.
+    const std::byte *get_nulls(char *page, uint16_t slot_id) const;
+    /// Get the value of a fixed-width column of a record.
+    const std::byte *get_value(char *page, uint16_t slot_id, uint32_t column) const;
+    /// Is a fixed-width column of a record NULL?
+    /// Short records (e.g. of allocate(0)) lack the trailing columns, they are NULL as well.
+    bool is_null(char *page, uint16_t slot_id, uint32_t column) const;
+    /// Add the primary key of a record to the Bloom filter, or only to the filter that is built again.
+    /// Records that are too short to hold their key cannot be looked up, they are skipped.
+    void add_key(char *page, uint16_t slot_id, bool is_rebuilt = false) const;
+    /// Add (or remove) the values of a record to (from) the zone maps.
+    void update_zones(char *page, uint64_t page_id, uint16_t slot_id, bool add) const;
+    /// Evaluate predicates on a page.
+    /// Returns the number of matching slots, which are stored in the selection vector of the scan state.
+    uint32_t select_on_page(char *page, const std::vector<Predicate> &predicates, ScanState &state) const;
+    /// Get the space that a record requires in the free-space inventory.
+    uint32_t get_required_space(uint32_t size, bool is_redirect_target) const;
+    /// Get the free space of a page for the free-space inventory.
+    uint32_t get_free_space(char *page) const;
+    /// Does a record fit on a page?
+    bool fits(char *page, uint32_t size, bool is_redirect_target) const;
+    /// Does a record fit in a specific empty slot of a page?
+    bool fits(char *page, uint16_t slot_id, uint32_t size, bool is_redirect_target) const;
+    /// Allocate a record on a page that it fits on.
+    uint16_t allocate_on_page(char *page, uint32_t size, bool is_redirect_target) const;
+    /// Allocate a record in a specific empty slot of a page that it fits in.
+    void allocate_on_page(char *page, uint16_t slot_id, uint32_t size, bool is_redirect_target) const;
+    /// Resize a record on its page if possible.
+    bool resize_on_page(char *page, uint16_t slot_id, uint32_t size) const;
+    /// Get the size of a record.
+    uint32_t get_record_size(char *page, uint16_t slot_id) const;
+    /// Copy a record between a buffer and a page.
+    uint32_t copy_record(char *page, uint16_t slot_id, std::byte *record, uint32_t size, bool to_page) const;
+    /// Copy the first bytes of a record to another slot without allocating.
+    void copy_between(char *source_page, uint16_t source_slot, char *target_page, uint16_t target_slot,
+                      uint32_t size) const;
+    /// Turn a slot into a redirect.
+    void set_redirect(char *page, uint16_t slot_id, TID target) const;
+    /// Turn a redirect into a record of the given size again if it fits on the page.
+    bool restore_on_page(char *page, uint16_t slot_id, uint32_t size) const;
+    /// Erase a slot of a page.
+    void erase_on_page(char *page, uint16_t slot_id) const;
+    /// Compact a page if it is fragmented.
+    bool compact_on_page(char *page) const;
+    /// The fixed pages of a record
+    struct RecordPages {
+        /// The page of the TID (empty if the vacuum removed it and the record was forwarded)
+        PageGuard home;
+        /// The page that the record was moved to (if it is on another page)
+        PageGuard target;
+        /// The page of the record
+        uint64_t page_id = 0;
+        /// The slot of the record
+        uint16_t slot_id = 0;
+        /// Was the record moved?
+        bool is_redirected = false;
+        /// Was the record forwarded by the vacuum?
+        bool is_forwarded = false;
+
+        /// Get the data of the page of the record.
+        char *get_data() const { return target ? target.get_data() : home.get_data(); }
+        /// Get the page of the record.
+        PageGuard &get_page() { return target ? target : home; }
+        /// Write both pages back to disk.
+        void mark_dirty() {
+            home.mark_dirty();
+            if (target) {
+                target.mark_dirty();
+            }
+        }
+    };
+
+    /// Fix the page of a TID and the page that the record was moved to.
+    /// Pages are latched in ascending order, so that the latches of two records cannot form a cycle.
+    RecordPages fix_record(TID tid, bool exclusive) const;
+    /// Fix the pages of a forwarded record: the target and the page of the TID if it reserves the slot.
+    /// Returns false if the record is not forwarded (anymore).
+    bool fix_forwarded(TID tid, bool exclusive, RecordPages &pages) const;
+    /// Look up where a forwarded record is.
+    bool find_forward(TID tid, TID &target) const;
+    /// Remember where a forwarded record is.
+    void set_forward(TID tid, TID target);
+    /// Forget a forwarded record unless it moved on from the target.
+    void erase_forward(TID tid, TID target);
+    /// Reserve the slots of the records that were forwarded from a removed page on a new page with its id.
+    /// Returns true if a slot was reserved.
+    bool reserve_slots(PageGuard &page, uint64_t page_id);
+    /// Find the forwarded records by their marked targets.
+    void load_forwards();
+    /// Find a page that a record fits on, creating a new page if necessary.
+    /// Returns the page, which is fixed exclusively. Threads that hold the pages of a record only fix
+    /// pages that are free or new, since those cannot be waiting for them.
+    /// With a page limit, only pages before it are used and the guard is empty if there is none.
+    std::pair<uint64_t, PageGuard> find_page(uint32_t size, bool is_redirect_target, const RecordPages *held = nullptr,
+                                             uint64_t page_limit = kNoPageLimit);
+    /// Move a record to a page that it fits on.
+    /// Returns the TID of the redirect target, which is marked if the record is forwarded.
+    TID move_record(TID original, char *source_page, uint16_t source_slot, uint32_t new_size,
+                    uint64_t page_id, PageGuard &page, bool is_forwarded = false);
+    /// Move a redirected record back to its page if it fits there with the given size.
+    bool move_home(TID tid, RecordPages &pages, uint32_t size);
+    /// Point the TID of a redirected record to the target that it was moved to.
+    void redirect_home(TID tid, RecordPages &pages, TID target);
+    /// Move the records of a page and remove its unused reservations.
+    void vacuum_page(uint64_t page_id, VacuumStatistics &statistics);
+    /// Move the records of the sparse last page to lower pages and mark the targets of its redirects, so that
+    /// the records are forwarded when the page is removed.
+    void merge_page(uint64_t page_id, const std::vector<TID> &records, const std::vector<TID> &redirects,
+                    VacuumStatistics &statistics);
+    /// Remove the last page of the segment if it is empty or only holds the redirects of forwarded records.
+    bool truncate_page(uint64_t page_id, VacuumStatistics &statistics);
+    /// Get the LSN of the last logged change of a page.
+    uint64_t get_page_lsn(char *page) const;
+    /// Set the LSN of the last logged change of a page.
+    void set_page_lsn(PageGuard &page, uint64_t lsn) const;
+    /// Get the image of a slot for the log: its kind, followed by the TID of a redirect or by the original TID
+    /// of a redirect target and the record.
+    void get_slot_image(char *page, uint16_t slot_id, std::vector<std::byte> &image) const;
+    /// Change a slot to an image of the log.
+    /// Throws std::length_error if the image does not fit on the page.
+    void apply_slot_image(PageGuard &page, uint16_t slot_id, const std::byte *image, uint32_t size);
+    /// Remember the image of a slot before it changes, so that the change can be logged.
+    void capture(char *page, uint16_t slot_id) const;
+    /// Log the change of a slot since it was captured (or since it was empty) and set the LSN of the page.
+    void log_change(PageGuard &page, uint16_t slot_id, bool was_empty = false) const;
+    /// Make the free-space inventory, the zone maps and the Bloom filter cover a recovered page.
+    void recover_page(uint64_t page_id);
+    /// Remove the last page of the segment again during recovery.
+    void redo_truncate(uint64_t page_id);
+    /// Write the data that is not logged to disk: the free-space inventory, the zone maps, the Bloom filter and
+    /// the schema with the page count.
+    void flush_derived();
+
     /// Schema segment
     SchemaSegment &schema;
     /// Free space inventory
     FSISegment &fsi;
+    /// The segments of the table, shared with the free-space inventory
+    TableSegments &segments;
+    /// The page format
+    PageFormat page_format = kSlotted;
+    /// The record codec (if the segment belongs to a table)
+    std::unique_ptr<RecordCodec> codec;
+    /// The minipage layout of PAX pages
+    std::unique_ptr<PaxPage::Layout> pax_layout;
+    /// The record layout of fixed-width pages
+    std::unique_ptr<FixedPage::Layout> fixed_layout;
+    /// The zone maps (optional)
+    ZoneMapSegment *zone_maps;
+    /// The Bloom filter (optional)
+    BloomFilterSegment *bloom_filter;
+    /// The write-ahead log (optional)
+    WALSegment *wal;
+    /// The page limit of find_page that allows all pages
+    static constexpr uint64_t kNoPageLimit = ~0ull;
+    /// The number of threads with their own insert page
+    static constexpr size_t kInsertPages = 64;
+    /// The number of pages that read_batch prefetches ahead of the page it reads
+    static constexpr size_t kPrefetchPages = 8;
+    /// The page that every thread inserts into (+1, 0 if there is none)
+    std::array<std::atomic<uint64_t>, kInsertPages> insert_pages{};
+    /// The number of records that were moved off their page
+    std::atomic<uint64_t> moved_records = 0;
+    /// The number of records that returned to their page
+    std::atomic<uint64_t> returned_records = 0;
+    /// The number of accesses that followed a redirect
+    mutable std::atomic<uint64_t> redirected_accesses = 0;
+    /// Serializes the creation and the removal of pages.
+    /// New pages are fixed before it is released, so that the vacuum never sees them uninitialized.
+    std::mutex page_count_latch;
+    /// Serializes the vacuum and the rebuilds of the Bloom filter
+    std::mutex vacuum_latch;
+    /// The records that the vacuum forwarded from the pages it removed, from their TIDs to their targets.
+    /// A new page with the id of a removed page reserves the slots of the forwarded records. The entry of an erased
+    /// record whose page was removed is kept until the segment is opened again, since an abort may restore it.
+    std::map<uint64_t, uint64_t> forwards;
+    /// Protects the forwarded records (it is never held while waiting for a page)
+    mutable std::mutex forward_latch;
+    /// The page after the next page that the vacuum visits (0 to start at the end)
+    uint64_t vacuum_position = 0;
+    /// The number of records that were erased since the Bloom filter was rebuilt
+    std::atomic<uint64_t> erased_keys = 0;
+};
+
+/// A write-ahead log for the slotted pages of SPSegments.
+///
+/// Every change of a slot is logged physiologically: the log record names the page and the slot and holds the
+/// images of the slot before and after the change. The images are independent of where the record is stored on the
+/// page, so pages can be compacted without logging. Every page stores the LSN of its last logged change, and the
+/// buffer manager flushes the log up to it before it writes the page.
+///
+/// Changes belong to transactions. A thread that changes records outside of a transaction runs every operation
+/// in a transaction of its own, which commits without waiting for the log, so that a crash never leaves an
+/// operation half done (e.g. a resize that erased the record on its page but did not write it to the target).
+/// commit() waits until the log is durable. Threads that commit concurrently share a single synchronous write:
+/// one of them writes the records of all of them while the others wait (group commit).
+///
+/// recover() repairs the segments after a crash (ARIES): it redoes the changes that did not reach the pages,
+/// then it undoes the changes of transactions that did not commit, logging compensation records so that a crash
+/// during recovery does not undo anything twice.
+/// There is no lock manager, so undo assumes that no other transaction reused the slots or the space that the
+/// transaction freed.
+///
+/// checkpoint() bounds the log that recovery reads without stopping writers (a fuzzy checkpoint). It waits for the
+/// operations that are running, writes the pages that were changed before it began and the data that is not
+/// logged (free-space inventories, zone maps, Bloom filters and page counts), and logs the dirty page table and
+/// the active transactions. The head of the log file points to the last complete checkpoint, recovery starts there.
+/// Checkpoints also save the resident pages of the buffer manager for its warm-up.
+class WALSegment: public Segment {
+    public:
+    /// The type of a log record
+    enum RecordType: uint8_t {
+        /// A slot changed (before and after image)
+        kUpdate,
+        /// A change was undone or is kept if its transaction aborts (after image only, never undone itself)
+        kCompensation,
+        /// A page was initialized (never undone)
+        kFormat,
+        /// A transaction committed
+        kCommit,
+        /// A transaction was rolled back completely
+        kEnd,
+        /// A checkpoint: the dirty page table and the active transactions (never undone)
+        kCheckpoint,
+        /// The last page of a segment was removed (never undone)
+        kTruncate,
+    };
+
+    /// Counters since the log was opened
+    struct Statistics {
+        /// The number of transactions that committed and waited for the log
+        uint64_t commits = 0;
+        /// The number of synchronous writes of the log
+        uint64_t flushes = 0;
+        /// The number of changes that recovery applied to the pages again
+        uint64_t redone_records = 0;
+        /// The number of changes that were undone by recovery or aborts
+        uint64_t undone_records = 0;
+        /// The number of checkpoints
+        uint64_t checkpoints = 0;
+        /// The number of log records that recovery read, starting at the last checkpoint
+        uint64_t scanned_records = 0;
+    };
+
+    /// Runs an operation of a segment in the transaction of the thread.
+    /// Outside of a transaction, the operation runs in a transaction of its own that commits without waiting
+    /// for the log, or aborts if the operation throws.
+    class Operation {
+        public:
+        /// Constructor
+        /// @param[in] wal              The log (nullptr if the segment has none).
+        /// @param[in] own_transaction  Begin a transaction outside of one?
+        explicit Operation(WALSegment *wal, bool own_transaction = true);
+        /// Destructor
+        ~Operation();
+
+        Operation(const Operation&) = delete;
+        Operation &operator=(const Operation&) = delete;
+
+        private:
+        /// The log
+        WALSegment *wal;
+        /// Did the operation begin its own transaction?
+        bool implicit = false;
+        /// The number of uncaught exceptions when the operation began
+        int exceptions;
+        /// The checkpoint epoch that the operation began in
+        uint64_t epoch = 0;
+    };
+
+    /// Constructor
+    /// The log is stored in its own file, it does not use the buffer manager except to hook into page writes.
+    /// @param[in] segment_id       Id of the segment that the log is stored in.
+    /// @param[in] buffer_manager   The buffer manager of the pages that are logged.
+    WALSegment(uint16_t segment_id, BufferManager &buffer_manager);
+
+    /// Destructor
+    /// Flushes the log.
+    ~WALSegment();
+
+    /// Recover the attached segments after a crash.
+    /// Has to be called once before the segments are used, after all segments whose changes are logged were
+    /// constructed with the log.
+    void recover();
+
+    /// Begin a transaction in the current thread.
+    /// Throws std::logic_error if the thread is in a transaction already.
+    void begin();
+
+    /// Commit the transaction of the current thread and wait until its changes are durable.
+    /// Throws std::logic_error if the thread is not in a transaction.
+    void commit();
+
+    /// Roll back the changes of the transaction of the current thread.
+    /// Throws std::logic_error if the thread is not in a transaction.
+    void abort();
+
+    /// Make the log records up to an LSN durable.
+    /// Is thread-safe, concurrent calls are served by one write.
+    /// @param[in] lsn              The LSN.
+    void flush(uint64_t lsn);
+
+    /// Take a fuzzy checkpoint, so that recovery reads the log from (about) here on.
+    /// Is thread-safe and runs concurrently with all operations, but must not be called within one.
+    void checkpoint();
+
+    /// Get the number of log bytes that were appended since the last checkpoint.
+    uint64_t get_checkpoint_distance() const;
+
+    /// Get the counters.
+    Statistics get_statistics() const;
+
+    protected:
+    friend class SPSegment;
+
+    /// A transaction
+    struct Transaction {
+        /// The transaction id
+        uint64_t id = 0;
+        /// The LSN of the last log record of the transaction
+        uint64_t last_lsn = 0;
+        /// The LSN of the first log record of the transaction (0 if it logged nothing yet)
+        uint64_t first_lsn = 0;
+    };
+
+    /// Log the changes of a segment.
+    void attach(SPSegment &segment);
+    /// Register an operation with the current checkpoint epoch and begin a transaction for it unless the thread
+    /// is in a transaction.
+    /// Returns true if a transaction was begun.
+    /// @param[out] epoch           The epoch of the operation.
+    /// @param[in] own_transaction  Begin a transaction outside of one?
+    bool begin_operation(uint64_t &epoch, bool own_transaction);
+    /// Unregister an operation.
+    void end_operation(uint64_t epoch);
+    /// Start a new checkpoint epoch and wait until the operations of the previous one finished, so that the
+    /// changes before the returned LSN are complete.
+    /// Returns the LSN of the next log record when the epoch started.
+    /// @param[out] active          The transactions that were active then (optional).
+    uint64_t next_epoch(std::vector<Transaction> *active);
+    /// Commit the transaction of the current thread.
+    /// @param[in] wait             Wait until the log is durable?
+    void commit(bool wait);
+    /// Log a change of a slot by the transaction of the current thread.
+    /// Returns the LSN of the log record.
+    uint64_t log_update(uint64_t page_id, uint16_t slot_id, const std::byte *before, uint32_t before_size,
+                        const std::byte *after, uint32_t after_size);
+    /// Log a change of a slot by the transaction of the current thread that is kept if the transaction aborts.
+    /// Returns the LSN of the log record.
+    uint64_t log_redo(uint64_t page_id, uint16_t slot_id, const std::byte *after, uint32_t after_size);
+    /// Log the initialization of a page.
+    /// Returns the LSN of the log record.
+    uint64_t log_format(uint64_t page_id);
+    /// Log the removal of the last page of a segment and wait until the log record is durable, so that the file
+    /// may be cut off behind the page.
+    void log_truncate(uint64_t page_id);
+    /// Get the LSN of the first log record of the oldest transaction that is active (~0 if there is none).
+    uint64_t get_oldest_lsn() const;
+    /// Append a log record, the log latch has to be held.
+    /// Returns the LSN of the log record.
+    uint64_t append(RecordType type, Transaction *transaction, uint64_t page_id, uint16_t slot_id,
+                    const std::byte *before, uint32_t before_size, const std::byte *after, uint32_t after_size,
+                    uint64_t undo_next_lsn = 0);
+    /// Undo a durable log record of a transaction and log the compensation.
+    /// Returns the LSN of the next record of the transaction that has to be undone (0 if there is none).
+    uint64_t undo(Transaction &transaction, uint64_t lsn);
+    /// Get the segment of a page.
+    SPSegment &get_segment(uint64_t page_id) const;
+
+    /// The file of the log
+    std::unique_ptr<File> file;
+    /// The segments whose changes are logged by segment id
+    std::unordered_map<uint16_t, SPSegment*> segments;
+    /// Protects the buffers, the transactions and the counters
+    mutable std::mutex log_latch;
+    /// Signals that a write of the log finished
+    std::condition_variable flushed;
+    /// The log records that were not written yet
+    std::vector<std::byte> buffer;
+    /// The buffer that is written while the other one is filled
+    std::vector<std::byte> spare;
+    /// The offset of the buffer in the file
+    uint64_t buffer_offset = 0;
+    /// The end of the durable log records
+    uint64_t flushed_offset = 0;
+    /// Is a thread writing the log?
+    bool flushing = false;
+    /// Serializes checkpoints
+    std::mutex checkpoint_latch;
+    /// Signals that the operations of an epoch finished
+    std::condition_variable drained;
+    /// The checkpoint epoch, a checkpoint waits for the operations that began in the previous one
+    uint64_t epoch = 0;
+    /// The number of running operations of the current and of the previous epoch (by parity)
+    std::array<uint64_t, 2> operations{};
+    /// The end of the last checkpoint record
+    uint64_t checkpoint_offset;
+    /// Was the log recovered (or empty when it was opened)?
+    bool recovered;
+    /// The transaction of every thread that is in one
+    std::unordered_map<std::thread::id, Transaction> transactions;
+    /// The id of the next transaction
+    uint64_t next_transaction = 1;
+    /// The counters
+    Statistics statistics;
 };
 
 }  // namespace moderndbs
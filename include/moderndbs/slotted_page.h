@@ -18,15 +18,22 @@ struct TID {
     /// Constructor
     TID(uint64_t page, uint16_t slot);
 
+    /// Get the page number.
+    uint64_t get_page() const { return value >> 16; }
+    /// Get the slot id.
+    uint16_t get_slot() const { return value & ((1ull << 16) - 1); }
+
     /// The TID value
     /// The TID could, for instance, look like the following:
     /// - 48 bit page id
     /// - 16 bit slot id
+    /// Since a redirect TID is stored in a slot and distinguished by its T byte,
+    /// the page numbers must be smaller than 2^40.
     uint64_t value;
 };
 
 struct SlottedPage {
-    struct Header {
+    struct alignas(8) Header {
         // Constructor
         explicit Header(uint32_t page_size);
 
@@ -38,23 +45,168 @@ struct SlottedPage {
         uint32_t data_start;
         /// Space that would be available after compactification
         uint32_t free_space;
+        /// The LSN of the last logged change of the page (0 if it was never logged)
+        uint64_t lsn;
     };
 
     struct Slot {
         /// Constructor
         Slot() = default;
+
+        /// Is the slot empty?
+        bool is_empty() const { return value == kEmpty; }
+        /// Is the record stored in the slot itself?
+        bool is_inline() const { return (value >> 59) == (kInline >> 59); }
+        /// Does the slot hold a redirect TID?
+        bool is_redirect() const { return (value >> 56) != 0xFF && !is_inline(); }
+        /// Was the record redirected to this slot? (The original TID then precedes the record data)
+        bool is_redirect_target() const { return (value >> 56) == 0xFF && ((value >> 48) & 0xFF) != 0; }
+        /// Get the redirect TID.
+        TID as_redirect_tid() const { return TID(value); }
+        /// Get the offset of the record data.
+        uint32_t get_offset() const { return (value >> 24) & ((1ull << 24) - 1); }
+        /// Get the size of the record data.
+        uint32_t get_size() const { return is_inline() ? (value >> 56) & 0x07 : value & ((1ull << 24) - 1); }
+        /// Get the size of the record data outside of the slot.
+        uint32_t get_stored_size() const { return is_inline() ? 0 : get_size(); }
+        /// Get the data of an inline record.
+        std::byte *get_inline_data() { return reinterpret_cast<std::byte*>(&value); }
+
+        /// Set the slot to a record on this page.
+        void set_slot(uint32_t offset, uint32_t size, bool is_redirect_target) {
+            value = (0xFFull << 56) | (static_cast<uint64_t>(is_redirect_target ? 0xFF : 0) << 48)
+                | (static_cast<uint64_t>(offset) << 24) | size;
+        }
+        /// Set the slot to an inline record of the given size, whose data is zero.
+        void set_inline(uint32_t size) { value = kInline | (static_cast<uint64_t>(size) << 56); }
+        /// Set the slot to a redirect.
+        void set_redirect_tid(TID tid) { value = tid.value; }
+        /// Clear the slot.
+        void clear() { value = kEmpty; }
+
         /// The slot value
         /// c.f. chapter 3 page 13
+        /// - T (8 bit):  0xFF if the record is stored on this page. Otherwise, the slot value is a redirect TID.
+        /// - S (8 bit):  0xFF if the record was redirected to this page, 0 otherwise.
+        ///               The record data of a redirect target is preceded by the original TID.
+        /// - O (24 bit): The offset of the record data within the page
+        /// - L (24 bit): The length of the record data (including the original TID of a redirect target)
+        /// Records of up to seven bytes are stored in the slot instead: T is 0xF0 plus the length of the
+        /// record, and the record data fills the other seven bytes (the T byte is the last one in memory).
         uint64_t value;
+
+        /// The value of an empty slot
+        static constexpr uint64_t kEmpty = 0xFFull << 56;
+        /// The T byte of an empty inline record
+        static constexpr uint64_t kInline = 0xF0ull << 56;
     };
 
+    static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "inline records require a little-endian machine");
+
+    /// The maximum size of records that are stored in their slot
+    static constexpr uint32_t kInlineSize = 7;
+
+    /// Get the space that record data of the given size occupies outside of its slot.
+    static constexpr uint32_t get_stored_size(uint32_t data_size) {
+        return data_size <= kInlineSize ? 0 : data_size;
+    }
+
     /// Constructor.
     /// @param[in] page_size    The size of a buffer frame.
     explicit SlottedPage(uint32_t page_size);
 
+    /// Get the data of the page.
+    std::byte *get_data() { return reinterpret_cast<std::byte*>(this); }
+    /// Get the data of the page.
+    const std::byte *get_data() const { return reinterpret_cast<const std::byte*>(this); }
+    /// Get the slots of the page.
+    Slot *get_slots() { return reinterpret_cast<Slot*>(get_data() + sizeof(SlottedPage)); }
+    /// Get the slots of the page.
+    const Slot *get_slots() const { return reinterpret_cast<const Slot*>(get_data() + sizeof(SlottedPage)); }
+
+    /// Get the space that is available without compactification.
+    uint32_t get_fragmented_free_space() const {
+        return header.data_start - sizeof(SlottedPage) - header.slot_count * sizeof(Slot);
+    }
+
+    /// Get the space that a record of the given size requires on this page.
+    /// @param[in] data_size    The size of the record data.
+    uint32_t get_required_space(uint32_t data_size) const {
+        return get_stored_size(data_size) + (header.first_free_slot < header.slot_count ? 0 : sizeof(Slot));
+    }
+
+    /// Get the space that a record of the given size requires in a specific empty slot.
+    /// Slots behind the slot count are created, so they require space as well.
+    /// @param[in] data_size    The size of the record data.
+    /// @param[in] slot_id      The slot.
+    uint32_t get_required_space(uint32_t data_size, uint16_t slot_id) const {
+        uint32_t new_slots = slot_id < header.slot_count ? 0 : slot_id + 1 - header.slot_count;
+        return get_stored_size(data_size) + new_slots * sizeof(Slot);
+    }
+
+    /// Allocate a slot.
+    /// Records of up to kInlineSize bytes are stored in the slot.
+    /// The caller has to ensure that get_required_space(data_size) <= header.free_space.
+    /// @param[in] data_size    The size of the record data.
+    /// @param[in] page_size    The size of a buffer frame.
+    uint16_t allocate(uint32_t data_size, uint32_t page_size);
+
+    /// Allocate a specific empty slot, e.g. to restore a record with its TID.
+    /// The caller has to ensure that get_required_space(data_size, slot_id) <= header.free_space.
+    /// @param[in] slot_id      The slot.
+    /// @param[in] data_size    The size of the record data.
+    /// @param[in] page_size    The size of a buffer frame.
+    void allocate_at(uint16_t slot_id, uint32_t data_size, uint32_t page_size);
+
+    /// Change the size of the record data of a slot.
+    /// The caller has to ensure that the new size fits on the page.
+    /// The record data is moved (and the page compacted) if necessary.
+    /// @param[in] slot_id      The slot.
+    /// @param[in] data_size    The new size of the record data.
+    /// @param[in] page_size    The size of a buffer frame.
+    void relocate(uint16_t slot_id, uint32_t data_size, uint32_t page_size);
+
+    /// Release the record data of a slot and turn it into a redirect.
+    /// @param[in] slot_id      The slot.
+    /// @param[in] target       The TID the record was moved to.
+    void set_redirect(uint16_t slot_id, TID target);
+
+    /// Store the record data of a redirect on the page again.
+    /// The caller has to ensure that data_size <= header.free_space.
+    /// @param[in] slot_id      The slot of the redirect.
+    /// @param[in] data_size    The size of the record data.
+    /// @param[in] page_size    The size of a buffer frame.
+    void restore(uint16_t slot_id, uint32_t data_size, uint32_t page_size);
+
+    /// Erase a slot.
+    /// @param[in] slot_id      The slot.
+    void erase(uint16_t slot_id);
+
     /// Compact the page.
     /// @param[in] page_size    The size of a buffer frame.
-    void compactify(uint32_t page_size);
+    /// @param[in] last         A slot whose record should end up at the lower end of the data (optional).
+    void compactify(uint32_t page_size, const Slot *last = nullptr);
+
+    /// Get the record data of a slot.
+    std::byte *get_record_data(Slot &slot);
+
+    /// Release the space of the record data of a slot.
+    void release(Slot &slot);
+
+    /// Change the size of a record that is stored in its slot before or after.
+    void relocate_inline(Slot &slot, uint32_t data_size, uint32_t page_size);
+
+    /// Compact record data towards the end of a page.
+    /// Shared with other page formats that use the same slot encoding.
+    /// The data passes through a buffer of the calling thread, so compaction does not allocate.
+    /// Returns the new lower end of the data.
+    /// @param[in] page         The page.
+    /// @param[in] slots        The slots of the page.
+    /// @param[in] slot_count   The number of slots.
+    /// @param[in] page_size    The size of a buffer frame.
+    /// @param[in] last         A slot whose record should end up at the lower end of the data (optional).
+    static uint32_t compact_records(std::byte *page, Slot *slots, uint16_t slot_count, uint32_t page_size,
+                                    const Slot *last = nullptr);
 
     /// The header.
     /// Note that the slotted page itself should reside on the buffer frame!
@@ -62,15 +214,6 @@ struct SlottedPage {
     /// This is also the reason why the constructor and compactify require the actual page size as argument.
     /// (The slotted page itself does not know how large it is)
     Header header;
-
-    std::vector<Slot> slots;
-    std::vector<std::byte> data;
-
-    // std::vector<Slot> slots;
-    // std::vector<std::byte> data;
-
-    uint16_t addSlot(uint64_t value);
-
 };
 
 }  // namespace moderndbs
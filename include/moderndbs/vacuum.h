@@ -0,0 +1,56 @@
+#ifndef INCLUDE_MODERNDBS_VACUUM_H_
+#define INCLUDE_MODERNDBS_VACUUM_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "moderndbs/segment.h"
+
+namespace moderndbs {
+
+/// Vacuums a slotted pages segment in a background thread.
+/// Every step visits a few pages and then pauses, so that foreground operations rarely wait for its latches.
+class Vacuum {
+    public:
+    /// Constructor. Starts the background thread.
+    /// @param[in] segment          The segment that is vacuumed.
+    /// @param[in] pages_per_step   The number of pages that are visited between two pauses.
+    /// @param[in] pause            The pause between two steps.
+    explicit Vacuum(SPSegment &segment, uint64_t pages_per_step = 16,
+                    std::chrono::milliseconds pause = std::chrono::milliseconds(10));
+    /// Destructor. Stops the background thread after its current step.
+    ~Vacuum();
+
+    Vacuum(const Vacuum&) = delete;
+    Vacuum &operator=(const Vacuum&) = delete;
+
+    /// Get the work done so far.
+    SPSegment::VacuumStatistics get_statistics() const;
+
+    protected:
+    /// The loop of the background thread
+    void run();
+
+    /// The segment
+    SPSegment &segment;
+    /// The number of pages per step
+    uint64_t pages_per_step;
+    /// The pause between two steps
+    std::chrono::milliseconds pause;
+    /// Protects the statistics and the stop flag
+    mutable std::mutex mutex;
+    /// Wakes the thread up when it should stop
+    std::condition_variable stop_condition;
+    /// Should the thread stop?
+    bool stopped = false;
+    /// The work done so far
+    SPSegment::VacuumStatistics statistics;
+    /// The background thread
+    std::thread thread;
+};
+
+}  // namespace moderndbs
+
+#endif  // INCLUDE_MODERNDBS_VACUUM_H_
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "moderndbs/segment.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using BloomFilterSegment = moderndbs::BloomFilterSegment;
+using BufferFrame = moderndbs::BufferFrame;
+
+/*
+The first page of the segment stores the number of blocks, the blocks follow on the next pages. A key selects its
+block with the upper 32 bits of its hash value. The lower 32 bits are multiplied with eight odd constants, the upper
+six bits of every product select the bit of one word of the block. This is the split block Bloom filter of Parquet
+with 64-bit instead of 32-bit words, so that a block fills a cache line.
+
+The hash values decide which bits are set on disk, so they must not depend on the standard library: a key is hashed
+with hash_bytes(), i.e. 64-bit FNV-1a and the finalizer of MurmurHash3.
+*/
+
+namespace {
+
+/// The multipliers of the eight words of a block
+constexpr uint32_t kSalts[BloomFilterSegment::kBlockWords] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+/// Get the bit of a word of a block.
+uint64_t get_bit(uint32_t hash, uint32_t word) {
+    return 1ull << ((hash * kSalts[word]) >> 26);
+}
+
+/// Set the bits of a hash value in a block.
+void set_bits(uint64_t *words, uint32_t hash) {
+    for (uint32_t word = 0; word < BloomFilterSegment::kBlockWords; ++word) {
+        words[word] |= get_bit(hash, word);
+    }
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2")))
+bool block_contains_avx2(const std::byte *block, uint32_t hash) {
+    const __m256i salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kSalts));
+    __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salts), 26);
+    const __m256i one = _mm256_set1_epi64x(1);
+    __m256i low = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shifts)));
+    __m256i high = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shifts, 1)));
+    __m256i words_low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i words_high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    /// testc is set if every bit of the second operand is set in the first one
+    return _mm256_testc_si256(words_low, low) & _mm256_testc_si256(words_high, high);
+}
+
+#endif
+
+using Probe = bool (*)(const std::byte*, uint32_t);
+
+/// Choose the probe for the CPU we are running on.
+Probe select_probe() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return block_contains_avx2;
+    }
+#endif
+    return BloomFilterSegment::block_contains_scalar;
+}
+
+/// The page that stores the number of blocks
+constexpr uint64_t kHeaderPage = 0;
+
+}  // namespace
+
+BloomFilterSegment::BloomFilterSegment(uint16_t segment_id, BufferManager &buffer_manager, SchemaSegment &schema,
+                                       const schema::Table &table, uint64_t expected_keys,
+                                       double false_positive_rate)
+    : Segment(segment_id, buffer_manager), blocks_per_page(buffer_manager.get_page_size() / kBlockSize) {
+    schema.get_segments(&table).bloom_filter_segment_id = segment_id;
+    auto& page = buffer_manager.fix_page((static_cast<uint64_t>(segment_id) << 48) | kHeaderPage, true);
+    std::memcpy(&block_count, page.get_data(), sizeof(uint64_t));
+    bool is_new = block_count == 0;
+    if (is_new) {
+        /// an existing filter keeps its size, the parameters only apply to new ones
+        block_count = get_block_count(expected_keys, false_positive_rate);
+        std::memcpy(page.get_data(), &block_count, sizeof(uint64_t));
+    }
+    buffer_manager.unfix_page(page, is_new);
+}
+
+uint64_t BloomFilterSegment::get_block_count(uint64_t expected_keys, double false_positive_rate) {
+    if (!(false_positive_rate > 0 && false_positive_rate < 1)) {
+        throw std::invalid_argument("the false-positive rate must be between 0 and 1");
+    }
+    /// a key is a false positive if its bit is set in every word, so every word may have this share of bits set
+    double fill = std::pow(false_positive_rate, 1.0 / kBlockWords);
+    /// the number of keys that set this share of the 64 bits of a word
+    double keys_per_block = -64 * std::log1p(-fill);
+    auto blocks = static_cast<uint64_t>(std::ceil(static_cast<double>(expected_keys) / keys_per_block));
+    if (blocks >= (1ull << 32)) {
+        throw std::length_error("the Bloom filter is too large");
+    }
+    return std::max<uint64_t>(blocks, 1);
+}
+
+std::pair<BufferFrame*, size_t> BloomFilterSegment::fix_block(uint64_t block, bool exclusive) const {
+    uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | (1 + block / blocks_per_page);
+    auto& page = buffer_manager.fix_page(page_id, exclusive);
+    return { &page, (block % blocks_per_page) * kBlockSize };
+}
+
+void BloomFilterSegment::add(const std::byte *key, uint32_t size) {
+    auto hash = moderndbs::hash_bytes(key, size);
+    auto block = ((hash >> 32) * block_count) >> 32;
+    auto [page, offset] = fix_block(block, true);
+    set_bits(reinterpret_cast<uint64_t*>(page->get_data() + offset), static_cast<uint32_t>(hash));
+    /// the rebuild may have read the record of the key already, the block stays latched until both filters
+    /// have the key, so that it cannot be replaced in between
+    if (rebuilding) {
+        std::lock_guard<std::mutex> guard(rebuild_latch);
+        if (!rebuilt.empty()) {
+            set_bits(rebuilt.data() + block * kBlockWords, static_cast<uint32_t>(hash));
+        }
+    }
+    buffer_manager.unfix_page(*page, true);
+}
+
+bool BloomFilterSegment::may_contain(const std::byte *key, uint32_t size) const {
+    auto hash = moderndbs::hash_bytes(key, size);
+    auto [page, offset] = fix_block(((hash >> 32) * block_count) >> 32, false);
+    bool result = block_contains(reinterpret_cast<const std::byte*>(page->get_data() + offset),
+                                 static_cast<uint32_t>(hash));
+    buffer_manager.unfix_page(*page, false);
+    return result;
+}
+
+void BloomFilterSegment::clear() {
+    for (uint64_t block = 0; block < block_count; block += blocks_per_page) {
+        auto [page, offset] = fix_block(block, true);
+        std::memset(page->get_data(), 0, blocks_per_page * kBlockSize);
+        buffer_manager.unfix_page(*page, true);
+    }
+}
+
+void BloomFilterSegment::begin_rebuild() {
+    std::lock_guard<std::mutex> guard(rebuild_latch);
+    rebuilt.assign(block_count * kBlockWords, 0);
+    rebuilding = true;
+}
+
+void BloomFilterSegment::add_rebuilt(const std::byte *key, uint32_t size) {
+    if (!rebuilding) {
+        return;
+    }
+    auto hash = moderndbs::hash_bytes(key, size);
+    auto block = ((hash >> 32) * block_count) >> 32;
+    std::lock_guard<std::mutex> guard(rebuild_latch);
+    if (!rebuilt.empty()) {
+        set_bits(rebuilt.data() + block * kBlockWords, static_cast<uint32_t>(hash));
+    }
+}
+
+void BloomFilterSegment::end_rebuild() {
+    for (uint64_t block = 0; block < block_count; block += blocks_per_page) {
+        auto [page, offset] = fix_block(block, true);
+        {
+            std::lock_guard<std::mutex> guard(rebuild_latch);
+            auto blocks = std::min(blocks_per_page, block_count - block);
+            std::memcpy(page->get_data(), rebuilt.data() + block * kBlockWords, blocks * kBlockSize);
+        }
+        buffer_manager.unfix_page(*page, true);
+    }
+    std::lock_guard<std::mutex> guard(rebuild_latch);
+    rebuilding = false;
+    rebuilt = std::vector<uint64_t>();
+}
+
+bool BloomFilterSegment::block_contains(const std::byte *block, uint32_t hash) {
+    static const Probe probe = select_probe();
+    return probe(block, hash);
+}
+
+bool BloomFilterSegment::block_contains_scalar(const std::byte *block, uint32_t hash) {
+    for (uint32_t word = 0; word < kBlockWords; ++word) {
+        uint64_t value;
+        std::memcpy(&value, block + word * sizeof(uint64_t), sizeof(uint64_t));
+        auto bit = get_bit(hash, word);
+        if ((value & bit) != bit) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -1,50 +1,502 @@
 #include "moderndbs/buffer_manager.h"
+#include <algorithm>
+#include <string>
+#include <utility>
 
 
 /*
-This is only a dummy implementation of a buffer manager. It does not do any
-disk I/O or locking. It also does not respect the page_count and creates a new
-buffer for every fixed page and does so without using any latches so it is not
-thread-safe.
+The buffer manager keeps at most page_count pages in memory and replaces them
+with the 2Q strategy: pages that are fixed for the first time are appended to
+the FIFO list, pages that are fixed again move to the end of the LRU list.
+Unfixed pages are evicted from the FIFO list first. Every segment is stored in
+its own file that is named after the segment id. Dirty pages are written when
+they are evicted or when the buffer manager is destroyed. If there is a
+write-ahead log, it is flushed up to the LSN of a page before the page.
+Checkpoints of the log write dirty pages while they are in use: such a page
+is pinned and latched shared, so that it cannot change, and written without
+the directory latch.
+
+The directory latch protects the page table and the lists, it is never held
+while waiting for the latch of a page or for I/O. Pages with a fix count > 0
+are never evicted, so it is safe to latch them after releasing the directory
+latch. A page that is read is in the page table already, marked as loading
+and pinned by the reading thread, other threads that fix it wait for the read.
+A dirty page is evicted in two steps: it is pinned and written like by a
+checkpoint, and dropped by a later eviction if nobody fixed it meanwhile.
+
+The ids of the resident pages can be saved in a file: the number of ids
+followed by the ids, the hottest first. A new buffer manager loads them in the
+background. It reads runs of pages without the directory latch and inserts them
+only if no page was written or left memory in the meantime, since the run could
+be outdated otherwise.
 */
 
 
 namespace moderndbs {
 
+namespace {
+
+/// The maximum number of consecutive pages that the warm-up reads at once
+constexpr size_t kWarmUpRun = 32;
+
+}  // namespace
+
+
 char* BufferFrame::get_data() {
     return data.data();
 }
 
 
-BufferManager::BufferManager(size_t page_size, size_t /*page_count*/) : page_size(page_size) {
+BufferManager::BufferManager(size_t page_size, size_t page_count)
+    : page_size(page_size), page_count(page_count) {
+}
+
+
+BufferManager::~BufferManager() {
+    stop_warm_up = true;
+    wait_for_warm_up();
+    save_resident_pages();
+    for (auto& [page_id, page] : pages) {
+        if (page->dirty) {
+            write_page(*page);
+        }
+    }
+}
+
+
+File &BufferManager::get_file(uint16_t segment_id) {
+    auto it = files.find(segment_id);
+    if (it == files.end()) {
+        auto file_name = std::to_string(segment_id);
+        it = files.emplace(segment_id, File::open_file(file_name.c_str(), File::WRITE)).first;
+    }
+    return *it->second;
+}
+
+
+void BufferManager::read_page(File &file, BufferFrame &page) {
+    /// pages behind the end of the file are zero
+    page.data.assign(page_size, 0);
+    file.read_block(get_segment_page_id(page.page_id) * page_size, page_size, page.data.data());
+}
+
+
+void BufferManager::write_page(BufferFrame &page) {
+    if (flush_log && page.lsn != 0) {
+        /// the log records of the changes must reach the disk before the page
+        flush_log(page.lsn);
+    }
+    get_file(get_segment_id(page.page_id)).write_block(page.data.data(),
+                                                       get_segment_page_id(page.page_id) * page_size, page_size);
+    page.dirty = false;
+    page.recovery_lsn = 0;
+    ++generation;
+}
+
+
+void BufferManager::write_fixed_page(BufferFrame &page) {
+    File *file;
+    uint64_t recovery_lsn;
+    {
+        std::lock_guard<std::mutex> directory_guard(directory_latch);
+        if (!page.dirty) {
+            return;
+        }
+        file = &get_file(get_segment_id(page.page_id));
+        /// threads that change the page while it is written (only the free-space inventory does that with a
+        /// shared latch) mark it dirty again
+        page.dirty = false;
+        recovery_lsn = page.recovery_lsn.exchange(0);
+    }
+    try {
+        if (flush_log && page.lsn != 0) {
+            flush_log(page.lsn);
+        }
+        file->write_block(page.data.data(), get_segment_page_id(page.page_id) * page_size, page_size);
+    } catch (...) {
+        std::lock_guard<std::mutex> directory_guard(directory_latch);
+        page.dirty = true;
+        page.recovery_lsn = recovery_lsn;
+        /// the file may hold a part of the page
+        ++generation;
+        throw;
+    }
+    /// a run that the warm-up read during the write may hold the old page, which it could load once the page
+    /// is evicted, so the generation changes only when the new page is on disk
+    std::lock_guard<std::mutex> directory_guard(directory_latch);
+    ++generation;
+}
+
+
+bool BufferManager::evict(std::unique_lock<std::mutex> &directory_guard) {
+    for (auto* list : { &fifo, &lru }) {
+        for (auto* page : *list) {
+            if (page->fix_count > 0) {
+                continue;
+            }
+            if (!page->dirty) {
+                list->erase(page->position);
+                pages.erase(page->page_id);
+                /// a run that the warm-up read while the page was dirty must not replace it now
+                ++generation;
+                return true;
+            }
+            /// the page is pinned while it is written, so that it stays in memory
+            ++page->fix_count;
+            ++evictions;
+            directory_guard.unlock();
+            page->latch.lock_shared();
+            std::exception_ptr error;
+            try {
+                write_fixed_page(*page);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            page->latch.unlock_shared();
+            directory_guard.lock();
+            --page->fix_count;
+            --evictions;
+            io_done.notify_all();
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return true;
+        }
+    }
+    if (evictions > 0) {
+        /// the pages that other threads write become free
+        io_done.wait(directory_guard);
+        return true;
+    }
+    return false;
 }
 
 
-BufferManager::~BufferManager() = default;
+BufferFrame &BufferManager::pin_page(uint64_t page_id) {
+    std::unique_lock<std::mutex> directory_guard(directory_latch);
+    while (true) {
+        auto it = pages.find(page_id);
+        if (it != pages.end()) {
+            auto* page = it->second.get();
+            if (page->loading) {
+                /// the page may be gone if the read failed, so we look it up again
+                io_done.wait(directory_guard);
+                continue;
+            }
+            /// the page was used before, it belongs to the end of the LRU list
+            /// (splicing keeps the list node, so fixing a loaded page does not allocate)
+            lru.splice(lru.end(), page->in_lru ? lru : fifo, page->position);
+            page->in_lru = true;
+            ++statistics.hits;
+            ++page->fix_count;
+            return *page;
+        }
+        if (pages.size() < page_count) {
+            break;
+        }
+        if (!evict(directory_guard)) {
+            throw buffer_full_error{};
+        }
+    }
+
+    auto frame = std::make_unique<BufferFrame>();
+    auto* page = frame.get();
+    page->page_id = page_id;
+    page->fix_count = 1;
+    page->loading = true;
+    page->position = fifo.insert(fifo.end(), page);
+    pages.emplace(page_id, std::move(frame));
+    ++statistics.misses;
+    auto& file = get_file(get_segment_id(page_id));
+    directory_guard.unlock();
+    try {
+        read_page(file, *page);
+    } catch (...) {
+        directory_guard.lock();
+        fifo.erase(page->position);
+        pages.erase(page_id);
+        ++generation;
+        io_done.notify_all();
+        throw;
+    }
+    directory_guard.lock();
+    page->loading = false;
+    io_done.notify_all();
+    return *page;
+}
 
 
-BufferFrame& BufferManager::fix_page(uint64_t page_id, bool /*exclusive*/) {
-    auto result = pages.emplace(page_id, BufferFrame{});
-    auto& page = result.first->second;
-    bool is_new = result.second;
-    if (is_new) {
-        page.data.resize(page_size, 0);
+BufferFrame& BufferManager::fix_page(uint64_t page_id, bool exclusive) {
+    auto& page = pin_page(page_id);
+    if (exclusive) {
+        page.latch.lock();
+        page.exclusive = true;
+    } else {
+        page.latch.lock_shared();
     }
     return page;
 }
 
 
-void BufferManager::unfix_page(BufferFrame& /*page*/, bool /*is_dirty*/) {
+BufferFrame* BufferManager::try_fix_page(uint64_t page_id, bool exclusive) {
+    auto& page = pin_page(page_id);
+    if (exclusive ? page.latch.try_lock() : page.latch.try_lock_shared()) {
+        page.exclusive = exclusive;
+        return &page;
+    }
+    std::lock_guard<std::mutex> directory_guard(directory_latch);
+    --page.fix_count;
+    return nullptr;
+}
+
+
+void BufferManager::prefetch(uint64_t page_id) {
+    File *file;
+    {
+        std::lock_guard<std::mutex> directory_guard(directory_latch);
+        if (pages.count(page_id) != 0) {
+            return;
+        }
+        file = &get_file(get_segment_id(page_id));
+    }
+    file->prefetch_block(get_segment_page_id(page_id) * page_size, page_size);
+}
+
+
+void BufferManager::unfix_page(BufferFrame& page, bool is_dirty) {
+    if (page.exclusive) {
+        page.exclusive = false;
+        page.latch.unlock();
+    } else {
+        page.latch.unlock_shared();
+    }
+    std::lock_guard<std::mutex> directory_guard(directory_latch);
+    page.dirty |= is_dirty;
+    --page.fix_count;
+}
+
+
+void BufferManager::truncate(uint16_t segment_id, uint64_t page_count) {
+    std::lock_guard<std::mutex> directory_guard(directory_latch);
+    ++generation;
+    for (auto it = pages.begin(); it != pages.end();) {
+        auto* page = it->second.get();
+        if (get_segment_id(page->page_id) != segment_id || get_segment_page_id(page->page_id) < page_count) {
+            ++it;
+            continue;
+        }
+        page->dirty = false;
+        page->recovery_lsn = 0;
+        if (page->fix_count > 0) {
+            ++it;
+            continue;
+        }
+        (page->in_lru ? lru : fifo).erase(page->position);
+        it = pages.erase(it);
+    }
+    auto& file = get_file(segment_id);
+    if (file.size() > page_count * page_size) {
+        file.resize(page_count * page_size);
+    }
+}
+
+
+void BufferManager::set_log(std::function<void(uint64_t)> flush) {
+    flush_log = std::move(flush);
+}
+
+
+std::vector<std::pair<uint64_t, uint64_t>> BufferManager::get_dirty_page_table() const {
+    std::lock_guard<std::mutex> directory_guard(directory_latch);
+    std::vector<std::pair<uint64_t, uint64_t>> dirty_pages;
+    for (auto& [page_id, page] : pages) {
+        /// fixed pages may be changing, their recovery LSN is set before the change is visible to others
+        auto recovery_lsn = page->recovery_lsn.load(std::memory_order_relaxed);
+        if (recovery_lsn != 0) {
+            dirty_pages.emplace_back(page_id, recovery_lsn);
+        }
+    }
+    return dirty_pages;
+}
+
+
+void BufferManager::flush_pages(const std::vector<uint64_t> &page_ids) {
+    for (auto page_id : page_ids) {
+        BufferFrame *page;
+        {
+            std::lock_guard<std::mutex> directory_guard(directory_latch);
+            auto it = pages.find(page_id);
+            if (it == pages.end() || !it->second->dirty) {
+                continue;
+            }
+            /// pinned pages are not evicted
+            page = it->second.get();
+            ++page->fix_count;
+        }
+        page->latch.lock_shared();
+        try {
+            write_fixed_page(*page);
+        } catch (...) {
+            unfix_page(*page, false);
+            throw;
+        }
+        unfix_page(*page, false);
+    }
+}
+
+
+void BufferManager::flush_segment(uint16_t segment_id) {
+    std::vector<uint64_t> page_ids;
+    {
+        std::lock_guard<std::mutex> directory_guard(directory_latch);
+        for (auto& [page_id, page] : pages) {
+            if (get_segment_id(page_id) == segment_id && page->dirty) {
+                page_ids.push_back(page_id);
+            }
+        }
+    }
+    flush_pages(page_ids);
+}
+
+
+void BufferManager::warm_up(uint16_t file_id) {
+    hot_pages_file = File::open_file(std::to_string(file_id).c_str(), File::WRITE);
+    {
+        std::lock_guard<std::mutex> directory_guard(directory_latch);
+        statistics.is_warming_up = true;
+    }
+    warm_up_thread = std::thread([this] { load_hot_pages(); });
+}
+
+
+void BufferManager::wait_for_warm_up() {
+    if (warm_up_thread.joinable()) {
+        warm_up_thread.join();
+    }
+}
+
+
+void BufferManager::load_hot_pages() {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint64_t> page_ids;
+    {
+        std::lock_guard<std::mutex> hot_pages_guard(hot_pages_latch);
+        uint64_t count = 0;
+        auto size = hot_pages_file->size();
+        if (size >= sizeof(uint64_t)) {
+            hot_pages_file->read_block(0, sizeof(uint64_t), reinterpret_cast<char*>(&count));
+            /// a file that was written partially may hold fewer ids
+            count = std::min<uint64_t>(count, size / sizeof(uint64_t) - 1);
+        }
+        /// the hottest pages come first, the others would not fit anyway
+        count = std::min<uint64_t>(count, page_count);
+        page_ids.resize(count);
+        if (count > 0) {
+            hot_pages_file->read_block(sizeof(uint64_t), count * sizeof(uint64_t),
+                                       reinterpret_cast<char*>(page_ids.data()));
+        }
+    }
+    std::sort(page_ids.begin(), page_ids.end());
+
+    std::vector<char> run;
+    for (size_t begin = 0, end; begin < page_ids.size() && !stop_warm_up; begin = end) {
+        /// consecutive page ids are consecutive pages of a segment
+        end = begin + 1;
+        while (end < page_ids.size() && end - begin < kWarmUpRun && page_ids[end] == page_ids[end - 1] + 1
+                && get_segment_id(page_ids[end]) == get_segment_id(page_ids[begin])) {
+            ++end;
+        }
+        uint64_t first_page = get_segment_page_id(page_ids[begin]);
+        File *file;
+        uint64_t run_length;
+        uint64_t run_generation;
+        {
+            std::lock_guard<std::mutex> directory_guard(directory_latch);
+            if (pages.size() >= page_count) {
+                break;
+            }
+            file = &get_file(get_segment_id(page_ids[begin]));
+            /// pages behind the end of the file are zero, they are not worth loading
+            uint64_t file_pages = file->size() / page_size;
+            run_length = first_page < file_pages ? std::min<uint64_t>(end - begin, file_pages - first_page) : 0;
+            run_generation = generation;
+        }
+        if (run_length == 0) {
+            continue;
+        }
+        run.resize(run_length * page_size);
+        file->read_block(first_page * page_size, run.size(), run.data());
+
+        std::lock_guard<std::mutex> directory_guard(directory_latch);
+        if (generation != run_generation) {
+            continue;
+        }
+        for (size_t i = 0; i < run_length && pages.size() < page_count; ++i) {
+            uint64_t page_id = page_ids[begin + i];
+            if (pages.count(page_id) != 0) {
+                continue;
+            }
+            auto frame = std::make_unique<BufferFrame>();
+            frame->page_id = page_id;
+            frame->data.assign(run.begin() + i * page_size, run.begin() + (i + 1) * page_size);
+            frame->position = fifo.insert(fifo.end(), frame.get());
+            pages.emplace(page_id, std::move(frame));
+            ++statistics.warmed_pages;
+        }
+    }
+
+    std::lock_guard<std::mutex> directory_guard(directory_latch);
+    statistics.warm_up_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    statistics.is_warming_up = false;
+}
+
+
+void BufferManager::save_resident_pages() {
+    if (!hot_pages_file) {
+        return;
+    }
+    /// the number of ids comes first
+    std::vector<uint64_t> page_ids{ 0 };
+    {
+        std::lock_guard<std::mutex> directory_guard(directory_latch);
+        for (auto* list : { &lru, &fifo }) {
+            for (auto it = list->rbegin(); it != list->rend(); ++it) {
+                page_ids.push_back((*it)->page_id);
+            }
+        }
+    }
+    page_ids[0] = page_ids.size() - 1;
+    std::lock_guard<std::mutex> hot_pages_guard(hot_pages_latch);
+    auto size = page_ids.size() * sizeof(uint64_t);
+    if (hot_pages_file->size() < size) {
+        hot_pages_file->resize(size);
+    }
+    hot_pages_file->write_block(reinterpret_cast<const char*>(page_ids.data()), 0, size);
+}
+
+
+BufferManager::Statistics BufferManager::get_statistics() const {
+    std::lock_guard<std::mutex> directory_guard(directory_latch);
+    return statistics;
 }
 
 
 std::vector<uint64_t> BufferManager::get_fifo_list() const {
-    return {};
+    std::vector<uint64_t> page_ids;
+    for (auto* page : fifo) {
+        page_ids.push_back(page->page_id);
+    }
+    return page_ids;
 }
 
 
 std::vector<uint64_t> BufferManager::get_lru_list() const {
-    return {};
+    std::vector<uint64_t> page_ids;
+    for (auto* page : lru) {
+        page_ids.push_back(page->page_id);
+    }
+    return page_ids;
 }
 
 }  // namespace moderndbs
@@ -0,0 +1,44 @@
+#include "moderndbs/checkpointer.h"
+#include <algorithm>
+
+using Checkpointer = moderndbs::Checkpointer;
+
+namespace {
+
+/// The log size is checked this often
+constexpr std::chrono::milliseconds kPollInterval{10};
+
+}  // namespace
+
+Checkpointer::Checkpointer(WALSegment &wal, uint64_t log_size, std::chrono::milliseconds interval)
+    : wal(wal), log_size(log_size), interval(interval) {
+    thread = std::thread([this] { run(); });
+}
+
+Checkpointer::~Checkpointer() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopped = true;
+    }
+    stop_condition.notify_all();
+    thread.join();
+}
+
+void Checkpointer::run() {
+    std::unique_lock<std::mutex> guard(mutex);
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    while (!stopped) {
+        stop_condition.wait_for(guard, std::min(kPollInterval, interval), [this] { return stopped; });
+        if (stopped) {
+            break;
+        }
+        auto distance = wal.get_checkpoint_distance();
+        auto now = std::chrono::steady_clock::now();
+        if (distance >= log_size || (distance > 0 && now - last_checkpoint >= interval)) {
+            guard.unlock();
+            wal.checkpoint();
+            guard.lock();
+            last_checkpoint = now;
+        }
+    }
+}
@@ -98,6 +98,11 @@ public:
         }
     }
 
+    void prefetch_block(size_t offset, size_t size) override {
+        // Only a hint, so errors are ignored
+        ::posix_fadvise(fd, offset, size, POSIX_FADV_WILLNEED);
+    }
+
     void write_block(const char* block, size_t offset, size_t size) override {
         size_t total_bytes_written = 0;
         while (total_bytes_written < size) {
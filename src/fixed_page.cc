@@ -0,0 +1,84 @@
+#include "moderndbs/fixed_page.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+using FixedPage = moderndbs::FixedPage;
+
+namespace {
+
+/// Get the size of the bitmap of a page.
+uint32_t get_bitmap_size(uint32_t capacity) {
+    return (capacity + 63) / 64 * sizeof(uint64_t);
+}
+
+}  // namespace
+
+FixedPage::Layout::Layout(uint32_t record_size, uint32_t page_size)
+    : record_size(std::max<uint32_t>(record_size, 1)) {
+    /// every record takes its size plus one bit, reduce the capacity until the bitmap fits as well
+    uint64_t max_capacity = (page_size - sizeof(FixedPage)) * 8ull / (this->record_size * 8ull + 1);
+    max_capacity = std::min<uint64_t>(max_capacity, std::numeric_limits<uint16_t>::max());
+    for (capacity = static_cast<uint16_t>(max_capacity); capacity > 0; --capacity) {
+        records_begin = sizeof(FixedPage) + get_bitmap_size(capacity);
+        if (records_begin + capacity * this->record_size <= page_size) {
+            break;
+        }
+    }
+    records_begin = sizeof(FixedPage) + get_bitmap_size(capacity);
+}
+
+FixedPage::Header::Header(const Layout &layout) {
+    this->slot_count = 0;
+    this->first_free_slot = 0;
+    this->record_count = 0;
+    this->capacity = layout.capacity;
+    this->lsn = 0;
+}
+
+FixedPage::FixedPage(const Layout &layout) : header(layout) {
+    std::memset(get_bitmap(), 0, get_bitmap_size(layout.capacity));
+}
+
+uint16_t FixedPage::allocate() {
+    assert(has_free_slot());
+    uint16_t slot_id = header.first_free_slot;
+    allocate_at(slot_id);
+    return slot_id;
+}
+
+void FixedPage::allocate_at(uint16_t slot_id) {
+    assert(slot_id < header.capacity && !is_occupied(slot_id));
+    auto bitmap = get_bitmap();
+    bitmap[slot_id / 64] |= 1ull << (slot_id % 64);
+    ++header.record_count;
+    header.slot_count = std::max<uint16_t>(header.slot_count, slot_id + 1);
+    if (slot_id != header.first_free_slot) {
+        return;
+    }
+
+    /// find the next free slot, a word at a time
+    uint32_t next = slot_id + 1;
+    while (next < header.capacity) {
+        uint64_t free = ~bitmap[next / 64] >> (next % 64);
+        if (free != 0) {
+            next += __builtin_ctzll(free);
+            break;
+        }
+        next = (next / 64 + 1) * 64;
+    }
+    header.first_free_slot = static_cast<uint16_t>(std::min<uint32_t>(next, header.capacity));
+}
+
+void FixedPage::erase(uint16_t slot_id) {
+    assert(is_occupied(slot_id));
+    get_bitmap()[slot_id / 64] &= ~(1ull << (slot_id % 64));
+    --header.record_count;
+    header.first_free_slot = std::min(header.first_free_slot, slot_id);
+
+    /// drop trailing free slots
+    while (header.slot_count > 0 && !is_occupied(header.slot_count - 1)) {
+        --header.slot_count;
+    }
+}
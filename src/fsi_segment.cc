@@ -1,51 +1,431 @@
+#include <algorithm>
 #include <limits>
+#include <stdexcept>
 #include <vector>
 #include "moderndbs/segment.h"
 
 using Segment = moderndbs::Segment;
 using FSISegment = moderndbs::FSISegment;
 
-FSISegment::FSISegment(uint16_t segment_id, BufferManager& buffer_manager, SchemaSegment &schema)
-    : Segment(segment_id, buffer_manager) {
-    schema.set_fsi_segment(segment_id);
+namespace {
+
+/// The number of children of an inner node
+constexpr uint64_t kFanout = 64;
+/// The number of free-space classes
+constexpr uint8_t kClasses = 16;
+/// The size of the header of a leaf page
+constexpr uint64_t kHeaderSize = 8;
+/// Any class
+constexpr uint16_t kAllClasses = 0xFFFF;
+/// The summary of a leaf page whose classes were read from disk carries this flag
+constexpr uint32_t kKnown = 1u << 16;
+/// Every summary carries a version above its classes, so that a stale summary cannot overwrite a newer one
+constexpr uint32_t kVersion = 1u << 17;
+/// The bits of a summary without its version
+constexpr uint32_t kSummaryBits = kVersion - 1;
+/// The number of slotted pages that the summary covers
+constexpr uint64_t kMaxPages = 1ull << 40;
+/// The number of entries per chunk of the summary (log2)
+constexpr uint64_t kChunkBits = 12;
+/// The number of chunks per directory of the summary (log2)
+constexpr uint64_t kDirectoryBits = 9;
+/// The number of attempts of best fit before it gives up under contention
+constexpr int kMaxAttempts = kClasses + 1;
+
+/// Atomically load a value that is stored on a page.
+template <typename T>
+T load_atomic(const T *value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+/// Atomically replace a value that is stored on a page.
+template <typename T>
+bool compare_exchange(T *value, T &expected, T desired) {
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/// A leaf page of the free-space inventory is structured as follows:
+///   1) A summary of the classes on the page (padded to 8 bytes)
+///   2) A summary of the classes of every group of kFanout slotted pages (4 bytes each, padded to 8 bytes)
+///   3) The classes of the slotted pages (16 pages per 8 byte word)
+/// All values are updated with compare-and-swap.
+struct LeafPage {
+    /// Constructor
+    LeafPage(char *data, uint64_t groups_per_page)
+        : classes(reinterpret_cast<uint32_t*>(data)), groups(reinterpret_cast<uint32_t*>(data + kHeaderSize)),
+          entries(reinterpret_cast<uint64_t*>(data + kHeaderSize + ((groups_per_page * 4 + 7) & ~7ull))) {}
+
+    /// Get the class of a slotted page.
+    uint8_t get_class(uint64_t entry) const {
+        return (load_atomic(&entries[entry / 16]) >> (entry % 16 * 4)) & 0xF;
+    }
+
+    /// Get the classes of a group.
+    uint16_t get_group_classes(uint64_t group) const {
+        uint16_t result = 0;
+        for (uint64_t word = group * kFanout / 16; word < (group + 1) * kFanout / 16; ++word) {
+            uint64_t value = load_atomic(&entries[word]);
+            for (unsigned i = 0; i < 16; ++i) {
+                result |= static_cast<uint16_t>(1u << ((value >> (i * 4)) & 0xF));
+            }
+        }
+        return result;
+    }
+
+    /// Find the first slotted page at or after `begin` with one of the classes.
+    /// Returns `entries_per_page` if there is none.
+    uint64_t find(uint64_t begin, uint16_t mask, uint64_t groups_per_page) const {
+        for (uint64_t group = begin / kFanout; group < groups_per_page; ++group) {
+            if ((load_atomic(&groups[group]) & mask) == 0) {
+                continue;
+            }
+            for (uint64_t entry = std::max(begin, group * kFanout); entry < (group + 1) * kFanout; ++entry) {
+                if ((mask >> get_class(entry)) & 1) {
+                    return entry;
+                }
+            }
+        }
+        return groups_per_page * kFanout;
+    }
+
+    /// Set the class of a slotted page.
+    void set_class(uint64_t entry, uint8_t value) {
+        auto *word = &entries[entry / 16];
+        unsigned shift = entry % 16 * 4;
+        uint64_t expected = load_atomic(word);
+        while (!compare_exchange(word, expected, (expected & ~(uint64_t{0xF} << shift)) | (uint64_t{value} << shift))) {
+        }
+    }
+
+    uint32_t *classes;
+    uint32_t *groups;
+    uint64_t *entries;
+};
+
+/// Replace the summary of a value and increase its version.
+constexpr uint32_t next_version(uint32_t value, uint32_t summary) {
+    return ((value & ~kSummaryBits) + kVersion) | summary;
+}
+
+/// Recompute a summary and install it with a new version.
+/// Writers that computed their summary from older children fail and recompute, so the last write always
+/// reflects the latest children. Returns false if the summary did not change.
+template <typename F>
+bool refresh(uint32_t *value, F compute) {
+    uint32_t expected = load_atomic(value);
+    while (true) {
+        uint32_t summary = compute();
+        if (compare_exchange(value, expected, next_version(expected, summary))) {
+            return (expected & kSummaryBits) != summary;
+        }
+    }
+}
+
+/// Recompute a summary and install it with a new version.
+template <typename F>
+bool refresh(std::atomic<uint32_t> &value, F compute) {
+    uint32_t expected = value.load();
+    while (true) {
+        uint32_t summary = compute();
+        if (value.compare_exchange_weak(expected, next_version(expected, summary))) {
+            return (expected & kSummaryBits) != summary;
+        }
+    }
+}
+
+/// Get the array that a pointer refers to, installing a zeroed array if there is none yet.
+/// Whoever installs the array first wins.
+template <typename T>
+T *get_or_install(std::atomic<T*> &pointer, uint64_t size) {
+    auto *array = pointer.load(std::memory_order_acquire);
+    if (array == nullptr) {
+        auto *new_array = new T[size]();
+        if (pointer.compare_exchange_strong(array, new_array)) {
+            array = new_array;
+        } else {
+            delete[] new_array;
+        }
+    }
+    return array;
+}
+
+/// Get the number of elements of the part of an array of `size` elements that starts at `begin`, if the array is
+/// split into parts of 2^bits elements.
+constexpr uint64_t get_part_size(uint64_t size, uint64_t begin, uint64_t bits) {
+    return std::min(size - begin, uint64_t{1} << bits);
+}
+
+/// Get the classes that are at least as large as a class.
+constexpr uint16_t at_least(uint8_t min_class) {
+    return static_cast<uint16_t>(kAllClasses << min_class);
+}
+
+}  // namespace
+
+FSISegment::FSISegment(uint16_t segment_id, BufferManager& buffer_manager, SchemaSegment &schema,
+                       FitPolicy policy, Encoding encoding, const schema::Table *table)
+    : Segment(segment_id, buffer_manager), segments(schema.get_segments(table)), policy(policy) {
+    segments.fsi_segment_id = segment_id;
+    auto page_size = static_cast<uint64_t>(buffer_manager.get_page_size());
+    for (uint32_t c = 0; c < kClasses; ++c) {
+        if (encoding == kLinear) {
+            boundaries[c] = static_cast<uint32_t>(c * (page_size / kClasses));
+        } else if (c == 0) {
+            boundaries[c] = 0;
+        } else {
+            /// every even class halves the free space, odd classes lie in between
+            uint32_t lower = static_cast<uint32_t>(page_size >> ((kClasses + 1 - c) / 2));
+            boundaries[c] = c % 2 == 0 ? lower : lower + lower / 2;
+        }
+    }
+
+    /// every group of kFanout entries needs kFanout / 2 bytes plus four bytes for its classes
+    groups_per_page = page_size > 2 * kHeaderSize ? (page_size - 2 * kHeaderSize) / (kFanout / 2 + 4) : 0;
+    entries_per_page = groups_per_page * kFanout;
+    if (entries_per_page == 0) {
+        throw std::invalid_argument("page size is too small for the free-space inventory");
+    }
+
+    /// a tree of fixed height whose chunks are allocated when they are first written
+    uint64_t size = (kMaxPages + entries_per_page - 1) / entries_per_page;
+    while (true) {
+        Level level;
+        level.size = size;
+        uint64_t chunk_count = (size + (1ull << kChunkBits) - 1) >> kChunkBits;
+        level.directories = std::make_unique<std::atomic<Directory*>[]>(
+            (chunk_count + (1ull << kDirectoryBits) - 1) >> kDirectoryBits);
+        levels.push_back(std::move(level));
+        if (size == 1) {
+            break;
+        }
+        size = (size + kFanout - 1) / kFanout;
+    }
+}
+
+FSISegment::~FSISegment() {
+    for (auto& level : levels) {
+        uint64_t chunk_count = (level.size + (1ull << kChunkBits) - 1) >> kChunkBits;
+        for (uint64_t i = 0; i << kDirectoryBits < chunk_count; ++i) {
+            auto *directory = level.directories[i].load();
+            if (directory == nullptr) {
+                continue;
+            }
+            for (uint64_t j = 0; j < get_part_size(chunk_count, i << kDirectoryBits, kDirectoryBits); ++j) {
+                delete[] directory[j].load();
+            }
+            delete[] directory;
+        }
+    }
+}
+
+uint8_t FSISegment::encode(uint32_t free_space) const {
+    auto it = std::upper_bound(boundaries.begin(), boundaries.end(), free_space);
+    return static_cast<uint8_t>(it - boundaries.begin() - 1);
+}
+
+uint8_t FSISegment::encode_required(uint32_t required_space) const {
+    auto it = std::lower_bound(boundaries.begin(), boundaries.end(), required_space);
+    return static_cast<uint8_t>(it - boundaries.begin());
+}
+
+uint32_t FSISegment::load(size_t level, uint64_t index) const {
+    uint64_t chunk_id = index >> kChunkBits;
+    auto *directory = levels[level].directories[chunk_id >> kDirectoryBits].load(std::memory_order_acquire);
+    if (directory == nullptr) {
+        return 0;
+    }
+    auto *chunk = directory[chunk_id & ((1ull << kDirectoryBits) - 1)].load(std::memory_order_acquire);
+    return chunk == nullptr ? 0 : chunk[index & ((1ull << kChunkBits) - 1)].load(std::memory_order_acquire);
+}
+
+std::atomic<uint32_t> &FSISegment::get(size_t level, uint64_t index) {
+    /// the last directory and chunk of a level only cover its remaining entries, so the small upper levels stay small
+    uint64_t chunk_id = index >> kChunkBits;
+    uint64_t chunk_count = (levels[level].size + (1ull << kChunkBits) - 1) >> kChunkBits;
+    uint64_t directory_id = chunk_id >> kDirectoryBits;
+    auto *directory = get_or_install(levels[level].directories[directory_id],
+                                     get_part_size(chunk_count, directory_id << kDirectoryBits, kDirectoryBits));
+    auto *chunk = get_or_install(directory[chunk_id & ((1ull << kDirectoryBits) - 1)],
+                                 get_part_size(levels[level].size, chunk_id << kChunkBits, kChunkBits));
+    return chunk[index & ((1ull << kChunkBits) - 1)];
 }
 
+void FSISegment::grow(uint64_t leaf) {
+    uint64_t count = leaf_count.load();
+    while (count <= leaf && !leaf_count.compare_exchange_weak(count, leaf + 1)) {
+    }
+    /// leaf pages that were not read yet might have any class
+    for (uint64_t i = count; i <= leaf; ++i) {
+        uint32_t expected = 0;
+        if (get(0, i).compare_exchange_strong(expected, kAllClasses)) {
+            propagate(i);
+        }
+    }
+}
+
+void FSISegment::propagate(uint64_t leaf) {
+    /// stop as soon as a node does not change, whoever changed it last takes care of its parents
+    uint64_t child = leaf;
+    for (size_t level = 1; level < levels.size(); ++level) {
+        uint64_t node = child / kFanout;
+        uint64_t begin = node * kFanout;
+        bool changed = refresh(get(level, node), [&] {
+            uint32_t node_classes = 0;
+            for (uint64_t i = begin; i < std::min(begin + kFanout, levels[level - 1].size); ++i) {
+                node_classes |= load(level - 1, i) & kAllClasses;
+            }
+            return node_classes;
+        });
+        if (!changed) {
+            break;
+        }
+        child = node;
+    }
+}
 
 void FSISegment::update(uint64_t target_page, uint32_t free_space) {
-    auto sizeForEachBlock = static_cast<int>(buffer_manager.get_page_size() / 16);
-    auto fsi_entries = static_cast<int>(free_space / sizeForEachBlock);
-    /// each vector element contains 2 page ids
-    int vector_position = target_page / 2;
-    if (this->bitmap.size() == 0) {
-        this->bitmap.push_back((15<<4));
+    uint64_t leaf = target_page / entries_per_page;
+    uint64_t entry = target_page % entries_per_page;
+    uint64_t group = entry / kFanout;
+    grow(leaf);
+
+    /// a shared latch suffices, all changes are compare-and-swaps
+    auto& page = buffer_manager.fix_page((static_cast<uint64_t>(segment_id) << 48) | leaf, false);
+    LeafPage leaf_page(page.get_data(), groups_per_page);
+    leaf_page.set_class(entry, encode(free_space));
+
+    /// only the classes of the group and the page can change
+    if (refresh(&leaf_page.groups[group], [&] { return leaf_page.get_group_classes(group); })) {
+        refresh(leaf_page.classes, [&] {
+            uint16_t page_classes = 0;
+            for (uint64_t i = 0; i < groups_per_page; ++i) {
+                page_classes |= static_cast<uint16_t>(load_atomic(&leaf_page.groups[i]));
+            }
+            return page_classes;
+        });
     }
-    if (this->bitmap.size() < target_page) {
-        this->bitmap.push_back((0<<4));
+    bool changed = refresh(get(0, leaf), [&] { return kKnown | (load_atomic(leaf_page.classes) & kAllClasses); });
+    buffer_manager.unfix_page(page, true);
+
+    if (changed) {
+        propagate(leaf);
     }
-    auto& page_pair = *(this->bitmap.data() + vector_position);
-    if (target_page % 2 == 0) {
-        page_pair = ((fsi_entries*1ULL)<<4) | (page_pair & ((1ull << 4) - 1));
-    } else {
-        auto previousPageEmptySpace = static_cast<int>(page_pair>>4);
-        page_pair = (previousPageEmptySpace*1ULL)<<4 | ((fsi_entries*1ULL) & ((1ull << 4) - 1));
+}
+
+uint64_t FSISegment::find_leaf(uint64_t begin, uint16_t classes) const {
+    while (true) {
+        /// climb until a node at or after `begin` has one of the classes
+        uint64_t index = begin;
+        size_t level = 0;
+        while (true) {
+            uint64_t end = std::min((index / kFanout + 1) * kFanout, levels[level].size);
+            while (index < end && (load(level, index) & classes) == 0) {
+                ++index;
+            }
+            if (index < end) {
+                break;
+            }
+            if (level + 1 == levels.size()) {
+                return kNoPage;
+            }
+            index = (end + kFanout - 1) / kFanout;
+            ++level;
+        }
+
+        /// descend to the first leaf page below that node that has one of the classes
+        bool found = true;
+        while (found && level > 0) {
+            --level;
+            uint64_t end = std::min((index + 1) * kFanout, levels[level].size);
+            index *= kFanout;
+            while (index < end && (load(level, index) & classes) == 0) {
+                ++index;
+            }
+            /// the classes might have changed concurrently, then we start over
+            found = index < end;
+        }
+        if (found) {
+            return index;
+        }
+    }
+}
+
+uint64_t FSISegment::find_from(uint64_t begin, uint16_t classes, uint64_t page_count) {
+    uint64_t first_leaf = begin / entries_per_page;
+    uint64_t leaf = find_leaf(first_leaf, classes);
+    while (leaf != kNoPage) {
+        auto& page = buffer_manager.fix_page((static_cast<uint64_t>(segment_id) << 48) | leaf, false);
+        LeafPage leaf_page(page.get_data(), groups_per_page);
+        auto& summary = get(0, leaf);
+        uint32_t expected = summary.load();
+        if ((expected & kKnown) == 0) {
+            /// the first visit after opening the segment, now we know the actual classes
+            uint32_t page_classes = load_atomic(leaf_page.classes) & kAllClasses;
+            bool changed = summary.compare_exchange_strong(expected, next_version(expected, kKnown | page_classes));
+            buffer_manager.unfix_page(page, false);
+            if (changed) {
+                propagate(leaf);
+            }
+            leaf = find_leaf(leaf, classes);
+            continue;
+        }
+        uint64_t entry = leaf_page.find(leaf == first_leaf ? begin % entries_per_page : 0, classes, groups_per_page);
+        buffer_manager.unfix_page(page, false);
+
+        if (entry < entries_per_page) {
+            uint64_t target_page = leaf * entries_per_page + entry;
+            if (target_page < page_count) {
+                return target_page;
+            }
+            /// entries behind the last slotted page are stale, drop them
+            update(target_page, 0);
+            leaf = find_leaf(leaf, classes);
+            continue;
+        }
+        leaf = find_leaf(leaf + 1, classes);
     }
+    return kNoPage;
 }
 
 std::pair<bool, uint64_t> FSISegment::find(uint32_t required_space) {
-    int pageNumber = 0;
-    auto sizeForEachBlock = static_cast<int>(buffer_manager.get_page_size() / 16);
-    int required_fsi_entries = 1 + ((required_space - 1) / sizeForEachBlock);
-    for (uint8_t page_pair : this->bitmap) {
-        auto currentPageEmptySpace = static_cast<int>(page_pair>>4);
-        if (currentPageEmptySpace >= required_fsi_entries) {
-            return { true, pageNumber };
-        }
-        auto nextPageEmptySpace = static_cast<int>(page_pair & ((1ull << 4) - 1));
-        pageNumber++;
-        if (nextPageEmptySpace >= required_fsi_entries) {
-            return { true, pageNumber };
-        }
-        pageNumber++;
-    }
-    return { false, 0 };
-}
\ No newline at end of file
+    uint64_t page_count = segments.sp_count;
+    uint8_t required = encode_required(required_space);
+    if (page_count == 0 || required >= kClasses) {
+        return { false, 0 };
+    }
+    grow((page_count - 1) / entries_per_page);
+
+    uint64_t target_page = kNoPage;
+    switch (policy) {
+        case kFirstFit:
+            target_page = find_from(0, at_least(required), page_count);
+            break;
+        case kNextFit: {
+            /// continue at the last page we found, wrap around once
+            uint64_t begin = cursor.load(std::memory_order_relaxed);
+            target_page = find_from(begin < page_count ? begin : 0, at_least(required), page_count);
+            if (target_page == kNoPage && begin != 0) {
+                target_page = find_from(0, at_least(required), page_count);
+            }
+            break;
+        }
+        case kBestFit: {
+            /// the root knows the smallest class that is large enough
+            size_t root = levels.size() - 1;
+            for (int attempt = 0; attempt < kMaxAttempts && target_page == kNoPage; ++attempt) {
+                uint16_t candidates = static_cast<uint16_t>(load(root, 0)) & at_least(required);
+                if (candidates == 0) {
+                    break;
+                }
+                auto best = static_cast<uint8_t>(__builtin_ctz(candidates));
+                target_page = find_from(0, static_cast<uint16_t>(1u << best), page_count);
+            }
+            break;
+        }
+    }
+    if (target_page == kNoPage) {
+        return { false, 0 };
+    }
+    cursor.store(target_page, std::memory_order_relaxed);
+    return { true, target_page };
+}
@@ -17,12 +17,22 @@ set(
 
 set(
     SRC_CC
+    src/bloom_filter_segment.cc
     src/buffer_manager.cc
+    src/checkpointer.cc
+    src/fixed_page.cc
     src/fsi_segment.cc
+    src/pax_page.cc
+    src/predicate.cc
+    src/record.cc
     src/schema.cc
+    src/schema_json.cc
     src/schema_segment.cc
     src/slotted_page.cc
     src/sp_segment.cc
+    src/vacuum.cc
+    src/wal_segment.cc
+    src/zone_map_segment.cc
 )
 if(UNIX)
     set(SRC_CC ${SRC_CC} src/file/posix_file.cc)
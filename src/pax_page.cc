@@ -0,0 +1,213 @@
+#include "moderndbs/pax_page.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using PaxPage = moderndbs::PaxPage;
+using RecordCodec = moderndbs::RecordCodec;
+using TID = moderndbs::TID;
+using Type = moderndbs::schema::Type;
+
+namespace {
+
+/// The size of the original TID that precedes redirect targets
+constexpr uint32_t kTIDSize = sizeof(uint64_t);
+
+}  // namespace
+
+PaxPage::Layout::Layout(const RecordCodec &codec, uint32_t page_size)
+    : fixed_size(codec.get_fixed_size()) {
+    /// guess the record size assuming that varchars are half full on average
+    uint32_t expected_heap_size = codec.get_varchar_count() * sizeof(uint16_t);
+    for (uint32_t i = 0; i < codec.get_column_count(); ++i) {
+        if (codec.get_column(i).tclass == Type::kVarchar) {
+            expected_heap_size += codec.get_column(i).width / 2;
+        }
+    }
+    uint32_t record_size = sizeof(Slot) + fixed_size + expected_heap_size;
+    uint32_t max_capacity = (page_size - sizeof(PaxPage)) / record_size;
+    max_capacity = std::clamp<uint32_t>(max_capacity, 1, std::numeric_limits<uint16_t>::max());
+
+    minipages.push_back({ 0, codec.get_null_bytes(), 0 });
+    for (uint32_t i = 0; i < codec.get_column_count(); ++i) {
+        const auto &column = codec.get_column(i);
+        if (column.tclass == Type::kVarchar) {
+            column_minipages.push_back(-1);
+        } else {
+            column_minipages.push_back(static_cast<int32_t>(minipages.size()));
+            minipages.push_back({ column.offset, column.width, 0 });
+        }
+    }
+
+    /// place the minipages (8 byte aligned), reduce the capacity until they fit
+    for (capacity = static_cast<uint16_t>(max_capacity); capacity > 0; --capacity) {
+        uint32_t offset = sizeof(PaxPage) + capacity * sizeof(Slot);
+        for (auto &minipage : minipages) {
+            offset = (offset + 7) & ~7u;
+            minipage.page_offset = offset;
+            offset += capacity * minipage.width;
+        }
+        if (offset <= page_size) {
+            heap_begin = offset;
+            break;
+        }
+    }
+    assert(capacity > 0);
+}
+
+PaxPage::Header::Header(const Layout &layout, uint32_t page_size) {
+    this->slot_count = 0;
+    this->first_free_slot = 0;
+    this->capacity = layout.capacity;
+    this->data_start = page_size;
+    this->free_space = page_size - layout.heap_begin;
+    this->heap_begin = layout.heap_begin;
+    this->lsn = 0;
+}
+
+PaxPage::PaxPage(const Layout &layout, uint32_t page_size) : header(layout, page_size) {
+}
+
+uint16_t PaxPage::allocate(uint32_t heap_size, uint32_t page_size) {
+    assert(has_free_slot());
+    uint16_t slot_id = header.first_free_slot;
+    allocate_at(slot_id, heap_size, page_size);
+    return slot_id;
+}
+
+void PaxPage::allocate_at(uint16_t slot_id, uint32_t heap_size, uint32_t page_size) {
+    assert(slot_id < header.capacity && heap_size <= header.free_space);
+    auto slots = get_slots();
+    assert(slot_id >= header.slot_count || slots[slot_id].is_empty());
+    if (heap_size > get_fragmented_free_space()) {
+        compactify(page_size);
+    }
+    /// the slots up to the new one are created empty
+    for (; header.slot_count <= slot_id; ++header.slot_count) {
+        slots[header.slot_count].clear();
+    }
+    header.data_start -= heap_size;
+    header.free_space -= heap_size;
+    slots[slot_id].set_slot(header.data_start, heap_size, false);
+    if (slot_id != header.first_free_slot) {
+        return;
+    }
+
+    /// find the next free slot
+    uint16_t next = slot_id + 1;
+    while (next < header.slot_count && !slots[next].is_empty()) {
+        ++next;
+    }
+    header.first_free_slot = next;
+}
+
+void PaxPage::relocate(uint16_t slot_id, uint32_t heap_size, uint32_t page_size) {
+    auto& slot = get_slots()[slot_id];
+    assert(!slot.is_empty() && !slot.is_redirect());
+    uint32_t offset = slot.get_offset();
+    uint32_t old_size = slot.get_size();
+    bool is_redirect_target = slot.is_redirect_target();
+
+    /// shrinking leaves the tail as fragmented free space
+    if (heap_size <= old_size) {
+        header.free_space += old_size - heap_size;
+        slot.set_slot(offset, heap_size, is_redirect_target);
+        return;
+    }
+    assert(heap_size - old_size <= header.free_space);
+
+    /// move the variable section to the lower end of the heap if it fits there
+    if (heap_size <= get_fragmented_free_space()) {
+        header.data_start -= heap_size;
+        std::memmove(get_data() + header.data_start, get_data() + offset, old_size);
+        header.free_space -= heap_size - old_size;
+        slot.set_slot(header.data_start, heap_size, is_redirect_target);
+        return;
+    }
+
+    /// otherwise, compact the heap with the variable section at its lower end and grow it downwards
+    compactify(page_size, &slot);
+    header.data_start -= heap_size - old_size;
+    header.free_space -= heap_size - old_size;
+    std::memmove(get_data() + header.data_start, get_data() + slot.get_offset(), old_size);
+    slot.set_slot(header.data_start, heap_size, is_redirect_target);
+}
+
+void PaxPage::set_redirect(uint16_t slot_id, TID target) {
+    auto& slot = get_slots()[slot_id];
+    if (!slot.is_redirect()) {
+        header.free_space += slot.get_size();
+        if (slot.get_offset() == header.data_start) {
+            header.data_start += slot.get_size();
+        }
+    }
+    slot.set_redirect_tid(target);
+}
+
+void PaxPage::restore(uint16_t slot_id, uint32_t heap_size, uint32_t page_size) {
+    auto& slot = get_slots()[slot_id];
+    assert(slot.is_redirect() && !slot.is_empty() && heap_size <= header.free_space);
+    if (heap_size > get_fragmented_free_space()) {
+        compactify(page_size);
+    }
+    header.data_start -= heap_size;
+    header.free_space -= heap_size;
+    slot.set_slot(header.data_start, heap_size, false);
+}
+
+void PaxPage::erase(uint16_t slot_id) {
+    auto slots = get_slots();
+    auto& slot = slots[slot_id];
+    if (!slot.is_redirect()) {
+        header.free_space += slot.get_size();
+        if (slot.get_offset() == header.data_start) {
+            header.data_start += slot.get_size();
+        }
+    }
+    slot.clear();
+    header.first_free_slot = std::min(header.first_free_slot, slot_id);
+
+    /// drop trailing empty slots
+    while (header.slot_count > 0 && slots[header.slot_count - 1].is_empty()) {
+        --header.slot_count;
+    }
+    header.first_free_slot = std::min(header.first_free_slot, header.slot_count);
+}
+
+uint32_t PaxPage::copy(const Layout &layout, uint16_t slot_id, std::byte *record, uint32_t size, bool to_page) {
+    const auto& slot = get_slots()[slot_id];
+    uint32_t prefix = slot.is_redirect_target() ? kTIDSize : 0;
+    uint32_t heap_size = slot.get_size() - prefix;
+    size = std::min(size, layout.fixed_size + heap_size);
+
+    /// scatter/gather the fixed-width part
+    for (const auto& minipage : layout.minipages) {
+        if (minipage.record_offset >= size) {
+            break;
+        }
+        auto width = std::min(minipage.width, size - minipage.record_offset);
+        auto value = get_data() + minipage.page_offset + slot_id * minipage.width;
+        if (to_page) {
+            std::memcpy(value, record + minipage.record_offset, width);
+        } else {
+            std::memcpy(record + minipage.record_offset, value, width);
+        }
+    }
+
+    /// copy the variable section
+    if (size > layout.fixed_size) {
+        auto heap = get_data() + slot.get_offset() + prefix;
+        if (to_page) {
+            std::memcpy(heap, record + layout.fixed_size, size - layout.fixed_size);
+        } else {
+            std::memcpy(record + layout.fixed_size, heap, size - layout.fixed_size);
+        }
+    }
+    return size;
+}
+
+void PaxPage::compactify(uint32_t page_size, const Slot *last) {
+    header.data_start = SlottedPage::compact_records(get_data(), get_slots(), header.slot_count, page_size, last);
+}
@@ -0,0 +1,227 @@
+#include "moderndbs/predicate.h"
+#include <cstring>
+#include <utility>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using Predicate = moderndbs::Predicate;
+using Comparison = moderndbs::Predicate::Comparison;
+
+Predicate Predicate::Compare(uint32_t column, Comparison comparison, int64_t value) {
+    Predicate p;
+    p.column = column;
+    p.comparison = comparison;
+    p.lower = value;
+    p.upper = value;
+    return p;
+}
+
+Predicate Predicate::Between(uint32_t column, int64_t lower, int64_t upper) {
+    Predicate p;
+    p.column = column;
+    p.comparison = kBetween;
+    p.lower = lower;
+    p.upper = upper;
+    return p;
+}
+
+Predicate Predicate::Equal(uint32_t column, std::string value) {
+    Predicate p;
+    p.column = column;
+    p.comparison = kEqual;
+    p.lower = 0;
+    p.upper = 0;
+    p.string = std::move(value);
+    return p;
+}
+
+Predicate Predicate::NotEqual(uint32_t column, std::string value) {
+    Predicate p = Equal(column, std::move(value));
+    p.comparison = kNotEqual;
+    return p;
+}
+
+namespace {
+
+template <Comparison C>
+inline bool compare(int64_t value, int64_t lower, int64_t upper) {
+    switch (C) {
+        case Predicate::kEqual:         return value == lower;
+        case Predicate::kNotEqual:      return value != lower;
+        case Predicate::kLess:          return value < lower;
+        case Predicate::kLessEqual:     return value <= lower;
+        case Predicate::kGreater:       return value > lower;
+        case Predicate::kGreaterEqual:  return value >= lower;
+        case Predicate::kBetween:       return lower <= value && value <= upper;
+    }
+    return false;
+}
+
+/// Evaluate the values [begin, count) with scalar code.
+template <Comparison C>
+void filter_tail(const int64_t *values, uint32_t begin, uint32_t count, int64_t lower, int64_t upper, uint64_t *mask) {
+    for (uint32_t word = begin / 64; word * 64 < count; ++word) {
+        uint64_t bits = 0;
+        for (uint32_t i = word * 64; i < count && i < (word + 1) * 64; ++i) {
+            bits |= static_cast<uint64_t>(compare<C>(values[i], lower, upper)) << (i % 64);
+        }
+        mask[word] &= bits;
+    }
+}
+
+template <Comparison C>
+void filter_scalar(const int64_t *values, uint32_t count, int64_t lower, int64_t upper, uint64_t *mask) {
+    filter_tail<C>(values, 0, count, lower, upper, mask);
+}
+
+#if defined(__x86_64__)
+
+template <Comparison C>
+__attribute__((target("sse4.2")))
+void filter_sse42(const int64_t *values, uint32_t count, int64_t lower, int64_t upper, uint64_t *mask) {
+    const __m128i l = _mm_set1_epi64x(lower);
+    const __m128i u = _mm_set1_epi64x(upper);
+    uint32_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        uint64_t bits = 0;
+        for (uint32_t j = 0; j < 64; j += 2) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + j));
+            __m128i r;
+            bool negate = false;
+            switch (C) {
+                case Predicate::kEqual:         r = _mm_cmpeq_epi64(x, l); break;
+                case Predicate::kNotEqual:      r = _mm_cmpeq_epi64(x, l); negate = true; break;
+                case Predicate::kLess:          r = _mm_cmpgt_epi64(l, x); break;
+                case Predicate::kLessEqual:     r = _mm_cmpgt_epi64(x, l); negate = true; break;
+                case Predicate::kGreater:       r = _mm_cmpgt_epi64(x, l); break;
+                case Predicate::kGreaterEqual:  r = _mm_cmpgt_epi64(l, x); negate = true; break;
+                case Predicate::kBetween:
+                    r = _mm_or_si128(_mm_cmpgt_epi64(l, x), _mm_cmpgt_epi64(x, u));
+                    negate = true;
+                    break;
+            }
+            auto m = static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(r)));
+            bits |= (negate ? m ^ 0x3 : m) << j;
+        }
+        mask[i / 64] &= bits;
+    }
+    filter_tail<C>(values, i, count, lower, upper, mask);
+}
+
+template <Comparison C>
+__attribute__((target("avx2")))
+void filter_avx2(const int64_t *values, uint32_t count, int64_t lower, int64_t upper, uint64_t *mask) {
+    const __m256i l = _mm256_set1_epi64x(lower);
+    const __m256i u = _mm256_set1_epi64x(upper);
+    uint32_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        uint64_t bits = 0;
+        for (uint32_t j = 0; j < 64; j += 4) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + j));
+            __m256i r;
+            bool negate = false;
+            switch (C) {
+                case Predicate::kEqual:         r = _mm256_cmpeq_epi64(x, l); break;
+                case Predicate::kNotEqual:      r = _mm256_cmpeq_epi64(x, l); negate = true; break;
+                case Predicate::kLess:          r = _mm256_cmpgt_epi64(l, x); break;
+                case Predicate::kLessEqual:     r = _mm256_cmpgt_epi64(x, l); negate = true; break;
+                case Predicate::kGreater:       r = _mm256_cmpgt_epi64(x, l); break;
+                case Predicate::kGreaterEqual:  r = _mm256_cmpgt_epi64(l, x); negate = true; break;
+                case Predicate::kBetween:
+                    r = _mm256_or_si256(_mm256_cmpgt_epi64(l, x), _mm256_cmpgt_epi64(x, u));
+                    negate = true;
+                    break;
+            }
+            auto m = static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(r)));
+            bits |= (negate ? m ^ 0xF : m) << j;
+        }
+        mask[i / 64] &= bits;
+    }
+    filter_tail<C>(values, i, count, lower, upper, mask);
+}
+
+#endif
+
+using Kernel = void (*)(const int64_t*, uint32_t, int64_t, int64_t, uint64_t*);
+
+/// The kernels of one instruction set, indexed by comparison
+struct KernelSet {
+    const char *name;
+    Kernel kernels[7];
+};
+
+#define MODERNDBS_KERNEL_SET(NAME, FN) \
+    KernelSet{ NAME, { FN<Predicate::kEqual>, FN<Predicate::kNotEqual>, FN<Predicate::kLess>, \
+        FN<Predicate::kLessEqual>, FN<Predicate::kGreater>, FN<Predicate::kGreaterEqual>, FN<Predicate::kBetween> } }
+
+const KernelSet kScalarKernels = MODERNDBS_KERNEL_SET("scalar", filter_scalar);
+
+/// Choose the kernels for the CPU we are running on.
+const KernelSet &select_kernels() {
+#if defined(__x86_64__)
+    static const KernelSet kAVX2Kernels = MODERNDBS_KERNEL_SET("avx2", filter_avx2);
+    static const KernelSet kSSE42Kernels = MODERNDBS_KERNEL_SET("sse4.2", filter_sse42);
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return kAVX2Kernels;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return kSSE42Kernels;
+    }
+#endif
+    return kScalarKernels;
+}
+
+#undef MODERNDBS_KERNEL_SET
+
+const KernelSet &get_kernels() {
+    static const KernelSet &kernels = select_kernels();
+    return kernels;
+}
+
+}  // namespace
+
+namespace moderndbs {
+namespace simd {
+
+void filter_int64(const int64_t *values, uint32_t count, Comparison comparison,
+                  int64_t lower, int64_t upper, uint64_t *mask) {
+    get_kernels().kernels[comparison](values, count, lower, upper, mask);
+}
+
+void filter_int64_scalar(const int64_t *values, uint32_t count, Comparison comparison,
+                         int64_t lower, int64_t upper, uint64_t *mask) {
+    kScalarKernels.kernels[comparison](values, count, lower, upper, mask);
+}
+
+void filter_char(const std::byte *values, uint32_t width, uint32_t count, const std::byte *constant, bool equal,
+                 uint64_t *mask) {
+    for (uint32_t word = 0; word * 64 < count; ++word) {
+        uint64_t bits = 0;
+        for (uint32_t i = word * 64; i < count && i < (word + 1) * 64; ++i) {
+            bool is_equal = std::memcmp(values + i * width, constant, width) == 0;
+            bits |= static_cast<uint64_t>(is_equal == equal) << (i % 64);
+        }
+        mask[word] &= bits;
+    }
+}
+
+uint32_t to_selection_vector(const uint64_t *mask, uint32_t count, uint16_t *selection) {
+    uint32_t selected = 0;
+    for (uint32_t word = 0; word * 64 < count; ++word) {
+        uint64_t bits = mask[word];
+        while (bits != 0) {
+            selection[selected++] = static_cast<uint16_t>(word * 64 + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+    return selected;
+}
+
+const char *get_kernel_name() {
+    return get_kernels().name;
+}
+
+}  // namespace simd
+}  // namespace moderndbs
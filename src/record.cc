@@ -0,0 +1,220 @@
+#include "moderndbs/record.h"
+#include "moderndbs/error.h"
+#include <limits>
+#include <string>
+
+using RecordCodec = moderndbs::RecordCodec;
+using Value = moderndbs::Value;
+using Type = moderndbs::schema::Type;
+using Table = moderndbs::schema::Table;
+
+RecordCodec::RecordCodec(const Table &table)
+    : null_bytes((table.columns.size() + 7) / 8), varchar_count(0) {
+    uint32_t offset = null_bytes;
+    uint32_t max_payload = 0;
+    for (const auto &column : table.columns) {
+        names.push_back(column.id);
+        ColumnLayout layout{};
+        layout.tclass = column.type.tclass;
+        switch (column.type.tclass) {
+            case Type::kInteger:
+            case Type::kTimestamp:
+            case Type::kNumeric:
+                layout.offset = offset;
+                layout.width = sizeof(int64_t);
+                offset += layout.width;
+                break;
+            case Type::kChar:
+                layout.offset = offset;
+                layout.width = column.type.length;
+                offset += layout.width;
+                break;
+            case Type::kVarchar:
+                layout.width = column.type.length;
+                layout.var_index = static_cast<uint16_t>(varchar_count++);
+                max_payload += layout.width;
+                break;
+        }
+        columns.push_back(layout);
+    }
+    fixed_size = offset;
+    max_size = fixed_size + varchar_count * sizeof(uint16_t) + max_payload;
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        column_ids.emplace(names[i], i);
+    }
+    for (const auto &name : table.primary_key) {
+        auto column = find_column(name);
+        if (column == get_column_count()) {
+            throw RecordCodecError("unknown primary key column " + name);
+        }
+        key_columns.push_back(column);
+        key_size += columns[column].width;
+    }
+}
+
+uint32_t RecordCodec::find_column(std::string_view name) const {
+    auto it = column_ids.find(name);
+    return it == column_ids.end() ? get_column_count() : it->second;
+}
+
+uint32_t RecordCodec::get_encoded_size(const std::vector<Value> &tuple) const {
+    uint32_t size = fixed_size + varchar_count * sizeof(uint16_t);
+    for (uint32_t i = 0; i < columns.size() && i < tuple.size(); ++i) {
+        if (columns[i].tclass == Type::kVarchar) {
+            if (auto value = std::get_if<std::string>(&tuple[i])) {
+                size += value->size();
+            }
+        }
+    }
+    return size;
+}
+
+uint32_t RecordCodec::encode(const std::vector<Value> &tuple, std::byte *record, uint32_t capacity) const {
+    if (tuple.size() != columns.size()) {
+        throw RecordCodecError("tuple has " + std::to_string(tuple.size()) + " values, expected " + std::to_string(columns.size()));
+    }
+    uint32_t size = get_encoded_size(tuple);
+    if (size > capacity) {
+        throw RecordCodecError("record buffer too small");
+    }
+    std::memset(record, 0, fixed_size);
+    auto var_table = record + fixed_size;
+    auto payload = var_table + varchar_count * sizeof(uint16_t);
+    uint32_t payload_size = 0;
+    for (uint32_t i = 0; i < columns.size(); ++i) {
+        const auto &layout = columns[i];
+        const auto &value = tuple[i];
+        if (std::holds_alternative<std::monostate>(value)) {
+            record[i >> 3] |= std::byte{static_cast<uint8_t>(1u << (i & 7))};
+        } else if (layout.tclass == Type::kChar || layout.tclass == Type::kVarchar) {
+            auto string = std::get_if<std::string>(&value);
+            if (string == nullptr) {
+                throw RecordCodecError("expected a string for column " + names[i]);
+            }
+            if (string->size() > layout.width) {
+                throw RecordCodecError("value too long for column " + names[i]);
+            }
+            if (layout.tclass == Type::kChar) {
+                std::memcpy(record + layout.offset, string->data(), string->size());
+            } else {
+                std::memcpy(payload + payload_size, string->data(), string->size());
+                payload_size += string->size();
+            }
+        } else {
+            auto integer = std::get_if<int64_t>(&value);
+            if (integer == nullptr) {
+                throw RecordCodecError("expected an integer for column " + names[i]);
+            }
+            std::memcpy(record + layout.offset, integer, sizeof(int64_t));
+        }
+        if (layout.tclass == Type::kVarchar) {
+            if (payload_size > std::numeric_limits<uint16_t>::max()) {
+                throw RecordCodecError("varchar payload too large");
+            }
+            auto end = static_cast<uint16_t>(payload_size);
+            std::memcpy(var_table + layout.var_index * sizeof(uint16_t), &end, sizeof(uint16_t));
+        }
+    }
+    return size;
+}
+
+std::vector<std::byte> RecordCodec::encode(const std::vector<Value> &tuple) const {
+    std::vector<std::byte> record(get_encoded_size(tuple));
+    encode(tuple, record.data(), static_cast<uint32_t>(record.size()));
+    return record;
+}
+
+std::vector<Value> RecordCodec::decode(const std::byte *record) const {
+    std::vector<Value> tuple;
+    tuple.reserve(columns.size());
+    for (uint32_t i = 0; i < columns.size(); ++i) {
+        tuple.push_back(get_value(record, i));
+    }
+    return tuple;
+}
+
+Value RecordCodec::get_value(const std::byte *record, uint32_t column) const {
+    if (is_null(record, column)) {
+        return std::monostate{};
+    }
+    switch (columns[column].tclass) {
+        case Type::kInteger:    return get<Type::kInteger>(record, column);
+        case Type::kTimestamp:  return get<Type::kTimestamp>(record, column);
+        case Type::kNumeric:    return get<Type::kNumeric>(record, column);
+        case Type::kChar:       return std::string(get<Type::kChar>(record, column));
+        case Type::kVarchar:    return std::string(get<Type::kVarchar>(record, column));
+    }
+    return std::monostate{};
+}
+
+uint32_t RecordCodec::get_record_size(const std::byte *record) const {
+    if (varchar_count == 0) {
+        return fixed_size;
+    }
+    return get_varchar_bounds(record, static_cast<uint16_t>(varchar_count - 1)).second;
+}
+
+std::byte *RecordCodec::encode_key_column(uint32_t column, const Value &value, std::byte *encoded_key) const {
+    const auto &layout = columns[column];
+    if (layout.tclass == Type::kChar || layout.tclass == Type::kVarchar) {
+        auto string = std::get_if<std::string>(&value);
+        if (string == nullptr || string->size() > layout.width) {
+            throw RecordCodecError("invalid key value for column " + names[column]);
+        }
+        std::memcpy(encoded_key, string->data(), string->size());
+        std::memset(encoded_key + string->size(), 0, layout.width - string->size());
+        return encoded_key + layout.width;
+    }
+    auto integer = std::get_if<int64_t>(&value);
+    if (integer == nullptr) {
+        throw RecordCodecError("invalid key value for column " + names[column]);
+    }
+    /// big-endian with a flipped sign bit, so that memcmp orders negative values first
+    auto bits = static_cast<uint64_t>(*integer) ^ (1ull << 63);
+    for (int i = 7; i >= 0; --i) {
+        encoded_key[i] = std::byte{static_cast<uint8_t>(bits)};
+        bits >>= 8;
+    }
+    return encoded_key + sizeof(int64_t);
+}
+
+void RecordCodec::encode_key(const std::vector<Value> &key, std::byte *encoded_key) const {
+    if (key.size() != key_columns.size()) {
+        throw RecordCodecError("key has " + std::to_string(key.size()) + " values, expected " +
+                               std::to_string(key_columns.size()));
+    }
+    for (uint32_t i = 0; i < key_columns.size(); ++i) {
+        encoded_key = encode_key_column(key_columns[i], key[i], encoded_key);
+    }
+}
+
+void RecordCodec::encode_key(const std::byte *record, std::byte *encoded_key) const {
+    for (auto column : key_columns) {
+        encoded_key = encode_key_column(column, get_value(record, column), encoded_key);
+    }
+}
+
+bool RecordCodec::try_encode_key(const std::byte *record, uint32_t size, std::byte *encoded_key) const {
+    if (size < null_bytes) {
+        return false;
+    }
+    for (auto column : key_columns) {
+        const auto &layout = columns[column];
+        if (is_null(record, column)) {
+            return false;
+        }
+        if (layout.tclass == Type::kVarchar) {
+            if (size < fixed_size + varchar_count * sizeof(uint16_t)) {
+                return false;
+            }
+            auto [begin, end] = get_varchar_bounds(record, layout.var_index);
+            if (begin > end || end > size || end - begin > layout.width) {
+                return false;
+            }
+        } else if (layout.offset + layout.width > size) {
+            return false;
+        }
+    }
+    encode_key(record, encoded_key);
+    return true;
+}
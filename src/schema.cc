@@ -57,3 +57,11 @@ const char *Type::name() const {
         default:            return "unknown";
     }
 }
+
+const char *Table::layout_name() const {
+    switch (layout) {
+        case kRowStore:     return "row";
+        case kPAX:          return "pax";
+        default:            return "unknown";
+    }
+}
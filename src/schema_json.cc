@@ -0,0 +1,70 @@
+#include "moderndbs/schema.h"
+#include "moderndbs/segment.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/document.h"
+#include <string>
+
+using SchemaSegment = moderndbs::SchemaSegment;
+using TableSegments = moderndbs::TableSegments;
+
+namespace {
+
+/// Export the segments of a table.
+rapidjson::Value segments_to_json(const TableSegments &segments, rapidjson::Document::AllocatorType &allocator) {
+    rapidjson::Value value(rapidjson::Type::kObjectType);
+    value.AddMember("sp_segment", static_cast<unsigned>(segments.sp_segment_id), allocator);
+    value.AddMember("fsi_segment", static_cast<unsigned>(segments.fsi_segment_id), allocator);
+    value.AddMember("zone_map_segment", static_cast<unsigned>(segments.zone_map_segment_id), allocator);
+    value.AddMember("bloom_filter_segment", static_cast<unsigned>(segments.bloom_filter_segment_id), allocator);
+    value.AddMember("sp_count", segments.sp_count.load(), allocator);
+    return value;
+}
+
+}  // namespace
+
+std::string SchemaSegment::to_json() const {
+    rapidjson::Document jsonDoc;
+    jsonDoc.SetObject();
+    rapidjson::Value tables(rapidjson::Type::kArrayType);
+    rapidjson::Document::AllocatorType &allocator = jsonDoc.GetAllocator();
+
+    /// the segment ids help to match the schema with the files on disk
+    jsonDoc.AddMember("segments", segments_to_json(segments, allocator), allocator);
+
+    if (schema) {
+        for (size_t i = 0; i < schema->tables.size(); ++i) {
+            const auto& t = schema->tables[i];
+            rapidjson::Value table(rapidjson::Type::kObjectType);
+            table.AddMember("id", rapidjson::Value(t.id.c_str(), allocator), allocator);
+            table.AddMember("segments", segments_to_json(*table_segments[i], allocator), allocator);
+
+            rapidjson::Value columns(rapidjson::Type::kArrayType);
+            for (const auto& c : t.columns) {
+                rapidjson::Value column(rapidjson::Type::kObjectType);
+                column.AddMember("id", rapidjson::Value(c.id.c_str(), allocator), allocator);
+                rapidjson::Value type(rapidjson::Type::kObjectType);
+                type.AddMember("tclass", rapidjson::Value(c.type.name(), allocator), allocator);
+                type.AddMember("length", c.type.length, allocator);
+                type.AddMember("precision", c.type.precision, allocator);
+                column.AddMember("type", type, allocator);
+                columns.PushBack(column, allocator);
+            }
+            table.AddMember("columns", columns, allocator);
+
+            rapidjson::Value primary_key(rapidjson::Type::kArrayType);
+            for (const auto& k : t.primary_key) {
+                primary_key.PushBack(rapidjson::Value(k.c_str(), allocator), allocator);
+            }
+            table.AddMember("primary_key", primary_key, allocator);
+            table.AddMember("layout", rapidjson::Value(t.layout_name(), allocator), allocator);
+            tables.PushBack(table, allocator);
+        }
+    }
+    jsonDoc.AddMember("tables", tables, allocator);
+
+    rapidjson::StringBuffer strbuf;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
+    jsonDoc.Accept(writer);
+    return std::string(strbuf.GetString(), strbuf.GetSize());
+}
@@ -1,32 +1,229 @@
 #include "moderndbs/schema.h"
 #include "moderndbs/segment.h"
 #include "moderndbs/error.h"
-#include "rapidjson/writer.h"
-#include "rapidjson/stringbuffer.h"
-#include "rapidjson/document.h"
-#include "rapidjson/error/en.h"
 #include "moderndbs/buffer_manager.h"
-#include "moderndbs/file.h"
-#include <limits>
+#include <algorithm>
 #include <cstring>
-#include <sstream>
+#include <stdexcept>
 #include <string>
-#include <iostream>
+#include <vector>
 
 using Segment = moderndbs::Segment;
 using SchemaSegment = moderndbs::SchemaSegment;
+using SchemaParseError = moderndbs::SchemaParseError;
 using Schema = moderndbs::schema::Schema;
 using Type = moderndbs::schema::Type;
 using Table = moderndbs::schema::Table;
 using Column = moderndbs::schema::Column;
-using BufferFrame = moderndbs::BufferFrame;
+using TableSegments = moderndbs::TableSegments;
+using RecordCodec = moderndbs::RecordCodec;
+using BufferManager = moderndbs::BufferManager;
+
+namespace {
+
+/// Identifies a schema segment ("MDBS")
+constexpr uint32_t kMagic = 0x5342444D;
+/// The version of the catalog format
+constexpr uint32_t kVersion = 4;
+
+/// The header of the schema segment.
+/// It is followed by the segments that are shared by the schema, the segments of every table and the serialized
+/// schema.
+struct Header {
+    /// The magic number
+    uint32_t magic;
+    /// The version of the catalog format
+    uint32_t version;
+    /// The number of tables
+    uint32_t table_count;
+    /// Padding
+    uint32_t padding;
+    /// The length of the serialized schema (in #bytes)
+    uint64_t schema_size;
+};
+static_assert(sizeof(Header) == 24, "the header must not contain implicit padding");
+
+/// The segments of a table on disk
+struct SegmentEntry {
+    /// The segment id of the slotted pages
+    uint16_t sp_segment_id;
+    /// The segment id of the free-space inventory
+    uint16_t fsi_segment_id;
+    /// The segment id of the zone maps
+    uint16_t zone_map_segment_id;
+    /// The segment id of the Bloom filter
+    uint16_t bloom_filter_segment_id;
+    /// The number of slotted pages
+    uint64_t sp_count;
+    /// The number of slotted pages that records may have been forwarded from
+    uint64_t forward_limit;
+};
+static_assert(sizeof(SegmentEntry) == 24, "the entry must not contain implicit padding");
+
+/// Copy bytes from the pages of a segment.
+void read_bytes(BufferManager &buffer_manager, uint16_t segment_id, uint64_t offset, char *data, uint64_t size) {
+    uint64_t page_size = buffer_manager.get_page_size();
+    while (size > 0) {
+        uint64_t length = std::min(size, page_size - offset % page_size);
+        auto& page = buffer_manager.fix_page((static_cast<uint64_t>(segment_id) << 48) | (offset / page_size), false);
+        std::memcpy(data, page.get_data() + offset % page_size, length);
+        buffer_manager.unfix_page(page, false);
+        data += length;
+        offset += length;
+        size -= length;
+    }
+}
+
+/// Copy bytes to the pages of a segment.
+void write_bytes(BufferManager &buffer_manager, uint16_t segment_id, uint64_t offset, const char *data,
+                 uint64_t size) {
+    uint64_t page_size = buffer_manager.get_page_size();
+    while (size > 0) {
+        uint64_t length = std::min(size, page_size - offset % page_size);
+        auto& page = buffer_manager.fix_page((static_cast<uint64_t>(segment_id) << 48) | (offset / page_size), true);
+        std::memcpy(page.get_data() + offset % page_size, data, length);
+        buffer_manager.unfix_page(page, true);
+        data += length;
+        offset += length;
+        size -= length;
+    }
+}
+
+/// Appends fixed-width values and length-prefixed strings to a buffer.
+class CatalogWriter {
+    public:
+    /// Constructor
+    explicit CatalogWriter(std::vector<char> &buffer) : buffer(buffer) {}
+
+    /// Append a fixed-width value.
+    template <typename T>
+    void put(T value) {
+        auto offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        std::memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    /// Append a string.
+    void put(const std::string &value) {
+        put(static_cast<uint32_t>(value.size()));
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    private:
+    std::vector<char> &buffer;
+};
+
+/// Reads the values of a CatalogWriter in the same order.
+class CatalogReader {
+    public:
+    /// Constructor
+    CatalogReader(const char *data, size_t size) : data(data), size(size) {}
+
+    /// Read a fixed-width value.
+    template <typename T>
+    T get() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    /// Read a string.
+    std::string get_string() {
+        auto length = get<uint32_t>();
+        return std::string(take(length), length);
+    }
+
+    private:
+    /// Consume bytes.
+    const char *take(size_t length) {
+        if (length > size - offset) {
+            throw SchemaParseError("schema segment is truncated");
+        }
+        offset += length;
+        return data + offset - length;
+    }
+
+    const char *data;
+    size_t size;
+    size_t offset = 0;
+};
+
+}  // namespace
 
 SchemaSegment::SchemaSegment(uint16_t segment_id, BufferManager& buffer_manager)
-    : Segment(segment_id, buffer_manager) {
+    : Segment(segment_id, buffer_manager), stored_segments(1) {
+}
+
+SchemaSegment::~SchemaSegment() {
+    auto current = collect_segments();
+    bool segments_changed = !std::equal(current.begin(), current.end(), stored_segments.begin(), stored_segments.end(),
+        [](const TableSegments &a, const TableSegments &b) {
+            return a.sp_segment_id == b.sp_segment_id && a.fsi_segment_id == b.fsi_segment_id
+                && a.zone_map_segment_id == b.zone_map_segment_id
+                && a.bloom_filter_segment_id == b.bloom_filter_segment_id && a.sp_count == b.sp_count
+                && a.forward_limit == b.forward_limit;
+        });
+    if (schema_changed || segments_changed) {
+        checkpoint();
+    }
 }
 
 void SchemaSegment::set_schema(std::unique_ptr<Schema> new_schema) {
+    /// tables are identified by name
+    std::vector<std::unique_ptr<TableSegments>> new_segments;
+    new_segments.reserve(new_schema->tables.size());
+    for (const auto& table : new_schema->tables) {
+        auto table_id = find_table(table.id);
+        if (table_id != kNotFound && table_segments[table_id]) {
+            new_segments.push_back(std::move(table_segments[table_id]));
+        } else {
+            new_segments.push_back(std::make_unique<TableSegments>());
+        }
+    }
     this->schema = std::move(new_schema);
+    this->table_segments = std::move(new_segments);
+    this->schema_changed = true;
+    index_tables();
+}
+
+void SchemaSegment::index_tables() {
+    table_ids.clear();
+    codecs.clear();
+    for (uint32_t i = 0; i < schema->tables.size(); ++i) {
+        table_ids.emplace(schema->tables[i].id, i);
+        codecs.push_back(std::make_unique<RecordCodec>(schema->tables[i]));
+    }
+}
+
+std::vector<moderndbs::TableSegments> SchemaSegment::collect_segments() const {
+    std::vector<TableSegments> result;
+    result.reserve(1 + table_segments.size());
+    result.push_back(segments);
+    for (const auto& table : table_segments) {
+        result.push_back(*table);
+    }
+    return result;
+}
+
+uint32_t SchemaSegment::find_table(std::string_view name) const {
+    auto it = table_ids.find(name);
+    return it == table_ids.end() ? kNotFound : it->second;
+}
+
+uint32_t SchemaSegment::find_column(uint32_t table, std::string_view name) const {
+    auto column = codecs[table]->find_column(name);
+    return column == codecs[table]->get_column_count() ? kNotFound : column;
+}
+
+TableSegments &SchemaSegment::get_segments(const schema::Table *table) {
+    if (table == nullptr) {
+        return segments;
+    }
+    auto table_id = find_table(table->id);
+    if (table_id == kNotFound) {
+        throw std::invalid_argument("table " + table->id + " is not part of the schema");
+    }
+    return *table_segments[table_id];
 }
 
 Schema *SchemaSegment::get_schema() {
@@ -34,249 +231,177 @@ Schema *SchemaSegment::get_schema() {
 }
 
 uint64_t SchemaSegment::get_sp_count() {
-    return this->number_of_sp;
+    return this->segments.sp_count;
 }
 
 void SchemaSegment::set_fsi_segment(uint16_t segment) {
-    this->fsi_segment_id = segment;
+    this->segments.fsi_segment_id = segment;
 }
 
 uint16_t SchemaSegment::get_fsi_segment() {
-    return this->fsi_segment_id;
+    return this->segments.fsi_segment_id;
+}
+
+void SchemaSegment::set_zone_map_segment(uint16_t segment) {
+    this->segments.zone_map_segment_id = segment;
+}
+
+uint16_t SchemaSegment::get_zone_map_segment() {
+    return this->segments.zone_map_segment_id;
 }
 
 void SchemaSegment::set_sp_segment(uint16_t segment) {
-    this->sp_segment_id = segment;
+    this->segments.sp_segment_id = segment;
 }
 
 uint16_t SchemaSegment::get_sp_segment() {
-    return this->sp_segment_id;
+    return this->segments.sp_segment_id;
 }
 
 void SchemaSegment::increase_sp_count() {
-    this->number_of_sp += 1;
+    this->segments.sp_count += 1;
 }
 
-void SchemaSegment::read() {
-    size_t pageSize = buffer_manager.get_page_size();
-    //std::cout << "segment id: " << segment_id << std::endl;
-    std::string file_name = std::to_string(segment_id);
-    //std::cout << "file_name: " << file_name << std::endl;
-    const char* filename = file_name.c_str();
-    auto file = File::open_file(filename, File::WRITE);
-    size_t offSet = 0;
-    uint64_t segment_page = 0;
-    std::string serializedSchema;
-    uint64_t stringSize = 0;
-    size_t headerSize = 0;
-    size_t fileSize = file->size();
-    if (fileSize < pageSize) {
-        uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | segment_page;
-        auto& page = this->buffer_manager.fix_page(page_id, false);
-        uint64_t segmentPageId = this->buffer_manager.get_segment_page_id(page_id);
-
-        if (offSet == 0) {
-            file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint16_t), reinterpret_cast<char *>(&this->sp_segment_id));
-            headerSize += sizeof(uint16_t);
-            file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint16_t), reinterpret_cast<char *>(&this->fsi_segment_id));
-            headerSize += sizeof(uint16_t);
-            file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint64_t), reinterpret_cast<char *>(&this->number_of_sp));
-            headerSize += sizeof(uint64_t);
-            file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint64_t), reinterpret_cast<char *>(&stringSize));
-            serializedSchema.resize(stringSize);
-            headerSize += sizeof(uint64_t);
-        }
-
-        file->read_block((segmentPageId * pageSize) + headerSize, (fileSize - headerSize), page.get_data());
-        memcpy(serializedSchema.data(), page.get_data(), (fileSize - headerSize));
-
-    } else {
-        while (offSet + pageSize <= fileSize) {
-            uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | segment_page;
-            auto& page = this->buffer_manager.fix_page(page_id, false);
-            uint64_t segmentPageId = this->buffer_manager.get_segment_page_id(page_id);
-
-            if (offSet == 0) {
-                file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint16_t), reinterpret_cast<char *>(&this->sp_segment_id));
-                headerSize += sizeof(uint16_t);
-                file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint16_t), reinterpret_cast<char *>(&this->fsi_segment_id));
-                headerSize += sizeof(uint16_t);
-                file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint64_t), reinterpret_cast<char *>(&this->number_of_sp));
-                headerSize += sizeof(uint64_t);
-                file->read_block((segmentPageId * pageSize) + headerSize, sizeof(uint64_t), reinterpret_cast<char *>(&stringSize));
-                serializedSchema.resize(stringSize);
-                headerSize += sizeof(uint64_t);
+void SchemaSegment::checkpoint() {
+    uint32_t table_count = schema ? static_cast<uint32_t>(schema->tables.size()) : 0;
+    uint64_t schema_offset = sizeof(Header) + (1 + table_count) * sizeof(SegmentEntry);
+    if (schema_changed) {
+        /// the tables are length-prefixed:
+        ///   id, layout, #columns, (id, type class, length, precision)*, #primary key columns, (id)*
+        std::vector<char> buffer;
+        CatalogWriter writer(buffer);
+        writer.put(table_count);
+        for (const auto& table : schema->tables) {
+            writer.put(table.id);
+            writer.put(static_cast<uint8_t>(table.layout));
+            writer.put(static_cast<uint32_t>(table.columns.size()));
+            for (const auto& column : table.columns) {
+                writer.put(column.id);
+                writer.put(static_cast<uint8_t>(column.type.tclass));
+                writer.put(column.type.length);
+                writer.put(column.type.precision);
+            }
+            writer.put(static_cast<uint32_t>(table.primary_key.size()));
+            for (const auto& key : table.primary_key) {
+                writer.put(key);
             }
-
-            file->read_block((segmentPageId * pageSize) + headerSize, pageSize, page.get_data());
-            memcpy(serializedSchema.data(), page.get_data() + offSet, pageSize);
-            ++segment_page;
-            offSet += pageSize;
-        }
-
-        if (offSet < fileSize) {
-            uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | segment_page;
-            auto& page = this->buffer_manager.fix_page(page_id, false);
-            uint64_t segmentPageId = this->buffer_manager.get_segment_page_id(page_id);
-            file->read_block((segmentPageId * pageSize) + headerSize, (file->size() - offSet), page.get_data());
-            memcpy(serializedSchema.data() + offSet, page.get_data(), (file->size() - offSet));
         }
+        write_bytes(buffer_manager, segment_id, schema_offset, buffer.data(), buffer.size());
+        schema_size = buffer.size();
+        schema_changed = false;
     }
 
-    std::vector<Table> tables;
-    if (serializedSchema != "") {
-        rapidjson::Document document;
-        document.Parse<rapidjson::kParseStopWhenDoneFlag>(serializedSchema.c_str());
-        if (document.HasParseError()) {
-            std::cout << "parse error:" << rapidjson::GetParseError_En(document.GetParseError()) << " offset:" << document.GetErrorOffset() << std::endl;
-        }
-        const auto& doc = document.GetObject();
-        for(const auto& t : doc["tables"].GetArray()){
-            const auto& table = t.GetObject();
-            std::string tableId = table["id"].GetString();
-
-            std::vector<Column> columns;
-            for(const auto& c : table["columns"].GetArray()){
-                const auto& column = c.GetObject();
-
-                std::string typeId = column["id"].GetString();
-
-                const auto& type = column["type"].GetObject();
-                std::string tclass = type["tclass"].GetString();
-                uint32_t length = type["length"].GetUint();
-                uint32_t precision = type["precision"].GetUint();
-                Type t;
-                if (tclass == "integer") {
-                    t = Type::Integer();
-                } else if (tclass == "timestamp") {
-                    t = Type::Timestamp();
-                } else if (tclass == "numeric") {
-                    t = Type::Numeric(length, precision);
-                } else if (tclass == "char") {
-                    t = Type::Char(length);
-                } else if (tclass == "varchar") {
-                    t = Type::Varchar(length);
-                } else {
-                    t = Type::Integer();
-                }
-
-                columns.push_back(Column(typeId, t));
-            }
-
-            std::vector<std::string> primary_key;
-            for(const auto& p : table["primary_key"].GetArray()){
-                primary_key.push_back(p.GetString());
-            }
-
-            tables.push_back(Table(tableId, columns, primary_key));
-        }
-        this->schema = std::make_unique<schema::Schema>(std::move(tables));
-    } else {
-        this->schema = std::make_unique<schema::Schema>(std::move(tables));
+    /// the header only changes in memory until now
+    std::vector<char> buffer(schema_offset);
+    Header header;
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.table_count = table_count;
+    header.padding = 0;
+    header.schema_size = schema_size;
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+    auto current = collect_segments();
+    for (size_t i = 0; i < current.size(); ++i) {
+        SegmentEntry entry;
+        entry.sp_segment_id = current[i].sp_segment_id;
+        entry.fsi_segment_id = current[i].fsi_segment_id;
+        entry.zone_map_segment_id = current[i].zone_map_segment_id;
+        entry.bloom_filter_segment_id = current[i].bloom_filter_segment_id;
+        entry.sp_count = current[i].sp_count;
+        entry.forward_limit = current[i].forward_limit;
+        std::memcpy(buffer.data() + sizeof(Header) + i * sizeof(SegmentEntry), &entry, sizeof(SegmentEntry));
     }
+    write_bytes(buffer_manager, segment_id, 0, buffer.data(), buffer.size());
+    stored_segments = std::move(current);
 }
 
-void SchemaSegment::write() {
-    std::string serializedSchema;
-    if (!this->schema->tables.empty()) {
-        rapidjson::Document jsonDoc;
-        jsonDoc.SetObject();
-        rapidjson::Value tables(rapidjson::Type::kArrayType);
-        rapidjson::Document::AllocatorType &allocator = jsonDoc.GetAllocator();
-
-        for (Table t : this->schema.get()->tables) {
-            rapidjson::Value table(rapidjson::Type::kObjectType);
-            table.AddMember("id", rapidjson::Value(t.id.c_str(), allocator), allocator);
-
-            rapidjson::Value columns(rapidjson::Type::kArrayType);
-            for (Column c : t.columns) {
-                rapidjson::Value column(rapidjson::Type::kObjectType);
-                column.AddMember("id", rapidjson::Value(c.id.c_str(), allocator), allocator);
-                rapidjson::Value type(rapidjson::Type::kObjectType);
-                type.AddMember("tclass", rapidjson::Value(c.type.name(), allocator), allocator);
-                rapidjson::Value length(rapidjson::Type::kNumberType);
-                length.SetUint(c.type.length);
-                type.AddMember("length", length, allocator);
-                rapidjson::Value precision(rapidjson::Type::kNumberType);
-                precision.SetUint(c.type.precision);
-                type.AddMember("precision", precision, allocator);
-                column.AddMember("type", type, allocator);
-                columns.PushBack(column, allocator);
-            }
-            table.AddMember("columns", columns, allocator);
-
-            rapidjson::Value primary_key(rapidjson::Type::kArrayType);
-            for (std::string k : t.primary_key) {
-                primary_key.PushBack(rapidjson::Value(k.c_str(), allocator), allocator);
-            }
-            table.AddMember("primary_key", primary_key, allocator);
-            tables.PushBack(table, allocator);
-        }
-
-        jsonDoc.AddMember("tables", tables, allocator);
-        rapidjson::StringBuffer strbuf;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(strbuf);
-        jsonDoc.Accept(writer);
-
-        serializedSchema = std::string(strbuf.GetString());
+void SchemaSegment::read() {
+    Header header;
+    read_bytes(buffer_manager, segment_id, 0, reinterpret_cast<char*>(&header), sizeof(Header));
+    std::vector<Table> tables;
+    if (header.magic == 0) {
+        /// a new segment
+        this->schema = std::make_unique<Schema>(std::move(tables));
+        index_tables();
+        return;
+    }
+    if (header.magic != kMagic) {
+        throw SchemaParseError("not a schema segment");
+    }
+    if (header.version != kVersion) {
+        throw SchemaParseError("unsupported catalog version " + std::to_string(header.version));
     }
 
-    size_t offSet = 0;
-    size_t pageSize = buffer_manager.get_page_size();
-    size_t stringSize = serializedSchema.size();
-
-    uint64_t segment_page = 0;
-    std::string file_name = std::to_string(this->segment_id );
-    const char* filename = file_name.c_str();
-    auto file = File::open_file(filename, File::WRITE);
-    size_t headerSize = 0;
-
-    file->write_block(reinterpret_cast<const char *>(&sp_segment_id), 0, sizeof(uint16_t));
-    headerSize += sizeof(uint16_t);
-    file->write_block(reinterpret_cast<char *>(&fsi_segment_id), headerSize, sizeof(uint16_t));
-    headerSize += sizeof(uint16_t);
-    file->write_block(reinterpret_cast<char *>(&number_of_sp), headerSize, sizeof(uint64_t));
-    headerSize += sizeof(uint64_t);
-    file->write_block(reinterpret_cast<char *>(&stringSize), headerSize, sizeof(uint64_t));
-    headerSize += sizeof(uint64_t);
-
-    if (stringSize != 0) {
-        if (stringSize < pageSize) {
-            uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | segment_page;
-            auto& page = this->buffer_manager.fix_page(page_id, false);
-            uint64_t segmentPageId = this->buffer_manager.get_segment_page_id(page_id);
-
-            std::memcpy(page.get_data(), serializedSchema.data() + offSet, stringSize);
-            file->write_block(page.get_data(), (segmentPageId * pageSize) + headerSize, stringSize);
-
-            ++segment_page;
-            offSet += pageSize;
-        } else {
-            while (offSet + pageSize <= stringSize) {
-                uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | segment_page;
-                auto& page = this->buffer_manager.fix_page(page_id, false);
-                uint64_t segmentPageId = this->buffer_manager.get_segment_page_id(page_id);
-
-                std::memcpy(page.get_data(), serializedSchema.data() + offSet, pageSize);
-                file->write_block(page.get_data(), (segmentPageId * pageSize) + headerSize, pageSize);
+    /// the schema is parsed directly from the bytes on disk
+    uint64_t schema_offset = sizeof(Header) + (1 + uint64_t{header.table_count}) * sizeof(SegmentEntry);
+    std::vector<char> buffer(schema_offset + header.schema_size);
+    read_bytes(buffer_manager, segment_id, 0, buffer.data(), buffer.size());
+    std::vector<TableSegments> entries;
+    for (uint64_t i = 0; i <= header.table_count; ++i) {
+        SegmentEntry entry;
+        std::memcpy(&entry, buffer.data() + sizeof(Header) + i * sizeof(SegmentEntry), sizeof(SegmentEntry));
+        TableSegments table_segments;
+        table_segments.sp_segment_id = entry.sp_segment_id;
+        table_segments.fsi_segment_id = entry.fsi_segment_id;
+        table_segments.zone_map_segment_id = entry.zone_map_segment_id;
+        table_segments.bloom_filter_segment_id = entry.bloom_filter_segment_id;
+        table_segments.sp_count = entry.sp_count;
+        table_segments.forward_limit = entry.forward_limit;
+        entries.push_back(table_segments);
+    }
 
-                ++segment_page;
-                offSet += pageSize;
+    CatalogReader reader(buffer.data() + schema_offset, header.schema_size);
+    auto table_count = header.schema_size == 0 ? 0 : reader.get<uint32_t>();
+    if (table_count != header.table_count) {
+        throw SchemaParseError("schema segment has " + std::to_string(table_count) + " tables, expected "
+            + std::to_string(header.table_count));
+    }
+    tables.reserve(table_count);
+    for (uint32_t i = 0; i < table_count; ++i) {
+        auto id = reader.get_string();
+        auto layout = static_cast<Table::Layout>(reader.get<uint8_t>());
+
+        auto column_count = reader.get<uint32_t>();
+        std::vector<Column> columns;
+        columns.reserve(column_count);
+        for (uint32_t j = 0; j < column_count; ++j) {
+            auto column_id = reader.get_string();
+            auto tclass = static_cast<Type::Class>(reader.get<uint8_t>());
+            auto length = reader.get<uint32_t>();
+            auto precision = reader.get<uint32_t>();
+            Type type;
+            switch (tclass) {
+                case Type::kInteger:    type = Type::Integer(); break;
+                case Type::kTimestamp:  type = Type::Timestamp(); break;
+                case Type::kNumeric:    type = Type::Numeric(length, precision); break;
+                case Type::kChar:       type = Type::Char(length); break;
+                case Type::kVarchar:    type = Type::Varchar(length); break;
+                default:
+                    throw SchemaParseError("unknown type class " + std::to_string(tclass));
             }
+            columns.emplace_back(std::move(column_id), type);
+        }
 
-            if (offSet < stringSize) {
-                uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | segment_page;
-                auto& page = this->buffer_manager.fix_page(page_id, false);
-                std::memcpy(page.get_data(), serializedSchema.data() + offSet, (stringSize - offSet));
-
-                uint16_t segmentId = this->buffer_manager.get_segment_id(page_id);
-                uint64_t segmentPageId = this->buffer_manager.get_segment_page_id(page_id);
-
-                std::string file_name = std::to_string(segmentId);
-                const char* filename = file_name.c_str();
-                auto file = File::open_file(filename, File::WRITE);
-                file->write_block(page.get_data(), (segmentPageId * pageSize) + headerSize, (stringSize - offSet));
-            }
+        auto key_count = reader.get<uint32_t>();
+        std::vector<std::string> primary_key;
+        primary_key.reserve(key_count);
+        for (uint32_t j = 0; j < key_count; ++j) {
+            primary_key.push_back(reader.get_string());
         }
+        tables.emplace_back(std::move(id), std::move(columns), std::move(primary_key), layout);
     }
+    this->schema = std::make_unique<Schema>(std::move(tables));
+    this->segments = entries[0];
+    this->table_segments.clear();
+    for (uint32_t i = 0; i < table_count; ++i) {
+        this->table_segments.push_back(std::make_unique<TableSegments>(entries[i + 1]));
+    }
+    this->schema_size = header.schema_size;
+    this->stored_segments = std::move(entries);
+    this->schema_changed = false;
+    index_tables();
+}
+
+void SchemaSegment::write() {
+    checkpoint();
 }
@@ -16,54 +16,191 @@ TID::TID(uint64_t page, uint16_t slot) {
 }
 
 SlottedPage::Header::Header(uint32_t page_size) {
-    /// 12 bytes for header data
     this->slot_count = 0;
-    this->data_start = page_size - 12;
-    this->free_space = page_size - 12;
+    this->first_free_slot = 0;
+    this->data_start = page_size;
+    this->free_space = page_size - sizeof(SlottedPage);
+    this->lsn = 0;
 }
 
 SlottedPage::SlottedPage(uint32_t page_size) : header(page_size) {
-    /// 12 bytes for header data
-    this->data.resize(page_size - 12);
 }
 
-void SlottedPage::compactify(uint32_t page_size) {
-    bool isFound = false;
-    std::vector<std::byte> tempDataVector(page_size - 12);
-    int temp_vector_offset = page_size - 12;
-    for (int i = 0;i < static_cast<int>(this->slots.size());++i) {
-        auto offSet = static_cast<int>((this->slots[i].value >> 24) & ((1ull << 24) - 1));
-        auto length = static_cast<int>(this->slots[i].value & ((1ull << 24)-1));
-        if (offSet == 0 && length == 0) {
-            /// set the first empty slot id and increase the free space
-            if (!isFound) {
-                this->header.first_free_slot = static_cast<uint16_t>(i);
-                this->header.free_space += length;
-                isFound = true;
-            }
-        } else {
-            for (int j=0;j < length;++j) {
-                tempDataVector[temp_vector_offset - j] = this->data[offSet-j];
-            }
-            /// I am not sure how I should handle shifting data items and set a correct offset
-            /// for each slot
-            /// set new offset of data
-            auto t = static_cast<int>(this->slots[i].value >> 56);
-            auto s = static_cast<int>((this->slots[i].value >> 48) & ((1ull << 8)-1));
-            this->slots[i].value = ((t*1ULL)<<56) | ((s*1ULL)<<48) | (temp_vector_offset*1ULL)<<24 | (length*1ULL);
-            temp_vector_offset -= offSet;
-        }
+uint16_t SlottedPage::allocate(uint32_t data_size, uint32_t page_size) {
+    uint16_t slot_id = header.first_free_slot;
+    allocate_at(slot_id, data_size, page_size);
+    return slot_id;
+}
+
+void SlottedPage::allocate_at(uint16_t slot_id, uint32_t data_size, uint32_t page_size) {
+    assert(get_required_space(data_size, slot_id) <= header.free_space);
+    auto slots = get_slots();
+    assert(slot_id >= header.slot_count || slots[slot_id].is_empty());
+    uint32_t stored_size = get_stored_size(data_size);
+    uint32_t required = get_required_space(data_size, slot_id);
+    if (required > get_fragmented_free_space()) {
+        compactify(page_size);
+    }
+    /// the slots up to the new one are created empty
+    for (; header.slot_count <= slot_id; ++header.slot_count) {
+        slots[header.slot_count].clear();
+    }
+    header.free_space -= required;
+    if (stored_size == 0) {
+        slots[slot_id].set_inline(data_size);
+    } else {
+        header.data_start -= data_size;
+        slots[slot_id].set_slot(header.data_start, data_size, false);
+    }
+    if (slot_id != header.first_free_slot) {
+        return;
+    }
+
+    /// find the next free slot
+    uint16_t next = slot_id + 1;
+    while (next < header.slot_count && !slots[next].is_empty()) {
+        ++next;
+    }
+    header.first_free_slot = next;
+}
+
+void SlottedPage::relocate(uint16_t slot_id, uint32_t data_size, uint32_t page_size) {
+    auto& slot = get_slots()[slot_id];
+    assert(!slot.is_empty() && !slot.is_redirect());
+    if (slot.is_inline() || get_stored_size(data_size) == 0) {
+        relocate_inline(slot, data_size, page_size);
+        return;
+    }
+    uint32_t offset = slot.get_offset();
+    uint32_t old_size = slot.get_size();
+    bool is_redirect_target = slot.is_redirect_target();
+
+    /// shrinking leaves the tail as fragmented free space
+    if (data_size <= old_size) {
+        header.free_space += old_size - data_size;
+        slot.set_slot(offset, data_size, is_redirect_target);
+        return;
+    }
+    assert(data_size - old_size <= header.free_space);
+
+    /// move the record to the lower end of the data if it fits there
+    if (data_size <= get_fragmented_free_space()) {
+        header.data_start -= data_size;
+        std::memmove(get_data() + header.data_start, get_data() + offset, old_size);
+        header.free_space -= data_size - old_size;
+        slot.set_slot(header.data_start, data_size, is_redirect_target);
+        return;
+    }
+
+    /// otherwise, compact the page with the record at the lower end of the data and grow it downwards
+    compactify(page_size, &slot);
+    header.data_start -= data_size - old_size;
+    header.free_space -= data_size - old_size;
+    std::memmove(get_data() + header.data_start, get_data() + slot.get_offset(), old_size);
+    slot.set_slot(header.data_start, data_size, is_redirect_target);
+}
+
+void SlottedPage::relocate_inline(Slot &slot, uint32_t data_size, uint32_t page_size) {
+    /// one of both sizes is at most kInlineSize, so is the data that we keep
+    uint32_t kept_size = std::min(slot.get_size(), data_size);
+    std::byte kept[kInlineSize];
+    std::memcpy(kept, get_record_data(slot), kept_size);
+    release(slot);
+    if (get_stored_size(data_size) == 0) {
+        slot.set_inline(data_size);
+        std::memcpy(slot.get_inline_data(), kept, kept_size);
+        return;
+    }
+    assert(data_size <= header.free_space);
+    if (data_size > get_fragmented_free_space()) {
+        /// the slot must not point to the released data while the page is compacted
+        slot.set_inline(0);
+        compactify(page_size);
+    }
+    header.data_start -= data_size;
+    header.free_space -= data_size;
+    std::memcpy(get_data() + header.data_start, kept, kept_size);
+    slot.set_slot(header.data_start, data_size, false);
+}
+
+std::byte *SlottedPage::get_record_data(Slot &slot) {
+    return slot.is_inline() ? slot.get_inline_data() : get_data() + slot.get_offset();
+}
+
+void SlottedPage::release(Slot &slot) {
+    if (slot.is_redirect() || slot.is_inline()) {
+        return;
+    }
+    header.free_space += slot.get_size();
+    if (slot.get_offset() == header.data_start) {
+        header.data_start += slot.get_size();
     }
-    this->header.data_start = temp_vector_offset;
-    std::memcpy(this->data.data(), tempDataVector.data(), tempDataVector.size());
+}
 
+void SlottedPage::set_redirect(uint16_t slot_id, TID target) {
+    auto& slot = get_slots()[slot_id];
+    release(slot);
+    slot.set_redirect_tid(target);
 }
 
-uint16_t SlottedPage::addSlot(uint64_t value) {
-    Slot slot;
-    slot.value = value;
-    int index = this->header.slot_count;
-    slots.push_back(slot);
-    this->header.slot_count += 1;
-    return index;
-}
\ No newline at end of file
+void SlottedPage::restore(uint16_t slot_id, uint32_t data_size, uint32_t page_size) {
+    auto& slot = get_slots()[slot_id];
+    assert(slot.is_redirect() && !slot.is_empty() && get_stored_size(data_size) <= header.free_space);
+    if (get_stored_size(data_size) == 0) {
+        slot.set_inline(data_size);
+        return;
+    }
+    if (data_size > get_fragmented_free_space()) {
+        compactify(page_size);
+    }
+    header.data_start -= data_size;
+    header.free_space -= data_size;
+    slot.set_slot(header.data_start, data_size, false);
+}
+
+void SlottedPage::erase(uint16_t slot_id) {
+    auto slots = get_slots();
+    auto& slot = slots[slot_id];
+    release(slot);
+    slot.clear();
+    header.first_free_slot = std::min(header.first_free_slot, slot_id);
+
+    /// drop trailing empty slots
+    while (header.slot_count > 0 && slots[header.slot_count - 1].is_empty()) {
+        --header.slot_count;
+        header.free_space += sizeof(Slot);
+    }
+    header.first_free_slot = std::min(header.first_free_slot, header.slot_count);
+}
+
+void SlottedPage::compactify(uint32_t page_size, const Slot *last) {
+    header.data_start = compact_records(get_data(), get_slots(), header.slot_count, page_size, last);
+}
+
+uint32_t SlottedPage::compact_records(std::byte *page, Slot *slots, uint16_t slot_count, uint32_t page_size,
+                                      const Slot *last) {
+    /// the buffer only grows to the largest page size
+    thread_local std::vector<std::byte> buffer;
+    if (buffer.size() < page_size) {
+        buffer.resize(page_size);
+    }
+    uint32_t data_start = page_size;
+    auto move = [&](Slot &slot) {
+        uint32_t size = slot.get_size();
+        data_start -= size;
+        std::memcpy(buffer.data() + data_start, page + slot.get_offset(), size);
+        slot.set_slot(data_start, size, slot.is_redirect_target());
+    };
+    for (uint16_t i = 0; i < slot_count; ++i) {
+        auto& slot = slots[i];
+        if (slot.is_empty() || slot.is_redirect() || slot.is_inline() || &slot == last) {
+            continue;
+        }
+        move(slot);
+    }
+    if (last != nullptr) {
+        move(slots[last - slots]);
+    }
+    std::memcpy(page + data_start, buffer.data() + data_start, page_size - data_start);
+    return data_start;
+}
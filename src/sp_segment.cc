@@ -4,232 +4,1594 @@
 #include <cassert>
 #include <cstring>
 #include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
 
 using moderndbs::SPSegment;
 using moderndbs::Segment;
 using moderndbs::TID;
 using moderndbs::SlottedPage;
+using moderndbs::FixedPage;
+using moderndbs::PaxPage;
+using moderndbs::PageGuard;
 
-SPSegment::SPSegment(uint16_t segment_id, BufferManager& buffer_manager, SchemaSegment &schema, FSISegment &fsi)
-    : Segment(segment_id, buffer_manager), schema(schema), fsi(fsi) {
-    schema.set_sp_segment(segment_id);
+namespace {
+
+/// The size of the original TID that precedes redirect targets
+constexpr uint32_t kTIDSize = sizeof(uint64_t);
+/// Marks the original TID of a redirect target whose record was forwarded by the vacuum
+/// (page ids are smaller than 2^40, so the bit is never part of a TID)
+constexpr uint64_t kForwarded = 1ull << 63;
+
+/// The kind of a slot, the first byte of its image in the log
+enum SlotKind: uint8_t {
+    kEmptySlot,
+    kRecordSlot,
+    kRedirectSlot,
+    kTargetSlot,
+};
+
+/// Get the image of a slot before its change, which the current thread captured.
+std::vector<std::byte> &get_before_image() {
+    thread_local std::vector<std::byte> image;
+    return image;
 }
 
-TID SPSegment::allocate(uint32_t size) {
-    std::pair<bool, uint64_t> result = fsi.find(size);
-    if (!result.first) {
-        uint64_t page_id = schema.get_sp_count();
-        auto& page = buffer_manager.fix_page(page_id, false);
-        auto slottedPage = new(page.get_data()) SlottedPage(buffer_manager.get_page_size());
-        auto offSet = static_cast<int>(slottedPage->header.data_start);
-        uint64_t value = (255 * 1ULL) << 56 | (0*1ULL) << 48 | ((offSet * 1ULL) << 24);
-        uint64_t slotId = slottedPage->addSlot(value);
-        slottedPage->header.data_start -= static_cast<int>(size);
-        slottedPage->header.free_space -= (static_cast<int>(size) + 8);
-        fsi.update(page_id, slottedPage->header.free_space);
-        schema.increase_sp_count();
-        schema.write();
-        return TID(page_id, slotId);
+/// Get a buffer of the current thread for the image of a slot after its change.
+std::vector<std::byte> &get_after_image() {
+    thread_local std::vector<std::byte> image;
+    return image;
+}
+
+/// Get a number that identifies the current thread.
+size_t get_thread_number() {
+    static std::atomic<size_t> thread_count{0};
+    thread_local size_t thread_number = thread_count++;
+    return thread_number;
+}
+
+/// Get a buffer of the current thread with at least `size` bytes.
+/// It is valid until the next call and only grows, so that records can be copied without allocations.
+std::byte *get_scratch(size_t size) {
+    thread_local std::vector<std::byte> scratch;
+    if (scratch.size() < size) {
+        scratch.resize(size);
+    }
+    return scratch.data();
+}
+
+/// Sort TIDs together with their positions by page.
+/// The TIDs of a probe usually fall into a dense range of pages, which a counting sort handles in linear time.
+void sort_by_page(const TID *tids, size_t count, std::vector<std::pair<TID, size_t>> &order) {
+    order.assign(count, { TID(0), 0 });
+    if (count == 0) {
+        return;
+    }
+    auto [first, last] = std::minmax_element(tids, tids + count, [](TID a, TID b) { return a.value < b.value; });
+    uint64_t first_page = first->get_page();
+    uint64_t page_range = last->get_page() - first_page + 1;
+    if (page_range > 4 * count) {
+        for (size_t i = 0; i < count; ++i) {
+            order[i] = { tids[i], i };
+        }
+        std::sort(order.begin(), order.end(), [](auto &a, auto &b) { return a.first.value < b.first.value; });
+        return;
+    }
+    std::vector<size_t> offsets(page_range + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++offsets[tids[i].get_page() - first_page + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    for (size_t i = 0; i < count; ++i) {
+        order[offsets[tids[i].get_page() - first_page]++] = { tids[i], i };
+    }
+}
+
+}  // namespace
+
+SPSegment::SPSegment(uint16_t segment_id, BufferManager& buffer_manager, SchemaSegment &schema, FSISegment &fsi,
+                     const schema::Table *table, ZoneMapSegment *zone_maps, BloomFilterSegment *bloom_filter,
+                     WALSegment *wal)
+    : Segment(segment_id, buffer_manager), schema(schema), fsi(fsi), segments(fsi.get_segments()),
+      zone_maps(zone_maps), bloom_filter(bloom_filter), wal(wal) {
+    segments.sp_segment_id = segment_id;
+    if (table != nullptr) {
+        codec = std::make_unique<RecordCodec>(*table);
+        if (table->layout == schema::Table::kPAX) {
+            page_format = kPAX;
+            pax_layout = std::make_unique<PaxPage::Layout>(*codec, buffer_manager.get_page_size());
+        } else if (codec->is_fixed_width()) {
+            /// all records have the same size, so they do not need slots
+            page_format = kFixed;
+            fixed_layout = std::make_unique<FixedPage::Layout>(codec->get_fixed_size(), buffer_manager.get_page_size());
+        }
+    }
+    if (wal != nullptr) {
+        /// the forwarded records are found after recovery
+        wal->attach(*this);
+    } else {
+        load_forwards();
+    }
+}
+
+void SPSegment::init_page(char *page) const {
+    auto page_size = buffer_manager.get_page_size();
+    if (page_format == kPAX) {
+        new(page) PaxPage(*pax_layout, page_size);
+    } else if (page_format == kFixed) {
+        new(page) FixedPage(*fixed_layout);
+    } else {
+        new(page) SlottedPage(page_size);
+    }
+}
+
+SlottedPage::Slot &SPSegment::get_slot(char *page, uint16_t slot_id) const {
+    assert(page_format != kFixed);
+    if (page_format == kPAX) {
+        return reinterpret_cast<PaxPage*>(page)->get_slots()[slot_id];
+    }
+    return reinterpret_cast<SlottedPage*>(page)->get_slots()[slot_id];
+}
+
+uint32_t SPSegment::get_required_space(uint32_t size, bool is_redirect_target) const {
+    uint32_t prefix = is_redirect_target ? kTIDSize : 0;
+    if (page_format == kPAX) {
+        /// a free slot provides the fixed-width part, the heap the variable section
+        uint32_t fixed_size = pax_layout->fixed_size;
+        return sizeof(SlottedPage::Slot) + fixed_size + std::max(size, fixed_size) - fixed_size + prefix;
+    }
+    if (page_format == kFixed) {
+        return fixed_layout->record_size;
+    }
+    return SlottedPage::get_stored_size(size + prefix) + sizeof(SlottedPage::Slot);
+}
+
+uint32_t SPSegment::get_free_space(char *page) const {
+    if (page_format == kPAX) {
+        auto paxPage = reinterpret_cast<PaxPage*>(page);
+        if (!paxPage->has_free_slot()) {
+            return 0;
+        }
+        return sizeof(SlottedPage::Slot) + pax_layout->fixed_size + paxPage->header.free_space;
+    }
+    if (page_format == kFixed) {
+        auto fixedPage = reinterpret_cast<FixedPage*>(page);
+        return (fixedPage->header.capacity - fixedPage->header.record_count) * fixed_layout->record_size;
+    }
+    return reinterpret_cast<SlottedPage*>(page)->header.free_space;
+}
+
+bool SPSegment::fits(char *page, uint32_t size, bool is_redirect_target) const {
+    uint32_t prefix = is_redirect_target ? kTIDSize : 0;
+    if (page_format == kPAX) {
+        auto paxPage = reinterpret_cast<PaxPage*>(page);
+        uint32_t heap_size = std::max(size, pax_layout->fixed_size) - pax_layout->fixed_size + prefix;
+        return paxPage->has_free_slot() && heap_size <= paxPage->header.free_space;
+    }
+    if (page_format == kFixed) {
+        return !is_redirect_target && size <= fixed_layout->record_size
+            && reinterpret_cast<FixedPage*>(page)->has_free_slot();
+    }
+    auto slottedPage = reinterpret_cast<SlottedPage*>(page);
+    return slottedPage->get_required_space(size + prefix) <= slottedPage->header.free_space;
+}
+
+bool SPSegment::fits(char *page, uint16_t slot_id, uint32_t size, bool is_redirect_target) const {
+    uint32_t prefix = is_redirect_target ? kTIDSize : 0;
+    if (page_format == kPAX) {
+        auto paxPage = reinterpret_cast<PaxPage*>(page);
+        uint32_t heap_size = std::max(size, pax_layout->fixed_size) - pax_layout->fixed_size + prefix;
+        return slot_id < paxPage->header.capacity && heap_size <= paxPage->header.free_space;
+    }
+    if (page_format == kFixed) {
+        return !is_redirect_target && size <= fixed_layout->record_size
+            && slot_id < reinterpret_cast<FixedPage*>(page)->header.capacity;
+    }
+    auto slottedPage = reinterpret_cast<SlottedPage*>(page);
+    return slottedPage->get_required_space(size + prefix, slot_id) <= slottedPage->header.free_space;
+}
+
+uint16_t SPSegment::allocate_on_page(char *page, uint32_t size, bool is_redirect_target) const {
+    uint16_t slot_id;
+    if (page_format == kPAX) {
+        slot_id = reinterpret_cast<PaxPage*>(page)->header.first_free_slot;
+    } else if (page_format == kFixed) {
+        slot_id = reinterpret_cast<FixedPage*>(page)->header.first_free_slot;
+    } else {
+        slot_id = reinterpret_cast<SlottedPage*>(page)->header.first_free_slot;
+    }
+    allocate_on_page(page, slot_id, size, is_redirect_target);
+    return slot_id;
+}
+
+void SPSegment::allocate_on_page(char *page, uint16_t slot_id, uint32_t size, bool is_redirect_target) const {
+    auto page_size = buffer_manager.get_page_size();
+    uint32_t prefix = is_redirect_target ? kTIDSize : 0;
+    if (page_format == kPAX) {
+        uint32_t heap_size = std::max(size, pax_layout->fixed_size) - pax_layout->fixed_size + prefix;
+        reinterpret_cast<PaxPage*>(page)->allocate_at(slot_id, heap_size, page_size);
+    } else if (page_format == kFixed) {
+        reinterpret_cast<FixedPage*>(page)->allocate_at(slot_id);
+    } else {
+        reinterpret_cast<SlottedPage*>(page)->allocate_at(slot_id, size + prefix, page_size);
+    }
+    if (is_redirect_target) {
+        auto& slot = get_slot(page, slot_id);
+        slot.set_slot(slot.get_offset(), slot.get_size(), true);
+    }
+    if (codec) {
+        /// new records are NULL until they are written
+        uint32_t fixed_size = std::min(size, codec->get_fixed_size());
+        auto fixed = page_format == kPAX ? get_scratch(fixed_size) : const_cast<std::byte*>(get_nulls(page, slot_id));
+        std::memset(fixed, 0, fixed_size);
+        std::memset(fixed, 0xFF, std::min(fixed_size, codec->get_null_bytes()));
+        if (page_format == kPAX) {
+            copy_record(page, slot_id, fixed, fixed_size, true);
+        }
+    }
+}
+
+bool SPSegment::resize_on_page(char *page, uint16_t slot_id, uint32_t size) const {
+    if (page_format == kFixed) {
+        return size <= fixed_layout->record_size;
+    }
+    auto page_size = buffer_manager.get_page_size();
+    auto& slot = get_slot(page, slot_id);
+    uint32_t prefix = slot.is_redirect_target() ? kTIDSize : 0;
+    uint32_t old_size = slot.get_size();
+    if (page_format == kPAX) {
+        auto paxPage = reinterpret_cast<PaxPage*>(page);
+        uint32_t heap_size = std::max(size, pax_layout->fixed_size) - pax_layout->fixed_size + prefix;
+        if (heap_size > old_size && heap_size - old_size > paxPage->header.free_space) {
+            return false;
+        }
+        paxPage->relocate(slot_id, heap_size, page_size);
+        return true;
+    }
+    auto slottedPage = reinterpret_cast<SlottedPage*>(page);
+    /// inline records do not occupy space outside of their slot
+    uint32_t old_stored_size = slot.get_stored_size();
+    uint32_t new_stored_size = SlottedPage::get_stored_size(size + prefix);
+    if (new_stored_size > old_stored_size && new_stored_size - old_stored_size > slottedPage->header.free_space) {
+        return false;
+    }
+    slottedPage->relocate(slot_id, size + prefix, page_size);
+    return true;
+}
+
+uint32_t SPSegment::get_record_size(char *page, uint16_t slot_id) const {
+    if (page_format == kFixed) {
+        return fixed_layout->record_size;
+    }
+    auto& slot = get_slot(page, slot_id);
+    uint32_t size = slot.get_size() - (slot.is_redirect_target() ? kTIDSize : 0);
+    if (page_format == kPAX) {
+        return pax_layout->fixed_size + size;
+    }
+    return size;
+}
+
+uint32_t SPSegment::copy_record(char *page, uint16_t slot_id, std::byte *record, uint32_t size, bool to_page) const {
+    if (page_format == kPAX) {
+        return reinterpret_cast<PaxPage*>(page)->copy(*pax_layout, slot_id, record, size, to_page);
+    }
+    auto data = const_cast<std::byte*>(get_nulls(page, slot_id));
+    size = std::min(size, get_record_size(page, slot_id));
+    if (to_page) {
+        std::memcpy(data, record, size);
+    } else {
+        std::memcpy(record, data, size);
+    }
+    return size;
+}
+
+void SPSegment::copy_between(char *source_page, uint16_t source_slot, char *target_page, uint16_t target_slot,
+                             uint32_t size) const {
+    if (page_format == kPAX) {
+        /// the columns of a PAX record are scattered over the minipages, so we gather them first
+        auto record = get_scratch(size);
+        copy_record(source_page, source_slot, record, size, false);
+        copy_record(target_page, target_slot, record, size, true);
+        return;
+    }
+    copy_record(target_page, target_slot, const_cast<std::byte*>(get_nulls(source_page, source_slot)), size, true);
+}
+
+void SPSegment::set_redirect(char *page, uint16_t slot_id, TID target) const {
+    if (page_format == kPAX) {
+        reinterpret_cast<PaxPage*>(page)->set_redirect(slot_id, target);
+    } else {
+        reinterpret_cast<SlottedPage*>(page)->set_redirect(slot_id, target);
+    }
+}
+
+bool SPSegment::restore_on_page(char *page, uint16_t slot_id, uint32_t size) const {
+    assert(page_format != kFixed);
+    auto page_size = buffer_manager.get_page_size();
+    if (page_format == kPAX) {
+        auto paxPage = reinterpret_cast<PaxPage*>(page);
+        uint32_t heap_size = std::max(size, pax_layout->fixed_size) - pax_layout->fixed_size;
+        if (heap_size > paxPage->header.free_space) {
+            return false;
+        }
+        paxPage->restore(slot_id, heap_size, page_size);
+        return true;
+    }
+    auto slottedPage = reinterpret_cast<SlottedPage*>(page);
+    if (SlottedPage::get_stored_size(size) > slottedPage->header.free_space) {
+        return false;
+    }
+    slottedPage->restore(slot_id, size, page_size);
+    return true;
+}
+
+void SPSegment::erase_on_page(char *page, uint16_t slot_id) const {
+    if (page_format == kPAX) {
+        reinterpret_cast<PaxPage*>(page)->erase(slot_id);
+    } else if (page_format == kFixed) {
+        reinterpret_cast<FixedPage*>(page)->erase(slot_id);
+    } else {
+        reinterpret_cast<SlottedPage*>(page)->erase(slot_id);
+    }
+}
+
+bool SPSegment::compact_on_page(char *page) const {
+    if (page_format == kFixed) {
+        return false;
+    }
+    auto page_size = buffer_manager.get_page_size();
+    if (page_format == kPAX) {
+        auto paxPage = reinterpret_cast<PaxPage*>(page);
+        if (paxPage->get_fragmented_free_space() == paxPage->header.free_space) {
+            return false;
+        }
+        paxPage->compactify(page_size);
+        return true;
+    }
+    auto slottedPage = reinterpret_cast<SlottedPage*>(page);
+    if (slottedPage->get_fragmented_free_space() == slottedPage->header.free_space) {
+        return false;
+    }
+    slottedPage->compactify(page_size);
+    return true;
+}
+
+void SPSegment::add_key(char *page, uint16_t slot_id, bool is_rebuilt) const {
+    if (bloom_filter == nullptr || (is_rebuilt && !bloom_filter->is_rebuilding())) {
+        return;
+    }
+    /// the record and its key share the buffer of the thread
+    uint32_t size = get_record_size(page, slot_id);
+    auto record = get_scratch(size + codec->get_key_size());
+    copy_record(page, slot_id, record, size, false);
+    auto key = record + size;
+    if (!codec->try_encode_key(record, size, key)) {
+        return;
+    }
+    if (is_rebuilt) {
+        bloom_filter->add_rebuilt(key, codec->get_key_size());
     } else {
-        auto& page = buffer_manager.fix_page(result.second, false);
-        auto slottedPage = reinterpret_cast<SlottedPage*>(page.get_data());
-        /// unfortunately I couldn't implement this, I might misunderstand how deletion should work
-        /// I set offset and data length to 0 in slot value, but I couldn't find a proper mechanism
-        /// to shift empty data items.
-        //slottedPage->compactify(buffer_manager.get_page_size());
-        auto offSet = static_cast<int>(slottedPage->header.data_start);
-        uint64_t value = (255 * 1ULL << 56) | (0*1ULL) << 48 | ((offSet * 1ULL) << 24);
-        uint64_t slotId = slottedPage->addSlot(value);
-        slottedPage->header.data_start -= static_cast<int>(size);
-        slottedPage->header.free_space -= (static_cast<int>(size) + 8);
+        bloom_filter->add(key, codec->get_key_size());
+    }
+}
+
+void SPSegment::update_zones(char *page, uint64_t page_id, uint16_t slot_id, bool add) const {
+    if (zone_maps == nullptr) {
+        return;
+    }
+    const auto& columns = zone_maps->get_columns();
+    /// the buffers of the thread are reused, so that updates do not allocate
+    thread_local std::vector<int64_t> values;
+    thread_local std::unique_ptr<bool[]> nulls;
+    thread_local size_t nulls_size = 0;
+    values.assign(columns.size(), 0);
+    if (nulls_size < columns.size()) {
+        nulls.reset(new bool[columns.size()]);
+        nulls_size = columns.size();
+    }
+    for (size_t i = 0; i < columns.size(); ++i) {
+        nulls[i] = is_null(page, slot_id, columns[i]);
+        if (!nulls[i]) {
+            std::memcpy(&values[i], get_value(page, slot_id, columns[i]), sizeof(int64_t));
+        }
+    }
+    if (add) {
+        zone_maps->add(page_id, values.data(), nulls.get());
+    } else {
+        zone_maps->remove(page_id, values.data(), nulls.get());
+    }
+}
+
+SPSegment::RecordPages SPSegment::fix_record(TID tid, bool exclusive) const {
+    /// only the records of pages that the vacuum removed can be forwarded
+    bool may_be_forwarded = page_format != kFixed && tid.get_page() < segments.forward_limit;
+    while (true) {
+        RecordPages pages;
+        if (may_be_forwarded && tid.get_page() >= segments.sp_count && fix_forwarded(tid, exclusive, pages)) {
+            return pages;
+        }
+        pages.home = PageGuard(buffer_manager, get_page_id(tid.get_page()), exclusive);
+        pages.page_id = tid.get_page();
+        pages.slot_id = tid.get_slot();
+        if (page_format == kFixed) {
+            return pages;
+        }
+        if (may_be_forwarded && is_forwarded_home(pages.home.get_data(), tid)) {
+            pages.home.release();
+            if (fix_forwarded(tid, exclusive, pages)) {
+                return pages;
+            }
+            /// the record was erased
+            may_be_forwarded = false;
+            continue;
+        }
+        auto& slot = get_slot(pages.home.get_data(), tid.get_slot());
+        if (!slot.is_redirect()) {
+            return pages;
+        }
+        /// the record was moved to another page
+        auto target = slot.as_redirect_tid();
+        pages.page_id = target.get_page();
+        pages.slot_id = target.get_slot();
+        pages.is_redirected = true;
+        redirected_accesses.fetch_add(1, std::memory_order_relaxed);
+        if (target.get_page() == tid.get_page()) {
+            pages.is_forwarded = is_forwarded(pages.home.get_data(), target.get_slot());
+            return pages;
+        }
+        if (target.get_page() > tid.get_page()) {
+            pages.target = PageGuard(buffer_manager, get_page_id(target.get_page()), exclusive);
+            pages.is_forwarded = is_forwarded(pages.target.get_data(), target.get_slot());
+            return pages;
+        }
+        /// the target page comes first, so we latch both pages again and check that the redirect is unchanged
+        pages.home.release();
+        pages.target = PageGuard(buffer_manager, get_page_id(target.get_page()), exclusive);
+        pages.home = PageGuard(buffer_manager, get_page_id(tid.get_page()), exclusive);
+        auto& new_slot = get_slot(pages.home.get_data(), tid.get_slot());
+        if (new_slot.is_redirect() && new_slot.as_redirect_tid().value == target.value) {
+            pages.is_forwarded = is_forwarded(pages.target.get_data(), target.get_slot());
+            return pages;
+        }
+    }
+}
+
+bool SPSegment::fix_forwarded(TID tid, bool exclusive, RecordPages &pages) const {
+    TID target(0);
+    if (!find_forward(tid, target)) {
+        return false;
+    }
+    while (true) {
+        pages = RecordPages();
+        uint64_t sp_count = segments.sp_count;
+        if (target.get_page() >= sp_count) {
+            /// the entry of an erased record
+            return false;
+        }
+        /// the pages are latched in ascending order, the page of the TID only if it was created again
+        bool has_home = tid.get_page() < sp_count;
+        if (has_home && tid.get_page() <= target.get_page()) {
+            pages.home = PageGuard(buffer_manager, get_page_id(tid.get_page()), exclusive);
+        }
+        if (tid.get_page() != target.get_page()) {
+            pages.target = PageGuard(buffer_manager, get_page_id(target.get_page()), exclusive);
+        }
+        if (has_home && tid.get_page() > target.get_page()) {
+            pages.home = PageGuard(buffer_manager, get_page_id(tid.get_page()), exclusive);
+        }
+
+        /// the record may have moved on before we latched its page
+        TID current(0);
+        bool is_found = find_forward(tid, current);
+        if (is_found && current.value != target.value) {
+            target = current;
+            continue;
+        }
+        auto data = pages.get_data();
+        if (!is_found || target.get_slot() >= get_slot_count(data) || !is_forwarded(data, target.get_slot())
+                || get_tid(data, target.get_page(), target.get_slot()).value != tid.value) {
+            pages = RecordPages();
+            return false;
+        }
+        pages.page_id = target.get_page();
+        pages.slot_id = target.get_slot();
+        pages.is_redirected = true;
+        pages.is_forwarded = true;
+        redirected_accesses.fetch_add(1, std::memory_order_relaxed);
+
+        /// the home page is only kept if it has a slot for the record, which then redirects to the target
+        /// (or reserves the TID)
+        if (pages.home) {
+            auto home = pages.home.get_data();
+            bool has_slot = tid.get_slot() < get_slot_count(home) && get_slot(home, tid.get_slot()).is_redirect();
+            if (has_slot) {
+                auto redirect = get_slot(home, tid.get_slot()).as_redirect_tid();
+                has_slot = redirect.value == tid.value || redirect.value == target.value;
+            }
+            if (!has_slot && pages.target) {
+                pages.home.release();
+            } else if (!has_slot) {
+                pages.target = std::move(pages.home);
+            }
+        }
+        return true;
+    }
+}
+
+bool SPSegment::is_forwarded_home(char *page, TID tid) const {
+    return tid.get_slot() >= get_slot_count(page) || get_slot(page, tid.get_slot()).is_empty()
+        || is_reserved(page, tid);
+}
+
+bool SPSegment::is_reserved(char *page, TID tid) const {
+    if (tid.get_slot() >= get_slot_count(page)) {
+        return false;
+    }
+    auto& slot = get_slot(page, tid.get_slot());
+    return !slot.is_empty() && slot.is_redirect() && slot.as_redirect_tid().value == tid.value;
+}
+
+bool SPSegment::is_forwarded(char *page, uint16_t slot_id) const {
+    auto& slot = get_slot(page, slot_id);
+    if (slot.is_empty() || !slot.is_redirect_target()) {
+        return false;
+    }
+    uint64_t original;
+    std::memcpy(&original, page + slot.get_offset(), kTIDSize);
+    return (original & kForwarded) != 0;
+}
+
+void SPSegment::set_forwarded(char *page, uint16_t slot_id) const {
+    auto offset = get_slot(page, slot_id).get_offset();
+    uint64_t original;
+    std::memcpy(&original, page + offset, kTIDSize);
+    original |= kForwarded;
+    std::memcpy(page + offset, &original, kTIDSize);
+}
+
+bool SPSegment::find_forward(TID tid, TID &target) const {
+    std::lock_guard<std::mutex> guard(forward_latch);
+    auto it = forwards.find(tid.value);
+    if (it == forwards.end()) {
+        return false;
+    }
+    target = TID(it->second);
+    return true;
+}
+
+void SPSegment::set_forward(TID tid, TID target) {
+    std::lock_guard<std::mutex> guard(forward_latch);
+    forwards[tid.value] = target.value;
+}
+
+void SPSegment::erase_forward(TID tid, TID target) {
+    std::lock_guard<std::mutex> guard(forward_latch);
+    auto it = forwards.find(tid.value);
+    if (it != forwards.end() && it->second == target.value) {
+        forwards.erase(it);
+    }
+}
+
+bool SPSegment::reserve_slots(PageGuard &page, uint64_t page_id) {
+    std::vector<uint16_t> slots;
+    {
+        std::lock_guard<std::mutex> guard(forward_latch);
+        for (auto it = forwards.lower_bound(TID(page_id, 0).value);
+             it != forwards.end() && TID(it->first).get_page() == page_id; ++it) {
+            slots.push_back(TID(it->first).get_slot());
+        }
+    }
+    /// an abort must not hand out the TIDs, so the reservations are not undone
+    auto data = page.get_data();
+    for (auto slot_id : slots) {
+        allocate_on_page(data, slot_id, 0, false);
+        set_redirect(data, slot_id, TID(page_id, slot_id));
+        if (wal != nullptr) {
+            auto& after = get_after_image();
+            get_slot_image(data, slot_id, after);
+            set_page_lsn(page, wal->log_redo(page.get_page_id(), slot_id, after.data(),
+                                             static_cast<uint32_t>(after.size())));
+        }
+    }
+    page.mark_dirty();
+    return !slots.empty();
+}
+
+void SPSegment::load_forwards() {
+    if (segments.forward_limit == 0 || page_format == kFixed) {
+        return;
+    }
+    /// the targets of forwarded records are marked
+    std::map<uint64_t, uint64_t> found;
+    uint64_t forward_limit = 0;
+    for (uint64_t page_id = 0; page_id < segments.sp_count; ++page_id) {
+        PageGuard page(buffer_manager, get_page_id(page_id), false);
+        auto data = page.get_data();
+        uint16_t slot_count = get_slot_count(data);
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            if (is_forwarded(data, slot_id)) {
+                auto tid = get_tid(data, page_id, slot_id);
+                found[tid.value] = TID(page_id, slot_id).value;
+                forward_limit = std::max(forward_limit, tid.get_page() + 1);
+            }
+        }
+    }
+    std::lock_guard<std::mutex> guard(forward_latch);
+    forwards = std::move(found);
+    segments.forward_limit = forward_limit;
+}
+
+std::pair<uint64_t, PageGuard> SPSegment::find_page(uint32_t size, bool is_redirect_target, const RecordPages *held,
+                                                     uint64_t page_limit) {
+    uint32_t required_space = get_required_space(size, is_redirect_target);
+    while (true) {
+        std::pair<bool, uint64_t> result = fsi.find(required_space);
+        if (!result.first || result.second >= page_limit) {
+            break;
+        }
+        PageGuard page;
+        if (held == nullptr) {
+            page = PageGuard(buffer_manager, get_page_id(result.second), true);
+        } else {
+            /// we must not wait for a page out of order, so we take a new page if the page is latched
+            if ((held->home && held->home.get_page_id() == get_page_id(result.second))
+                    || (held->target && held->target.get_page_id() == get_page_id(result.second))) {
+                break;
+            }
+            auto* frame = buffer_manager.try_fix_page(get_page_id(result.second), true);
+            if (frame == nullptr) {
+                break;
+            }
+            page = PageGuard(buffer_manager, *frame);
+        }
+        if (result.second >= segments.sp_count) {
+            /// the vacuum removed the page in the meantime
+            continue;
+        }
+        if (fits(page.get_data(), size, is_redirect_target)) {
+            return { result.second, std::move(page) };
+        }
+        /// the free-space inventory was too optimistic
+        fsi.update(result.second, get_free_space(page.get_data()));
+    }
+
+    if (page_limit != kNoPageLimit) {
+        return { 0, PageGuard() };
+    }
+
+    /// no page has enough space left, create a new one
+    /// (its id is larger than that of every page that we hold, so we may wait for it)
+    while (true) {
+        uint64_t page_id;
+        PageGuard page;
+        {
+            std::lock_guard<std::mutex> guard(page_count_latch);
+            page_id = segments.sp_count.fetch_add(1);
+            page = PageGuard(buffer_manager, get_page_id(page_id), true);
+        }
+        init_page(page.get_data());
+        page.mark_dirty();
+        if (wal != nullptr) {
+            set_page_lsn(page, wal->log_format(page.get_page_id()));
+        }
+        if (zone_maps != nullptr) {
+            zone_maps->reset(page_id);
+        }
+        /// the vacuum may have removed a page with this id, whose TIDs stay with the forwarded records
+        bool is_reserved = page_id < segments.forward_limit && reserve_slots(page, page_id);
+        if (fits(page.get_data(), size, is_redirect_target)) {
+            return { page_id, std::move(page) };
+        }
+        /// the empty page is left for smaller records
+        fsi.update(page_id, get_free_space(page.get_data()));
+        if (!is_reserved) {
+            throw std::length_error("record does not fit on a page");
+        }
+    }
+}
+
+TID SPSegment::move_record(TID original, char *source_page, uint16_t source_slot, uint32_t new_size,
+                           uint64_t page_id, PageGuard &page, bool is_forwarded) {
+    uint16_t slot_id = allocate_on_page(page.get_data(), new_size, true);
+    auto& slot = get_slot(page.get_data(), slot_id);
+    uint64_t prefix = original.value | (is_forwarded ? kForwarded : 0);
+    std::memcpy(page.get_data() + slot.get_offset(), &prefix, kTIDSize);
+
+    copy_between(source_page, source_slot, page.get_data(), slot_id,
+                 std::min(new_size, get_record_size(source_page, source_slot)));
+    update_zones(page.get_data(), page_id, slot_id, true);
+    /// a rebuild of the Bloom filter may have read the page already
+    add_key(page.get_data(), slot_id, true);
+    log_change(page, slot_id, true);
+
+    fsi.update(page_id, get_free_space(page.get_data()));
+    page.mark_dirty();
+    return TID(page_id, slot_id);
+}
+
+bool SPSegment::move_home(TID tid, RecordPages &pages, uint32_t size) {
+    if (!pages.home) {
+        /// the vacuum removed the page
+        return false;
+    }
+    auto home = pages.home.get_data();
+    auto data = pages.get_data();
+    capture(home, tid.get_slot());
+    if (!restore_on_page(home, tid.get_slot(), size)) {
+        return false;
+    }
+    update_zones(data, pages.page_id, pages.slot_id, false);
+    copy_between(data, pages.slot_id, home, tid.get_slot(), std::min(size, get_record_size(data, pages.slot_id)));
+    add_key(home, tid.get_slot(), true);
+    log_change(pages.home, tid.get_slot());
+    capture(data, pages.slot_id);
+    erase_on_page(data, pages.slot_id);
+    log_change(pages.get_page(), pages.slot_id);
+    fsi.update(pages.page_id, get_free_space(data));
+    update_zones(home, tid.get_page(), tid.get_slot(), true);
+    fsi.update(tid.get_page(), get_free_space(home));
+    if (pages.is_forwarded) {
+        erase_forward(tid, TID(pages.page_id, pages.slot_id));
+    }
+
+    /// the record is on its page again, so the target page is not needed anymore
+    if (pages.target) {
+        pages.target.mark_dirty();
+        pages.target.release();
+    }
+    pages.page_id = tid.get_page();
+    pages.slot_id = tid.get_slot();
+    pages.is_redirected = false;
+    pages.is_forwarded = false;
+    returned_records.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void SPSegment::redirect_home(TID tid, RecordPages &pages, TID target) {
+    if (pages.is_forwarded) {
+        set_forward(tid, target);
+    }
+    if (pages.home) {
+        capture(pages.home.get_data(), tid.get_slot());
+        get_slot(pages.home.get_data(), tid.get_slot()).set_redirect_tid(target);
+        log_change(pages.home, tid.get_slot());
+    }
+}
 
-        fsi.update(result.second, slottedPage->header.free_space);
-        return TID(result.second, slotId);
+TID SPSegment::allocate(uint32_t size) {
+    if (page_format == kFixed && size > fixed_layout->record_size) {
+        throw std::length_error("record is larger than the records of the table");
     }
+    WALSegment::Operation operation(wal);
+    /// try the insert page of this thread first
+    auto& insert_page = insert_pages[get_thread_number() % kInsertPages];
+    uint64_t page_id = insert_page.load(std::memory_order_relaxed);
+    PageGuard page;
+    if (page_id != 0 && page_id - 1 < segments.sp_count) {
+        page_id -= 1;
+        page = PageGuard(buffer_manager, get_page_id(page_id), true);
+        /// the vacuum may have removed the page
+        if (page_id >= segments.sp_count || !fits(page.get_data(), size, false)) {
+            page.release();
+        }
+    }
+    if (!page) {
+        std::tie(page_id, page) = find_page(size, false);
+        insert_page.store(page_id + 1, std::memory_order_relaxed);
+    }
+    uint16_t slot_id = allocate_on_page(page.get_data(), size, false);
+    update_zones(page.get_data(), page_id, slot_id, true);
+    log_change(page, slot_id, true);
+    fsi.update(page_id, get_free_space(page.get_data()));
+    page.mark_dirty();
+    return TID(page_id, slot_id);
 }
 
 uint32_t SPSegment::read(TID tid, std::byte *record, uint32_t capacity) const {
-    uint64_t page_id = tid.value >> 16;
-    uint16_t slot_id = tid.value & ((1ull << 16) - 1);
-    auto& page = buffer_manager.fix_page(page_id, false);
-    auto slottedPage = reinterpret_cast<SlottedPage*>(page.get_data());
-    auto& slot = *(slottedPage->slots.data() + slot_id);
-    uint8_t t = slot.value >> 56;
-    /// check t
-    if (t == 255) {
-        /// the item was not redirected
-        if (((slot.value >> 48) & ((1ull << 8)-1)) == 0) {
-            auto offSet = static_cast<int>((slot.value >> 24) & ((1ull << 24) - 1));
-            for(auto i = 0; i < static_cast<int>(capacity); ++i){
-                record[i] = slottedPage->data[offSet - i];
+    auto pages = fix_record(tid, false);
+    return copy_record(pages.get_data(), pages.slot_id, record, capacity, false);
+}
+
+void SPSegment::read_batch(const TID *tids, size_t count, std::byte *records, uint32_t capacity,
+                           uint32_t *sizes) const {
+    /// sort the TIDs by page and remember where the pages start
+    std::vector<std::pair<TID, size_t>> order;
+    sort_by_page(tids, count, order);
+    std::vector<size_t> page_begins;
+    for (size_t i = 0; i < count; ++i) {
+        if (i == 0 || order[i].first.get_page() != order[i - 1].first.get_page()) {
+            page_begins.push_back(i);
+        }
+    }
+    page_begins.push_back(count);
+    auto prefetch = [&](size_t page) {
+        if (page + 1 < page_begins.size()) {
+            buffer_manager.prefetch(get_page_id(order[page_begins[page]].first.get_page()));
+        }
+    };
+    for (size_t page = 1; page < kPrefetchPages; ++page) {
+        prefetch(page);
+    }
+
+    /// read the records on their home pages and collect the redirects
+    std::vector<TID> targets;
+    std::vector<size_t> redirects;
+    std::vector<size_t> moved;
+    for (size_t page = 0; page + 1 < page_begins.size(); ++page) {
+        prefetch(page + kPrefetchPages);
+        uint64_t page_id = order[page_begins[page]].first.get_page();
+        bool may_be_forwarded = page_format != kFixed && page_id < segments.forward_limit;
+        if (may_be_forwarded && page_id >= segments.sp_count) {
+            for (size_t i = page_begins[page]; i < page_begins[page + 1]; ++i) {
+                moved.push_back(order[i].second);
             }
+            continue;
         }
-    } else {
-        /// we need to find the new page since the item was redirected
-        uint64_t redirected_page_id = slot.value >> 16;
-        uint16_t redirected_slot_id = slot.value & ((1ull << 16) - 1);
-        auto& redirected_page = buffer_manager.fix_page(redirected_page_id, false);
-        auto redirected_slottedPage = reinterpret_cast<SlottedPage*>(redirected_page.get_data());
-        auto& redirected_slot = *(redirected_slottedPage->slots.data() + redirected_slot_id);
-        /// write the data into page
-        auto offSet = static_cast<int>((redirected_slot.value >> 24) & ((1ull << 24) - 1));
-        for(auto i = 0; i < static_cast<int>(capacity); ++i){
-            record[i] = *(redirected_slottedPage->data.begin() + (offSet - i));
+        PageGuard guard(buffer_manager, get_page_id(page_id), false);
+        auto data = guard.get_data();
+        for (size_t i = page_begins[page]; i < page_begins[page + 1]; ++i) {
+            auto [tid, index] = order[i];
+            uint16_t slot_id = tid.get_slot();
+            if (may_be_forwarded && is_forwarded_home(data, tid)) {
+                moved.push_back(index);
+                continue;
+            }
+            if (page_format != kFixed && get_slot(data, slot_id).is_redirect()) {
+                targets.push_back(get_slot(data, slot_id).as_redirect_tid());
+                redirects.push_back(index);
+                continue;
+            }
+            sizes[index] = copy_record(data, slot_id, records + index * capacity, capacity, false);
+        }
+    }
+
+    /// read the redirected records on their target pages, every page is fixed once again
+    sort_by_page(targets.data(), targets.size(), order);
+    PageGuard guard;
+    for (auto [target, redirect] : order) {
+        auto index = redirects[redirect];
+        if (target.get_page() >= segments.sp_count) {
+            moved.push_back(index);
+            continue;
         }
+        if (!guard || guard.get_page_id() != get_page_id(target.get_page())) {
+            guard.release();
+            guard = PageGuard(buffer_manager, get_page_id(target.get_page()), false);
+        }
+        auto data = guard.get_data();
+        uint16_t slot_id = target.get_slot();
+        /// the record may have moved since we followed its redirect
+        if (slot_id >= get_slot_count(data) || !get_slot(data, slot_id).is_redirect_target()
+                || get_tid(data, target.get_page(), slot_id).value != tids[index].value) {
+            moved.push_back(index);
+            continue;
+        }
+        redirected_accesses.fetch_add(1, std::memory_order_relaxed);
+        sizes[index] = copy_record(data, slot_id, records + index * capacity, capacity, false);
     }
+    guard.release();
 
-    return 0;
+    /// forwarded records and records that moved in between are read one at a time
+    for (auto index : moved) {
+        sizes[index] = read(tids[index], records + index * capacity, capacity);
+    }
 }
 
 uint32_t SPSegment::write(TID tid, std::byte *record, uint32_t record_size) {
-    uint64_t page_id = tid.value >> 16;
-    uint16_t slot_id = tid.value & ((1ull << 16) - 1);
-    auto& page = buffer_manager.fix_page(page_id, false);
-    auto slottedPage = reinterpret_cast<SlottedPage*>(page.get_data());
-    auto& slot = *(slottedPage->slots.data() + slot_id);
-    uint8_t t = (slot.value >> 56);
-    if (t != 255) {
-        uint64_t redirected_page_id = slot.value >> 16;
-        uint16_t redirected_slot_id = slot.value & ((1ull << 16) - 1);
-        auto& redirected_page = buffer_manager.fix_page(redirected_page_id, false);
-        auto redirected_slottedPage = reinterpret_cast<SlottedPage*>(redirected_page.get_data());
-        auto& redirected_slot = *(redirected_slottedPage->slots.data() + redirected_slot_id);
-        auto offSet = static_cast<int>((redirected_slot.value >> 24) & ((1ull << 24) - 1));
-        for(auto i = 0; i < static_cast<int>(record_size); ++i){
-            slottedPage->data[offSet - i] = record[i];
+    WALSegment::Operation operation(wal);
+    uint32_t size;
+    {
+        auto pages = fix_record(tid, true);
+        if (pages.is_redirected) {
+            move_home(tid, pages, get_record_size(pages.get_data(), pages.slot_id));
         }
-    } else {
-        auto offSet = static_cast<int>((slot.value >> 24) & ((1ull << 24) - 1));
-        for(auto i = 0; i < static_cast<int>(record_size); ++i){
-            slottedPage->data[offSet - i] = record[i];
+        capture(pages.get_data(), pages.slot_id);
+        update_zones(pages.get_data(), pages.page_id, pages.slot_id, false);
+        size = copy_record(pages.get_data(), pages.slot_id, record, record_size, true);
+        update_zones(pages.get_data(), pages.page_id, pages.slot_id, true);
+        /// the key is taken from the page, since a short write keeps the trailing bytes of the record
+        /// (the filter may keep the old key of an updated record, which only causes a false positive)
+        add_key(pages.get_data(), pages.slot_id);
+        log_change(pages.get_page(), pages.slot_id);
+        pages.mark_dirty();
+    }
+    return size;
+}
+
+bool SPSegment::may_contain(const std::vector<Value> &key) const {
+    if (bloom_filter == nullptr) {
+        return true;
+    }
+    std::vector<std::byte> encoded_key(codec->get_key_size());
+    codec->encode_key(key, encoded_key.data());
+    return bloom_filter->may_contain(encoded_key.data(), static_cast<uint32_t>(encoded_key.size()));
+}
+
+void SPSegment::rebuild_bloom_filter() {
+    if (bloom_filter == nullptr) {
+        return;
+    }
+    /// the records are scanned into a new filter, records that move meanwhile add their key to it again
+    std::lock_guard<std::mutex> guard(vacuum_latch);
+    uint64_t erased = erased_keys;
+    bloom_filter->begin_rebuild();
+    for (uint64_t page_id = 0; page_id < segments.sp_count; ++page_id) {
+        PageGuard page(buffer_manager, get_page_id(page_id), false);
+        auto data = page.get_data();
+        uint16_t slot_count = get_slot_count(data);
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            /// redirect targets are found on their own page
+            if (!is_record(data, slot_id)) {
+                continue;
+            }
+            add_key(data, slot_id, true);
         }
-        slot.value = (255*1ULL)<<56 | (offSet*1ULL)<<24 | (record_size*1ULL);
     }
-    return 0;
+    bloom_filter->end_rebuild();
+    erased_keys.fetch_sub(erased, std::memory_order_relaxed);
 }
 
 void SPSegment::resize(TID tid, uint32_t new_size) {
-    uint64_t page_id = (tid.value*1ULL) >> 16;
-    uint16_t slot_id = tid.value & ((1ull << 16) - 1);
-    auto& page = buffer_manager.fix_page(page_id, false);
-    auto slottedPage = reinterpret_cast<SlottedPage*>(page.get_data());
-    auto& slot = *(slottedPage->slots.data() + slot_id);
-    auto tValue =  static_cast<int>(slot.value >> 56);
-    uint64_t redirected_page_id;
-    uint16_t redirected_slot_id;
-    if (tValue != 255) {
-        redirected_page_id = (slot.value*1ULL) >> 16;
-        redirected_slot_id = slot.value & ((1ull << 16) - 1);
-        page = buffer_manager.fix_page(redirected_page_id, false);
-        slottedPage = reinterpret_cast<SlottedPage*>(page.get_data());
-        slot = *(slottedPage->slots.data() + redirected_slot_id);
-    }
-    /// unfortunately I couldn't implement this, I might misunderstand how deletion should work
-    /// I set offset and data length to 0 in slot value, but I couldn't find a proper mechanism
-    /// to shift empty data items.
-    //slottedPage->compactify(buffer_manager.get_page_size());
-    uint32_t emptySpace = slottedPage->header.free_space;
-    if (new_size <= emptySpace) {
-        auto initialSize = static_cast<int>(slot.value & ((1ull << 24)-1));
-        slottedPage->header.free_space -= (static_cast<int>(new_size) - initialSize);
-        fsi.update(page_id, slottedPage->header.free_space);
-        /// update slot data length
-        slot.value = slot.value | (new_size & ((1ull << 24) - 1));
+    if (page_format == kFixed && new_size > fixed_layout->record_size) {
+        throw std::length_error("records of fixed-width tables cannot grow");
+    }
+    WALSegment::Operation operation(wal);
+    auto pages = fix_record(tid, true);
+    if (pages.is_redirected && move_home(tid, pages, new_size)) {
+        pages.mark_dirty();
+        return;
+    }
+    auto data = pages.get_data();
+    /// shrinking may drop columns, so we remove the record from the zone maps and add it again
+    update_zones(data, pages.page_id, pages.slot_id, false);
+    capture(data, pages.slot_id);
+    if (resize_on_page(data, pages.slot_id, new_size)) {
+        update_zones(data, pages.page_id, pages.slot_id, true);
+        log_change(pages.get_page(), pages.slot_id);
+    } else if (!pages.is_redirected) {
+        /// the record does not fit on its page anymore, move it and leave a redirect
+        auto [page_id, page] = find_page(new_size, true, &pages);
+        auto target = move_record(tid, data, pages.slot_id, new_size, page_id, page);
+        set_redirect(data, pages.slot_id, target);
+        log_change(pages.home, pages.slot_id);
+        moved_records.fetch_add(1, std::memory_order_relaxed);
     } else {
+        /// move the record again and point the original slot to its new location
+        /// (there is at most one redirect per record)
+        auto [page_id, page] = find_page(new_size, true, &pages);
+        auto target = move_record(tid, data, pages.slot_id, new_size, page_id, page, pages.is_forwarded);
+        erase_on_page(data, pages.slot_id);
+        log_change(pages.get_page(), pages.slot_id);
+        redirect_home(tid, pages, target);
+    }
+    fsi.update(pages.page_id, get_free_space(data));
+    pages.mark_dirty();
+}
 
-        /// first get the data that is going to be moved to another page
-        auto dataOffSet = static_cast<int>((slot.value >> 24) & ((1ull << 24) - 1));
-        auto dataLength = static_cast<int>(slot.value & ((1ull << 24)-1));
-        std::vector<std::byte> tempDataVector;
-        tempDataVector.reserve(dataLength);
-        for(auto i = 0; i < dataLength; ++i){
-            tempDataVector.push_back(slottedPage->data[dataOffSet - i]);
-        }
-        /// erase record on the current page, because we will move it to another page
-        uint64_t tempTidValue = tid.value;
-        erase(tid);
-        std::pair<bool, uint64_t> result = fsi.find(new_size + 8);
-
-        if (!result.first) {
-            uint64_t new_page_id = schema.get_sp_count();
-            auto& new_page = buffer_manager.fix_page(new_page_id, false);
-            auto new_slottedPage = new(new_page.get_data()) SlottedPage(buffer_manager.get_page_size());
-            /// 8 bytes for original TID
-            new_slottedPage->header.free_space -= (new_size + 8);
-            auto offSet = static_cast<int>(new_slottedPage->header.data_start);
-            /// first write original TID before actual record
-            for(auto i = 0; i < 8; ++i) {
-                new_slottedPage->data[offSet - i] = static_cast<std::byte>((tempTidValue >> i) & 0xff);
-            }
-            /// skip 8 bytes, because we wrote original TID there
-            offSet = static_cast<int>(new_slottedPage->header.data_start) - 8;
-            /// write the new data on the new page
-            for(auto i = 0; i < static_cast<int>(tempDataVector.size()); ++i){
-                new_slottedPage->data[offSet - i] = tempDataVector[i];
-            }
-            /// set slot value of redirected item, t is not equal to 255, s is not equal to 0
-            uint64_t value = (0*1ULL)<<56 | (255*1ULL)<<48 | (offSet*1ULL<<24) | (new_size*1ULL);
-            uint64_t new_slotId = new_slottedPage->addSlot(value);
-            /// set data starting point
-            new_slottedPage->header.data_start -= (static_cast<int>(new_size) + 8);
-
-            /// update bitmap with the free space
-            fsi.update(new_page_id, new_slottedPage->header.free_space);
-            schema.increase_sp_count();
-            schema.write();
-            /// write the new TID into slot value
-            auto new_tid = TID(new_page_id, new_slotId);
-            slot.value = new_tid.value;
-        } else {
-            auto& new_page = buffer_manager.fix_page(result.second, false);
-            auto new_slottedPage = reinterpret_cast<SlottedPage*>(new_page.get_data());
-            /// 8 bytes for original TID
-            new_slottedPage->header.free_space -= static_cast<int>(new_size + 8);
-            auto offSet =  static_cast<int>(new_slottedPage->header.data_start);
-            /// first write original TID before actual record
-            for(auto i = 0; i < 8; ++i) {
-                new_slottedPage->data[offSet - i] = static_cast<std::byte>((tempTidValue >> (i * 8)) & 0xff);
-            }
-            /// skip 8 bytes, because we wrote original TID there
-            offSet = static_cast<int>(new_slottedPage->header.data_start) - 8;
-            /// write the new data on the new page
-            for(auto i = 0; i < static_cast<int>(tempDataVector.size()); ++i){
-                new_slottedPage->data[offSet - i] = tempDataVector[i];
-            }
-
-            uint64_t value = (255*1ULL)<<56 | (0*1ULL)<<48 | (offSet*1ULL)<<24 | (new_size*1ULL);
-            uint64_t new_slotId = new_slottedPage->addSlot(value);
-            /// set data starting point
-            new_slottedPage->header.data_start -= (static_cast<int>(new_size) + 8);
-            /// update bitmap with the free space
-            fsi.update(result.second, new_slottedPage->header.free_space);
-            /// write the new TID into slot value
-            auto new_tid = TID(result.second, new_slotId);
-            /// here I need to get the original page if the redirected item is redirected again.
-            /// because slot is pointed to the slot on the redirected page
-            if (tValue != 255) {
-                auto& original_page = buffer_manager.fix_page(page_id, false);
-                auto original_slottedPage = reinterpret_cast<SlottedPage*>(original_page.get_data());
-                auto& original_slot = *(original_slottedPage->slots.data() + slot_id);
-                original_slot.value = new_tid.value;
+void SPSegment::erase(TID tid) {
+    WALSegment::Operation operation(wal);
+    auto pages = fix_record(tid, true);
+    update_zones(pages.get_data(), pages.page_id, pages.slot_id, false);
+    /// the slot of the TID is erased first, so that an abort restores a forwarded record before its reservation
+    /// (the entry of a forwarded record whose page was removed is kept in case of an abort)
+    if (pages.home) {
+        if (pages.is_forwarded) {
+            erase_forward(tid, TID(pages.page_id, pages.slot_id));
+        }
+        capture(pages.home.get_data(), tid.get_slot());
+        erase_on_page(pages.home.get_data(), tid.get_slot());
+        log_change(pages.home, tid.get_slot());
+        fsi.update(tid.get_page(), get_free_space(pages.home.get_data()));
+    }
+    if (pages.is_redirected) {
+        capture(pages.get_data(), pages.slot_id);
+        erase_on_page(pages.get_data(), pages.slot_id);
+        log_change(pages.get_page(), pages.slot_id);
+        fsi.update(pages.page_id, get_free_space(pages.get_data()));
+    }
+    if (bloom_filter != nullptr) {
+        erased_keys.fetch_add(1, std::memory_order_relaxed);
+    }
+    pages.mark_dirty();
+}
+
+SPSegment::RedirectStatistics SPSegment::get_redirect_statistics() const {
+    RedirectStatistics statistics;
+    statistics.moved_records = moved_records.load(std::memory_order_relaxed);
+    statistics.returned_records = returned_records.load(std::memory_order_relaxed);
+    statistics.redirected_accesses = redirected_accesses.load(std::memory_order_relaxed);
+    return statistics;
+}
+
+uint64_t SPSegment::count_redirected_records() const {
+    uint64_t count = 0;
+    if (page_format == kFixed) {
+        return count;
+    }
+    for (uint64_t page_id = 0; page_id < segments.sp_count; ++page_id) {
+        PageGuard page(buffer_manager, get_page_id(page_id), false);
+        auto data = page.get_data();
+        uint16_t slot_count = get_slot_count(data);
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            /// forwarded records have no redirect, but every moved record has a target
+            auto& slot = get_slot(data, slot_id);
+            count += !slot.is_empty() && slot.is_redirect_target();
+        }
+    }
+    return count;
+}
+
+SPSegment::VacuumStatistics SPSegment::vacuum(uint64_t page_count) {
+    VacuumStatistics statistics;
+    bool rebuild = false;
+    {
+        std::lock_guard<std::mutex> guard(vacuum_latch);
+        for (; statistics.visited_pages < page_count; ++statistics.visited_pages) {
+            uint64_t sp_count = segments.sp_count;
+            if (sp_count == 0) {
+                break;
+            }
+            if (vacuum_position == 0 || vacuum_position > sp_count) {
+                /// start over at the end of the segment
+                vacuum_position = sp_count;
+            }
+            --vacuum_position;
+            {
+                /// the moves have to commit before the page is removed, which is never undone
+                WALSegment::Operation operation(wal);
+                vacuum_page(vacuum_position, statistics);
+            }
+            WALSegment::Operation operation(wal, false);
+            if (truncate_page(vacuum_position, statistics)) {
+                ++statistics.truncated_pages;
             } else {
-                slot.value = new_tid.value;
+                PageGuard page(buffer_manager, get_page_id(vacuum_position), true);
+                if (vacuum_position < segments.sp_count && compact_on_page(page.get_data())) {
+                    page.mark_dirty();
+                    ++statistics.compacted_pages;
+                }
             }
+            /// the keys of erased records stay in the Bloom filter, it is rebuilt once per pass over the pages
+            rebuild |= vacuum_position == 0 && erased_keys > 0;
         }
     }
+    if (rebuild) {
+        rebuild_bloom_filter();
+        ++statistics.rebuilt_filters;
+    }
+    return statistics;
 }
 
-void SPSegment::erase(TID tid) {
-    uint64_t page_id = (tid.value*1ULL) >> 16;
-    uint16_t slot_id = tid.value & ((1ull << 16) - 1);
-    auto& page = buffer_manager.fix_page(page_id, false);
-    auto slottedPage = reinterpret_cast<SlottedPage*>(page.get_data());
-    auto& slot = *(slottedPage->slots.data() + slot_id);
-    auto offSet = static_cast<int>((slot.value >> 24) & ((1ull << 24) - 1));
-    auto length = static_cast<int>(slot.value & ((1ull << 24)-1));
-    for(auto i = 0; i < length; ++i){
-        slottedPage->data[offSet - i] = static_cast<std::byte>(0);
-    }
-    /// set empty slot
-    slot.value = (255*1ULL<<56);
+void SPSegment::vacuum_page(uint64_t page_id, VacuumStatistics &statistics) {
+    /// collect the redirects, the redirect targets and the other records, they are moved under the latches of
+    /// their records
+    std::vector<TID> redirects;
+    std::vector<std::pair<TID, uint16_t>> targets;
+    std::vector<TID> records;
+    std::vector<uint16_t> reservations;
+    bool is_sparse = false;
+    if (page_format != kFixed) {
+        PageGuard page(buffer_manager, get_page_id(page_id), false);
+        auto data = page.get_data();
+        uint16_t slot_count = get_slot_count(data);
+        uint32_t used_space = 0;
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            auto& slot = get_slot(data, slot_id);
+            TID tid(page_id, slot_id);
+            if (slot.is_empty()) {
+                continue;
+            }
+            if (slot.is_redirect()) {
+                /// a reservation is left over if the forwarded record was erased before the segment was opened
+                TID target(0);
+                if (!is_reserved(data, tid)) {
+                    redirects.push_back(tid);
+                } else if (!find_forward(tid, target)) {
+                    reservations.push_back(slot_id);
+                }
+                continue;
+            }
+            used_space += get_required_space(get_record_size(data, slot_id), true);
+            if (slot.is_redirect_target()) {
+                targets.emplace_back(get_tid(data, page_id, slot_id), slot_id);
+            } else {
+                records.push_back(tid);
+            }
+        }
+        /// the records of a sparse last page move to lower pages, so that the page can be removed
+        is_sparse = page_id + 1 == segments.sp_count && used_space <= buffer_manager.get_page_size() / 4;
+    }
+    if (is_sparse && segments.forward_limit <= page_id) {
+        segments.forward_limit = page_id + 1;
+    }
+
+    if (!is_sparse) {
+        for (auto tid : redirects) {
+            auto pages = fix_record(tid, true);
+            if (pages.is_redirected && move_home(tid, pages, get_record_size(pages.get_data(), pages.slot_id))) {
+                pages.mark_dirty();
+                ++statistics.moved_records;
+            }
+        }
+    }
+    for (auto [tid, slot_id] : targets) {
+        auto pages = fix_record(tid, true);
+        if (!pages.is_redirected || pages.page_id != page_id || pages.slot_id != slot_id) {
+            /// the record was moved or erased in the meantime
+            continue;
+        }
+        auto size = get_record_size(pages.get_data(), slot_id);
+        if (move_home(tid, pages, size)) {
+            pages.mark_dirty();
+            ++statistics.moved_records;
+            continue;
+        }
+        /// move the record towards the beginning of the segment, so that the pages at the end become empty
+        auto [target_page_id, target_page] = find_page(size, true, &pages, page_id);
+        if (!target_page) {
+            continue;
+        }
+        auto data = pages.get_data();
+        update_zones(data, page_id, slot_id, false);
+        auto target = move_record(tid, data, slot_id, size, target_page_id, target_page, pages.is_forwarded);
+        capture(data, slot_id);
+        erase_on_page(data, slot_id);
+        log_change(pages.get_page(), slot_id);
+        redirect_home(tid, pages, target);
+        fsi.update(page_id, get_free_space(data));
+        pages.mark_dirty();
+        ++statistics.moved_records;
+    }
+    if (is_sparse) {
+        merge_page(page_id, records, redirects, statistics);
+    }
+
+    if (!reservations.empty()) {
+        PageGuard page(buffer_manager, get_page_id(page_id), true);
+        for (auto slot_id : reservations) {
+            TID tid(page_id, slot_id), target(0);
+            auto data = page.get_data();
+            if (page_id >= segments.sp_count || !is_reserved(data, tid) || find_forward(tid, target)) {
+                continue;
+            }
+            capture(data, slot_id);
+            erase_on_page(data, slot_id);
+            log_change(page, slot_id);
+            fsi.update(page_id, get_free_space(data));
+        }
+    }
+}
+
+void SPSegment::merge_page(uint64_t page_id, const std::vector<TID> &records, const std::vector<TID> &redirects,
+                           VacuumStatistics &statistics) {
+    /// the records leave a redirect to a marked target, which replaces the redirect when the page is removed
+    for (auto tid : records) {
+        auto pages = fix_record(tid, true);
+        if (pages.is_redirected) {
+            /// the record was moved in the meantime
+            continue;
+        }
+        auto data = pages.home.get_data();
+        if (tid.get_slot() >= get_slot_count(data) || !is_record(data, tid.get_slot())
+                || get_slot(data, tid.get_slot()).is_redirect_target()) {
+            /// the record was erased in the meantime
+            continue;
+        }
+        auto size = get_record_size(data, tid.get_slot());
+        auto [target_page_id, target_page] = find_page(size, true, &pages, page_id);
+        if (!target_page) {
+            /// the lower pages are full
+            return;
+        }
+        update_zones(data, page_id, tid.get_slot(), false);
+        capture(data, tid.get_slot());
+        auto target = move_record(tid, data, tid.get_slot(), size, target_page_id, target_page, true);
+        set_redirect(data, tid.get_slot(), target);
+        log_change(pages.home, tid.get_slot());
+        set_forward(tid, target);
+        fsi.update(page_id, get_free_space(data));
+        pages.mark_dirty();
+        ++statistics.moved_records;
+    }
+    /// records that were redirected before are marked where they are
+    for (auto tid : redirects) {
+        auto pages = fix_record(tid, true);
+        if (!pages.is_redirected || pages.is_forwarded || pages.page_id == page_id) {
+            continue;
+        }
+        auto data = pages.get_data();
+        capture(data, pages.slot_id);
+        set_forwarded(data, pages.slot_id);
+        log_change(pages.get_page(), pages.slot_id);
+        set_forward(tid, TID(pages.page_id, pages.slot_id));
+        pages.mark_dirty();
+    }
+}
+
+bool SPSegment::truncate_page(uint64_t page_id, VacuumStatistics &statistics) {
+    std::lock_guard<std::mutex> guard(page_count_latch);
+    if (page_id + 1 != segments.sp_count) {
+        return false;
+    }
+    /// threads that hold the page may wait for the page count latch, so we must not wait for them
+    auto* frame = buffer_manager.try_fix_page(get_page_id(page_id), true);
+    if (frame == nullptr) {
+        return false;
+    }
+    PageGuard page(buffer_manager, *frame);
+    auto data = page.get_data();
+    uint16_t slot_count = get_slot_count(data);
+    if (page_format == kFixed && slot_count != 0) {
+        return false;
+    }
+    /// a transaction that is still active may undo a change of the page
+    if (wal != nullptr && get_page_lsn(data) >= wal->get_oldest_lsn()) {
+        return false;
+    }
+    /// the page may only hold the redirects of forwarded records, which are found through their TIDs from now on
+    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        auto& slot = get_slot(data, slot_id);
+        if (slot.is_empty()) {
+            continue;
+        }
+        TID tid(page_id, slot_id), target(0);
+        if (!slot.is_redirect() || !find_forward(tid, target)) {
+            return false;
+        }
+        auto redirect = slot.as_redirect_tid();
+        if (redirect.value != tid.value && redirect.value != target.value) {
+            return false;
+        }
+    }
+    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        if (!get_slot(data, slot_id).is_empty()) {
+            ++statistics.forwarded_records;
+        }
+    }
+    segments.sp_count = page_id;
+    if (wal != nullptr) {
+        /// recovery must not create the page again from its changes
+        wal->log_truncate(page.get_page_id());
+    }
+    buffer_manager.truncate(segment_id, page_id);
+    return true;
+}
+
+void SPSegment::redo_truncate(uint64_t page_id) {
+    std::lock_guard<std::mutex> guard(page_count_latch);
+    if (segments.sp_count > page_id) {
+        segments.sp_count = page_id;
+    }
+    buffer_manager.truncate(segment_id, page_id);
+}
+
+uint64_t SPSegment::get_page_lsn(char *page) const {
+    if (page_format == kPAX) {
+        return reinterpret_cast<PaxPage*>(page)->header.lsn;
+    }
+    if (page_format == kFixed) {
+        return reinterpret_cast<FixedPage*>(page)->header.lsn;
+    }
+    return reinterpret_cast<SlottedPage*>(page)->header.lsn;
+}
+
+void SPSegment::set_page_lsn(PageGuard &page, uint64_t lsn) const {
+    auto data = page.get_data();
+    if (page_format == kPAX) {
+        reinterpret_cast<PaxPage*>(data)->header.lsn = lsn;
+    } else if (page_format == kFixed) {
+        reinterpret_cast<FixedPage*>(data)->header.lsn = lsn;
+    } else {
+        reinterpret_cast<SlottedPage*>(data)->header.lsn = lsn;
+    }
+    page.set_lsn(lsn);
+}
+
+void SPSegment::get_slot_image(char *page, uint16_t slot_id, std::vector<std::byte> &image) const {
+    /// the buffers of the thread keep their capacity, so that logging does not allocate
+    image.clear();
+    bool is_empty = slot_id >= get_slot_count(page) || (page_format == kFixed
+        ? !reinterpret_cast<FixedPage*>(page)->is_occupied(slot_id) : get_slot(page, slot_id).is_empty());
+    if (is_empty) {
+        image.push_back(std::byte{kEmptySlot});
+        return;
+    }
+    if (page_format != kFixed && get_slot(page, slot_id).is_redirect()) {
+        auto target = get_slot(page, slot_id).as_redirect_tid();
+        image.resize(1 + kTIDSize);
+        image[0] = std::byte{kRedirectSlot};
+        std::memcpy(&image[1], &target.value, kTIDSize);
+        return;
+    }
+    bool is_redirect_target = page_format != kFixed && get_slot(page, slot_id).is_redirect_target();
+    uint32_t prefix = is_redirect_target ? kTIDSize : 0;
+    uint32_t size = get_record_size(page, slot_id);
+    image.resize(1 + prefix + size);
+    image[0] = std::byte{is_redirect_target ? kTargetSlot : kRecordSlot};
+    if (is_redirect_target) {
+        /// the original TID keeps the mark of a forwarded record
+        std::memcpy(&image[1], page + get_slot(page, slot_id).get_offset(), kTIDSize);
+    }
+    copy_record(page, slot_id, &image[1 + prefix], size, false);
+}
+
+void SPSegment::apply_slot_image(PageGuard &page, uint16_t slot_id, const std::byte *image, uint32_t size) {
+    auto data = page.get_data();
+    uint64_t page_id = BufferManager::get_segment_page_id(page.get_page_id());
+    /// the slot is emptied first, so the image does not depend on where the record was stored
+    bool is_empty = slot_id >= get_slot_count(data) || (page_format == kFixed
+        ? !reinterpret_cast<FixedPage*>(data)->is_occupied(slot_id) : get_slot(data, slot_id).is_empty());
+    if (!is_empty) {
+        if (is_record(data, slot_id)) {
+            update_zones(data, page_id, slot_id, false);
+        }
+        if (page_format != kFixed && is_forwarded(data, slot_id)) {
+            erase_forward(get_tid(data, page_id, slot_id), TID(page_id, slot_id));
+        }
+        erase_on_page(data, slot_id);
+    }
+    auto kind = static_cast<uint8_t>(image[0]);
+    if (kind != kEmptySlot) {
+        uint32_t prefix = kind == kRecordSlot ? 0 : kTIDSize;
+        uint32_t record_size = size - 1 - prefix;
+        TID tid(0);
+        std::memcpy(&tid.value, image + 1, prefix);
+        if (!fits(data, slot_id, record_size, kind == kTargetSlot)) {
+            throw std::length_error("the page has no space left for the logged record");
+        }
+        allocate_on_page(data, slot_id, record_size, kind == kTargetSlot);
+        if (kind == kRedirectSlot) {
+            set_redirect(data, slot_id, tid);
+        } else {
+            if (kind == kTargetSlot) {
+                std::memcpy(data + get_slot(data, slot_id).get_offset(), &tid.value, kTIDSize);
+            }
+            copy_record(data, slot_id, const_cast<std::byte*>(image + 1 + prefix), record_size, true);
+            update_zones(data, page_id, slot_id, true);
+            if (kind == kTargetSlot && (tid.value & kForwarded) != 0) {
+                /// an abort moves a forwarded record back
+                set_forward(TID(tid.value & ~kForwarded), TID(page_id, slot_id));
+            }
+        }
+    }
+    fsi.update(page_id, get_free_space(data));
+    page.mark_dirty();
+}
+
+void SPSegment::capture(char *page, uint16_t slot_id) const {
+    if (wal != nullptr) {
+        get_slot_image(page, slot_id, get_before_image());
+    }
+}
+
+void SPSegment::log_change(PageGuard &page, uint16_t slot_id, bool was_empty) const {
+    if (wal == nullptr) {
+        return;
+    }
+    /// a captured image may still be needed for a later change of the operation, so it is left untouched
+    static constexpr std::byte kEmptyImage[] = { std::byte{kEmptySlot} };
+    auto& before = get_before_image();
+    auto& after = get_after_image();
+    get_slot_image(page.get_data(), slot_id, after);
+    auto lsn = wal->log_update(page.get_page_id(), slot_id, was_empty ? kEmptyImage : before.data(),
+                               was_empty ? 1 : static_cast<uint32_t>(before.size()),
+                               after.data(), static_cast<uint32_t>(after.size()));
+    set_page_lsn(page, lsn);
+    page.mark_dirty();
+}
+
+void SPSegment::recover_page(uint64_t page_id) {
+    {
+        std::lock_guard<std::mutex> guard(page_count_latch);
+        if (segments.sp_count <= page_id) {
+            segments.sp_count = page_id + 1;
+        }
+    }
+    PageGuard page(buffer_manager, get_page_id(page_id), false);
+    auto data = page.get_data();
+    if (zone_maps != nullptr) {
+        zone_maps->reset(page_id);
+    }
+    uint16_t slot_count = get_slot_count(data);
+    for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+        if (!is_record(data, slot_id)) {
+            continue;
+        }
+        update_zones(data, page_id, slot_id, true);
+        add_key(data, slot_id);
+        /// forwarded records are found by a scan after recovery, also if the schema does not know of them yet
+        if (page_format != kFixed && is_forwarded(data, slot_id) && segments.forward_limit < segments.sp_count) {
+            segments.forward_limit = segments.sp_count.load();
+        }
+    }
+    fsi.update(page_id, get_free_space(data));
+}
+
+void SPSegment::flush_derived() {
+    /// the page count is part of the schema header
+    schema.checkpoint();
+    buffer_manager.flush_segment(schema.segment_id);
+    buffer_manager.flush_segment(segments.fsi_segment_id);
+    if (zone_maps != nullptr) {
+        buffer_manager.flush_segment(segments.zone_map_segment_id);
+    }
+    if (bloom_filter != nullptr) {
+        buffer_manager.flush_segment(segments.bloom_filter_segment_id);
+    }
+}
+
+bool SPSegment::is_record(char *page, uint16_t slot_id) const {
+    if (page_format == kFixed) {
+        return reinterpret_cast<FixedPage*>(page)->is_occupied(slot_id);
+    }
+    auto& slot = get_slot(page, slot_id);
+    return !slot.is_empty() && !slot.is_redirect();
+}
+
+uint16_t SPSegment::get_slot_count(char *page) const {
+    if (page_format == kPAX) {
+        return reinterpret_cast<PaxPage*>(page)->header.slot_count;
+    }
+    if (page_format == kFixed) {
+        return reinterpret_cast<FixedPage*>(page)->header.slot_count;
+    }
+    return reinterpret_cast<SlottedPage*>(page)->header.slot_count;
+}
+
+TID SPSegment::get_tid(char *page, uint64_t page_id, uint16_t slot_id) const {
+    if (page_format == kFixed) {
+        return TID(page_id, slot_id);
+    }
+    auto& slot = get_slot(page, slot_id);
+    if (!slot.is_redirect_target()) {
+        return TID(page_id, slot_id);
+    }
+    TID tid(0);
+    std::memcpy(&tid.value, page + slot.get_offset(), kTIDSize);
+    tid.value &= ~kForwarded;
+    return tid;
+}
+
+const std::byte *SPSegment::get_nulls(char *page, uint16_t slot_id) const {
+    if (page_format == kPAX) {
+        return reinterpret_cast<PaxPage*>(page)->get_value(pax_layout->minipages[0], slot_id);
+    }
+    if (page_format == kFixed) {
+        return reinterpret_cast<FixedPage*>(page)->get_record(*fixed_layout, slot_id);
+    }
+    auto& slot = get_slot(page, slot_id);
+    return reinterpret_cast<SlottedPage*>(page)->get_record_data(slot) + (slot.is_redirect_target() ? kTIDSize : 0);
+}
+
+const std::byte *SPSegment::get_value(char *page, uint16_t slot_id, uint32_t column) const {
+    if (page_format == kPAX) {
+        auto& minipage = pax_layout->minipages[pax_layout->column_minipages[column]];
+        return reinterpret_cast<PaxPage*>(page)->get_value(minipage, slot_id);
+    }
+    return get_nulls(page, slot_id) + codec->get_column(column).offset;
+}
+
+bool SPSegment::is_null(char *page, uint16_t slot_id, uint32_t column) const {
+    /// short records lack the trailing columns, we treat them as NULL
+    uint32_t size = get_record_size(page, slot_id);
+    const auto& layout = codec->get_column(column);
+    return size < codec->get_null_bytes() || layout.offset + layout.width > size
+        || codec->is_null(get_nulls(page, slot_id), column);
+}
+
+void SPSegment::scan_column(uint32_t column, const std::function<void(TID, const std::byte*)> &callback) const {
+    assert(codec && codec->get_column(column).tclass != schema::Type::kVarchar);
+    for (uint64_t page_id = 0; page_id < segments.sp_count; ++page_id) {
+        PageGuard page(buffer_manager, get_page_id(page_id), false);
+        auto data = page.get_data();
+        uint16_t slot_count = get_slot_count(data);
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            if (!is_record(data, slot_id)) {
+                continue;
+            }
+            auto value = is_null(data, slot_id, column) ? nullptr : get_value(data, slot_id, column);
+            callback(get_tid(data, page_id, slot_id), value);
+        }
+    }
+}
+
+uint32_t SPSegment::select_on_page(char *page, const std::vector<Predicate> &predicates, ScanState &state) const {
+    uint16_t slot_count = get_slot_count(page);
+    state.mask.assign((slot_count + 63) / 64, 0);
+    if (page_format == kFixed) {
+        /// the occupancy bitmap is the mask (there are no records behind the slot count)
+        std::memcpy(state.mask.data(), reinterpret_cast<FixedPage*>(page)->get_bitmap(),
+                    state.mask.size() * sizeof(uint64_t));
+    } else {
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            if (is_record(page, slot_id)) {
+                state.mask[slot_id / 64] |= 1ull << (slot_id % 64);
+            }
+        }
+    }
+
+    for (const auto& predicate : predicates) {
+        const auto& column = codec->get_column(predicate.column);
+        /// NULL never satisfies a predicate
+        for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+            if (((state.mask[slot_id / 64] >> (slot_id % 64)) & 1) && is_null(page, slot_id, predicate.column)) {
+                state.mask[slot_id / 64] &= ~(1ull << (slot_id % 64));
+            }
+        }
+
+        /// on PAX pages, the kernels run directly on the minipage, otherwise we gather the values first
+        const std::byte *values = nullptr;
+        if (page_format == kPAX) {
+            values = slot_count > 0 ? get_value(page, 0, predicate.column) : nullptr;
+        } else if (column.tclass == schema::Type::kChar) {
+            state.strings.assign(slot_count * column.width, std::byte{0});
+            for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+                if ((state.mask[slot_id / 64] >> (slot_id % 64)) & 1) {
+                    std::memcpy(&state.strings[slot_id * column.width], get_value(page, slot_id, predicate.column),
+                                column.width);
+                }
+            }
+            values = state.strings.data();
+        } else {
+            state.values.assign(slot_count, 0);
+            for (uint16_t slot_id = 0; slot_id < slot_count; ++slot_id) {
+                if ((state.mask[slot_id / 64] >> (slot_id % 64)) & 1) {
+                    std::memcpy(&state.values[slot_id], get_value(page, slot_id, predicate.column), sizeof(int64_t));
+                }
+            }
+            values = reinterpret_cast<const std::byte*>(state.values.data());
+        }
+
+        if (column.tclass == schema::Type::kChar && predicate.string.size() > column.width) {
+            /// no value of the column equals a longer constant, so only the NULLs fail an inequality
+            if (predicate.comparison == Predicate::kEqual) {
+                std::fill(state.mask.begin(), state.mask.end(), 0);
+            }
+        } else if (column.tclass == schema::Type::kChar) {
+            state.constant.assign(column.width, std::byte{0});
+            std::memcpy(state.constant.data(), predicate.string.data(), predicate.string.size());
+            simd::filter_char(values, column.width, slot_count, state.constant.data(),
+                              predicate.comparison == Predicate::kEqual, state.mask.data());
+        } else {
+            simd::filter_int64(reinterpret_cast<const int64_t*>(values), slot_count, predicate.comparison,
+                               predicate.lower, predicate.upper, state.mask.data());
+        }
+    }
+
+    state.selection.resize(slot_count);
+    return simd::to_selection_vector(state.mask.data(), slot_count, state.selection.data());
+}
+
+std::vector<TID> SPSegment::scan(const std::vector<Predicate> &predicates) const {
+    if (!codec) {
+        throw std::invalid_argument("predicates require a table");
+    }
+    for (const auto& predicate : predicates) {
+        if (predicate.column >= codec->get_column_count()) {
+            throw std::invalid_argument("unknown column");
+        }
+        auto tclass = codec->get_column(predicate.column).tclass;
+        if (tclass == schema::Type::kVarchar) {
+            throw std::invalid_argument("predicates on varchar columns are not supported");
+        }
+        if (tclass == schema::Type::kChar && predicate.comparison != Predicate::kEqual
+                && predicate.comparison != Predicate::kNotEqual) {
+            throw std::invalid_argument("char columns only support (in)equality predicates");
+        }
+    }
+
+    std::vector<TID> result;
+    ScanState state;
+    for (uint64_t page_id = 0; page_id < segments.sp_count; ++page_id) {
+        if (zone_maps != nullptr && !zone_maps->may_match(page_id, predicates)) {
+            continue;
+        }
+        PageGuard page(buffer_manager, get_page_id(page_id), false);
+        auto selected = select_on_page(page.get_data(), predicates, state);
+        for (uint32_t i = 0; i < selected; ++i) {
+            result.push_back(get_tid(page.get_data(), page_id, state.selection[i]));
+        }
+    }
+    return result;
 }
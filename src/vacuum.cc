@@ -0,0 +1,38 @@
+#include "moderndbs/vacuum.h"
+
+using Vacuum = moderndbs::Vacuum;
+
+Vacuum::Vacuum(SPSegment &segment, uint64_t pages_per_step, std::chrono::milliseconds pause)
+    : segment(segment), pages_per_step(pages_per_step), pause(pause) {
+    thread = std::thread([this] { run(); });
+}
+
+Vacuum::~Vacuum() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopped = true;
+    }
+    stop_condition.notify_all();
+    thread.join();
+}
+
+moderndbs::SPSegment::VacuumStatistics Vacuum::get_statistics() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return statistics;
+}
+
+void Vacuum::run() {
+    std::unique_lock<std::mutex> guard(mutex);
+    while (!stopped) {
+        guard.unlock();
+        auto step = segment.vacuum(pages_per_step);
+        guard.lock();
+        statistics.visited_pages += step.visited_pages;
+        statistics.moved_records += step.moved_records;
+        statistics.compacted_pages += step.compacted_pages;
+        statistics.truncated_pages += step.truncated_pages;
+        statistics.forwarded_records += step.forwarded_records;
+        statistics.rebuilt_filters += step.rebuilt_filters;
+        stop_condition.wait_for(guard, pause, [this] { return stopped; });
+    }
+}
@@ -0,0 +1,621 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include "moderndbs/segment.h"
+
+using WALSegment = moderndbs::WALSegment;
+using BufferManager = moderndbs::BufferManager;
+using File = moderndbs::File;
+using PageGuard = moderndbs::PageGuard;
+using SPSegment = moderndbs::SPSegment;
+
+/*
+The log is a sequence of records in its own file. The LSN of a record is its offset in the file plus one, so that
+0 means "no record". A record consists of a header, the image of the slot before the change and the image after
+the change. Compensation records only have an after image, format, commit and end records have no images.
+
+Records are appended to a buffer in memory. A thread that needs the log on disk writes the whole buffer with one
+synchronous write while the others append to the second buffer. Threads that need records that are being written
+wait for the writer and then write the records that were appended in the meantime, again with one write.
+
+The file grows in chunks, its tail is zero. The end of the log is the first record whose checksum does not match
+(a record that was written partially), recovery cuts the file off there.
+
+The records start behind a header that holds the LSN of the last checkpoint record, it is written once the record
+is durable. A checkpoint record holds:
+  1) The LSN where the checkpoint began, the pages and the data that is not logged are on disk up to there
+  2) The LSN where the dirty page table was taken
+  3) The id of the next transaction
+  4) The number of active transactions and their (id, last LSN)
+  5) The number of dirty pages and their (page id, recovery LSN)
+Recovery reads the log from the smaller one of the LSN where the checkpoint began and the recovery LSNs on.
+Records before the table LSN only have to be redone if their page is in the dirty page table.
+*/
+
+namespace {
+
+/// The header of a log record, followed by the before and the after image
+struct RecordHeader {
+    /// The size of the record including the images
+    uint32_t size;
+    /// The checksum of the rest of the record
+    uint32_t checksum;
+    /// The LSN of the record
+    uint64_t lsn;
+    /// The transaction (0 for records that are never undone)
+    uint64_t transaction;
+    /// The previous record of the transaction
+    uint64_t prev_lsn;
+    /// The next record of the transaction that has to be undone (compensation records only)
+    uint64_t undo_next_lsn;
+    /// The page that changed
+    uint64_t page_id;
+    /// The size of the before image
+    uint32_t before_size;
+    /// The slot that changed
+    uint16_t slot_id;
+    /// The RecordType
+    uint8_t type;
+    /// Unused
+    uint8_t padding;
+};
+
+/// The size of the checksum and of the record size that precedes it
+constexpr uint32_t kChecksumEnd = 2 * sizeof(uint32_t);
+
+/// The file grows by this many bytes at once
+constexpr uint64_t kChunkSize = 1 << 20;
+
+/// The size of the header of the file, the records start behind it
+constexpr uint64_t kHeaderSize = 4096;
+
+/// The header of the file
+struct FileHeader {
+    /// The LSN of the last complete checkpoint record (0 if there is none)
+    uint64_t checkpoint_lsn;
+    /// The checksum of the LSN
+    uint32_t checksum;
+    /// Unused
+    uint32_t padding;
+};
+
+/// Compute the FNV-1a hash of a log record.
+uint32_t get_checksum(const std::byte *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+/// Reads the records of the log in order through a window of the file.
+class LogReader {
+    public:
+    /// Constructor
+    LogReader(File &file, uint64_t end) : file(file), end(end) {}
+
+    /// Get the record at an offset.
+    /// Returns nullptr at the end of the log. The record is valid until the next call.
+    const std::byte *read(uint64_t offset, RecordHeader &header) {
+        if (!load(offset, sizeof(RecordHeader))) {
+            return nullptr;
+        }
+        std::memcpy(&header, &window[offset - window_offset], sizeof(RecordHeader));
+        if (header.size < sizeof(RecordHeader) || header.lsn != offset + 1 || !load(offset, header.size)) {
+            return nullptr;
+        }
+        auto record = &window[offset - window_offset];
+        if (get_checksum(record + kChecksumEnd, header.size - kChecksumEnd) != header.checksum
+                || header.before_size > header.size - sizeof(RecordHeader)) {
+            return nullptr;
+        }
+        return record;
+    }
+
+    private:
+    /// Make sure that the window holds a range of the file.
+    bool load(uint64_t offset, uint64_t size) {
+        if (offset + size > end) {
+            return false;
+        }
+        if (offset >= window_offset && offset + size <= window_offset + window.size()) {
+            return true;
+        }
+        window_offset = offset;
+        window.resize(std::min(std::max(size, kChunkSize), end - offset));
+        file.read_block(offset, window.size(), reinterpret_cast<char*>(window.data()));
+        return true;
+    }
+
+    /// The file
+    File &file;
+    /// The end of the records
+    uint64_t end;
+    /// The window
+    std::vector<std::byte> window;
+    /// The offset of the window in the file
+    uint64_t window_offset = 0;
+};
+
+}  // namespace
+
+WALSegment::Operation::Operation(WALSegment *wal, bool own_transaction)
+    : wal(wal), exceptions(std::uncaught_exceptions()) {
+    if (wal != nullptr) {
+        implicit = wal->begin_operation(epoch, own_transaction);
+    }
+}
+
+WALSegment::Operation::~Operation() {
+    if (wal == nullptr) {
+        return;
+    }
+    if (implicit) {
+        if (std::uncaught_exceptions() > exceptions) {
+            wal->abort();
+        } else {
+            wal->commit(false);
+        }
+    }
+    wal->end_operation(epoch);
+}
+
+WALSegment::WALSegment(uint16_t segment_id, BufferManager &buffer_manager)
+    : Segment(segment_id, buffer_manager),
+      file(File::open_file(std::to_string(segment_id).c_str(), File::WRITE)), buffer_offset(kHeaderSize),
+      flushed_offset(kHeaderSize), checkpoint_offset(kHeaderSize), recovered(file->size() == 0) {
+    buffer_manager.set_log([this](uint64_t lsn) { flush(lsn); });
+}
+
+WALSegment::~WALSegment() {
+    flush(~0ull);
+    buffer_manager.set_log(nullptr);
+}
+
+void WALSegment::attach(SPSegment &segment) {
+    segments[segment.segment_id] = &segment;
+}
+
+SPSegment &WALSegment::get_segment(uint64_t page_id) const {
+    auto it = segments.find(BufferManager::get_segment_id(page_id));
+    if (it == segments.end()) {
+        throw std::logic_error("the log has changes of a segment that was not constructed with it");
+    }
+    return *it->second;
+}
+
+void WALSegment::begin() {
+    std::lock_guard<std::mutex> guard(log_latch);
+    if (!recovered) {
+        throw std::logic_error("the log has to be recovered first");
+    }
+    auto [it, inserted] = transactions.try_emplace(std::this_thread::get_id());
+    if (!inserted) {
+        throw std::logic_error("the thread is in a transaction already");
+    }
+    it->second.id = next_transaction++;
+}
+
+bool WALSegment::begin_operation(uint64_t &operation_epoch, bool own_transaction) {
+    std::lock_guard<std::mutex> guard(log_latch);
+    if (!recovered) {
+        throw std::logic_error("the log has to be recovered first");
+    }
+    operation_epoch = epoch;
+    ++operations[epoch & 1];
+    if (!own_transaction) {
+        return false;
+    }
+    auto [it, inserted] = transactions.try_emplace(std::this_thread::get_id());
+    if (inserted) {
+        it->second.id = next_transaction++;
+    }
+    return inserted;
+}
+
+void WALSegment::end_operation(uint64_t operation_epoch) {
+    std::lock_guard<std::mutex> guard(log_latch);
+    if (--operations[operation_epoch & 1] == 0 && operation_epoch != epoch) {
+        drained.notify_all();
+    }
+}
+
+uint64_t WALSegment::next_epoch(std::vector<Transaction> *active) {
+    std::unique_lock<std::mutex> guard(log_latch);
+    uint64_t lsn = buffer_offset + buffer.size() + 1;
+    if (active != nullptr) {
+        for (auto& [thread, transaction] : transactions) {
+            if (transaction.last_lsn != 0) {
+                active->push_back(transaction);
+            }
+        }
+    }
+    /// the operations of the epoch before the previous one finished when the previous epoch started
+    uint64_t previous = epoch++;
+    drained.wait(guard, [&] { return operations[previous & 1] == 0; });
+    return lsn;
+}
+
+void WALSegment::commit() {
+    commit(true);
+}
+
+void WALSegment::commit(bool wait) {
+    uint64_t lsn = 0;
+    {
+        std::lock_guard<std::mutex> guard(log_latch);
+        auto it = transactions.find(std::this_thread::get_id());
+        if (it == transactions.end()) {
+            throw std::logic_error("the thread is not in a transaction");
+        }
+        /// transactions without changes do not need a commit record
+        if (it->second.last_lsn != 0) {
+            lsn = append(kCommit, &it->second, 0, 0, nullptr, 0, nullptr, 0);
+        }
+        transactions.erase(it);
+        if (wait) {
+            ++statistics.commits;
+        }
+    }
+    if (wait) {
+        flush(lsn);
+    }
+}
+
+void WALSegment::abort() {
+    /// checkpoints wait for the compensation records like for those of operations
+    Operation operation(this, false);
+    Transaction transaction;
+    {
+        std::lock_guard<std::mutex> guard(log_latch);
+        auto it = transactions.find(std::this_thread::get_id());
+        if (it == transactions.end()) {
+            throw std::logic_error("the thread is not in a transaction");
+        }
+        transaction = it->second;
+    }
+    /// the records are read back from the file
+    flush(transaction.last_lsn);
+    for (uint64_t lsn = transaction.last_lsn; lsn != 0;) {
+        lsn = undo(transaction, lsn);
+    }
+    std::lock_guard<std::mutex> guard(log_latch);
+    if (transaction.last_lsn != 0) {
+        append(kEnd, &transaction, 0, 0, nullptr, 0, nullptr, 0);
+    }
+    transactions.erase(std::this_thread::get_id());
+}
+
+uint64_t WALSegment::undo(Transaction &transaction, uint64_t lsn) {
+    RecordHeader header;
+    file->read_block(lsn - 1, sizeof(RecordHeader), reinterpret_cast<char*>(&header));
+    if (header.type == kCompensation) {
+        /// the change was undone already
+        return header.undo_next_lsn;
+    }
+    if (header.type != kUpdate) {
+        return header.prev_lsn;
+    }
+    std::vector<std::byte> before(header.before_size);
+    file->read_block(lsn - 1 + sizeof(RecordHeader), header.before_size, reinterpret_cast<char*>(before.data()));
+    auto& segment = get_segment(header.page_id);
+    PageGuard page(buffer_manager, header.page_id, true);
+    segment.apply_slot_image(page, header.slot_id, before.data(), header.before_size);
+    uint64_t compensation_lsn;
+    {
+        std::lock_guard<std::mutex> guard(log_latch);
+        compensation_lsn = append(kCompensation, &transaction, header.page_id, header.slot_id, nullptr, 0,
+                                  before.data(), header.before_size, header.prev_lsn);
+        ++statistics.undone_records;
+    }
+    segment.set_page_lsn(page, compensation_lsn);
+    return header.prev_lsn;
+}
+
+uint64_t WALSegment::log_update(uint64_t page_id, uint16_t slot_id, const std::byte *before, uint32_t before_size,
+                                const std::byte *after, uint32_t after_size) {
+    std::lock_guard<std::mutex> guard(log_latch);
+    auto it = transactions.find(std::this_thread::get_id());
+    assert(it != transactions.end());
+    return append(kUpdate, &it->second, page_id, slot_id, before, before_size, after, after_size);
+}
+
+uint64_t WALSegment::log_redo(uint64_t page_id, uint16_t slot_id, const std::byte *after, uint32_t after_size) {
+    std::lock_guard<std::mutex> guard(log_latch);
+    auto it = transactions.find(std::this_thread::get_id());
+    assert(it != transactions.end());
+    /// like a compensation record, it is skipped when the transaction is undone
+    return append(kCompensation, &it->second, page_id, slot_id, nullptr, 0, after, after_size, it->second.last_lsn);
+}
+
+uint64_t WALSegment::log_format(uint64_t page_id) {
+    std::lock_guard<std::mutex> guard(log_latch);
+    return append(kFormat, nullptr, page_id, 0, nullptr, 0, nullptr, 0);
+}
+
+void WALSegment::log_truncate(uint64_t page_id) {
+    uint64_t lsn;
+    {
+        std::lock_guard<std::mutex> guard(log_latch);
+        lsn = append(kTruncate, nullptr, page_id, 0, nullptr, 0, nullptr, 0);
+    }
+    flush(lsn);
+}
+
+uint64_t WALSegment::get_oldest_lsn() const {
+    std::lock_guard<std::mutex> guard(log_latch);
+    uint64_t oldest_lsn = ~0ull;
+    for (auto& [thread, transaction] : transactions) {
+        if (transaction.first_lsn != 0) {
+            oldest_lsn = std::min(oldest_lsn, transaction.first_lsn);
+        }
+    }
+    return oldest_lsn;
+}
+
+uint64_t WALSegment::append(RecordType type, Transaction *transaction, uint64_t page_id, uint16_t slot_id,
+                            const std::byte *before, uint32_t before_size, const std::byte *after,
+                            uint32_t after_size, uint64_t undo_next_lsn) {
+    RecordHeader header{};
+    header.size = sizeof(RecordHeader) + before_size + after_size;
+    header.lsn = buffer_offset + buffer.size() + 1;
+    header.transaction = transaction != nullptr ? transaction->id : 0;
+    header.prev_lsn = transaction != nullptr ? transaction->last_lsn : 0;
+    header.undo_next_lsn = undo_next_lsn;
+    header.page_id = page_id;
+    header.before_size = before_size;
+    header.slot_id = slot_id;
+    header.type = type;
+
+    /// the buffers keep their capacity, so appending rarely allocates
+    size_t offset = buffer.size();
+    buffer.resize(offset + header.size);
+    auto record = &buffer[offset];
+    if (before_size > 0) {
+        std::memcpy(record + sizeof(RecordHeader), before, before_size);
+    }
+    if (after_size > 0) {
+        std::memcpy(record + sizeof(RecordHeader) + before_size, after, after_size);
+    }
+    std::memcpy(record, &header, sizeof(RecordHeader));
+    header.checksum = get_checksum(record + kChecksumEnd, header.size - kChecksumEnd);
+    std::memcpy(record + sizeof(uint32_t), &header.checksum, sizeof(uint32_t));
+    if (transaction != nullptr) {
+        transaction->last_lsn = header.lsn;
+        if (transaction->first_lsn == 0) {
+            transaction->first_lsn = header.lsn;
+        }
+    }
+    return header.lsn;
+}
+
+void WALSegment::flush(uint64_t lsn) {
+    std::unique_lock<std::mutex> guard(log_latch);
+    /// records are appended as a whole, so the log is durable up to a record once it is durable past its offset
+    lsn = std::min(lsn, buffer_offset + buffer.size());
+    while (flushed_offset < lsn) {
+        if (flushing) {
+            flushed.wait(guard);
+            continue;
+        }
+        /// write the records of all waiting threads at once
+        flushing = true;
+        std::swap(buffer, spare);
+        uint64_t offset = buffer_offset;
+        buffer_offset += spare.size();
+        guard.unlock();
+        try {
+            uint64_t end = offset + spare.size();
+            if (end > file->size()) {
+                file->resize((end + kChunkSize - 1) / kChunkSize * kChunkSize);
+            }
+            file->write_block(reinterpret_cast<const char*>(spare.data()), offset, spare.size());
+        } catch (...) {
+            guard.lock();
+            flushing = false;
+            flushed.notify_all();
+            throw;
+        }
+        guard.lock();
+        flushed_offset = offset + spare.size();
+        spare.clear();
+        flushing = false;
+        ++statistics.flushes;
+        flushed.notify_all();
+    }
+}
+
+void WALSegment::checkpoint() {
+    std::lock_guard<std::mutex> checkpoint_guard(checkpoint_latch);
+    /// the changes before the checkpoint are complete, including those of the data that is not logged
+    uint64_t begin_lsn = next_epoch(nullptr);
+    for (auto& [segment_id, segment] : segments) {
+        segment->flush_derived();
+    }
+    std::vector<uint64_t> page_ids;
+    for (auto& [page_id, recovery_lsn] : buffer_manager.get_dirty_page_table()) {
+        if (recovery_lsn < begin_lsn) {
+            page_ids.push_back(page_id);
+        }
+    }
+    buffer_manager.flush_pages(page_ids);
+
+    /// a page that was changed before the table LSN is in the dirty page table or contains the change on disk
+    std::vector<Transaction> active;
+    uint64_t table_lsn = next_epoch(&active);
+    auto dirty_pages = buffer_manager.get_dirty_page_table();
+    std::vector<uint64_t> values{ begin_lsn, table_lsn, 0, active.size() };
+    for (auto& transaction : active) {
+        values.push_back(transaction.id);
+        values.push_back(transaction.last_lsn);
+    }
+    values.push_back(dirty_pages.size());
+    for (auto& [page_id, recovery_lsn] : dirty_pages) {
+        values.push_back(page_id);
+        values.push_back(recovery_lsn);
+    }
+    uint64_t lsn;
+    {
+        std::lock_guard<std::mutex> guard(log_latch);
+        values[2] = next_transaction;
+        lsn = append(kCheckpoint, nullptr, 0, 0, nullptr, 0, reinterpret_cast<const std::byte*>(values.data()),
+                     static_cast<uint32_t>(values.size() * sizeof(uint64_t)));
+        checkpoint_offset = buffer_offset + buffer.size();
+    }
+    flush(lsn);
+    FileHeader file_header{};
+    file_header.checkpoint_lsn = lsn;
+    file_header.checksum = get_checksum(reinterpret_cast<const std::byte*>(&lsn), sizeof(uint64_t));
+    file->write_block(reinterpret_cast<const char*>(&file_header), 0, sizeof(FileHeader));
+    buffer_manager.save_resident_pages();
+
+    std::lock_guard<std::mutex> guard(log_latch);
+    ++statistics.checkpoints;
+}
+
+uint64_t WALSegment::get_checkpoint_distance() const {
+    std::lock_guard<std::mutex> guard(log_latch);
+    return buffer_offset + buffer.size() - checkpoint_offset;
+}
+
+void WALSegment::recover() {
+    /// the last checkpoint tells where to start and which transactions were active then
+    std::unordered_map<uint64_t, Transaction> losers;
+    std::unordered_map<uint64_t, uint64_t> dirty_pages;
+    uint64_t last_transaction = 0;
+    uint64_t begin_offset = kHeaderSize;
+    uint64_t table_lsn = 0;
+    LogReader reader(*file, file->size());
+    RecordHeader header;
+    FileHeader file_header{};
+    if (file->size() >= kHeaderSize) {
+        file->read_block(0, sizeof(FileHeader), reinterpret_cast<char*>(&file_header));
+    }
+    const std::byte *record;
+    if (file_header.checkpoint_lsn != 0 && file_header.checksum == get_checksum(
+            reinterpret_cast<const std::byte*>(&file_header.checkpoint_lsn), sizeof(uint64_t))
+            && (record = reader.read(file_header.checkpoint_lsn - 1, header)) != nullptr
+            && header.type == kCheckpoint) {
+        std::vector<uint64_t> values((header.size - sizeof(RecordHeader)) / sizeof(uint64_t));
+        std::memcpy(values.data(), record + sizeof(RecordHeader), values.size() * sizeof(uint64_t));
+        uint64_t begin_lsn = values[0];
+        table_lsn = values[1];
+        last_transaction = values[2] - 1;
+        size_t position = 4;
+        for (uint64_t i = 0; i < values[3]; ++i, position += 2) {
+            losers[values[position]] = Transaction{ values[position], values[position + 1] };
+        }
+        for (uint64_t i = 0, count = values[position++]; i < count; ++i, position += 2) {
+            dirty_pages[values[position]] = values[position + 1];
+            begin_lsn = std::min(begin_lsn, values[position + 1]);
+        }
+        begin_offset = begin_lsn - 1;
+    }
+
+    /// analysis and redo in one pass: changes are applied to the pages that do not contain them yet, and
+    /// transactions without a commit or end record have to be undone
+    std::unordered_set<uint64_t> pages;
+    uint64_t offset = begin_offset;
+    for (; (record = reader.read(offset, header)) != nullptr; offset += header.size) {
+        ++statistics.scanned_records;
+        if (header.type == kCheckpoint) {
+            continue;
+        }
+        if (header.type == kTruncate) {
+            /// the changes of the page before are dropped with it, a page with its id is formatted again
+            /// (a removal before the table LSN was complete, the page may have been written again since)
+            pages.erase(header.page_id);
+            if (header.lsn >= table_lsn) {
+                get_segment(header.page_id).redo_truncate(BufferManager::get_segment_page_id(header.page_id));
+                ++statistics.redone_records;
+            }
+            continue;
+        }
+        last_transaction = std::max(last_transaction, header.transaction);
+        /// the transactions before the table LSN are known from the checkpoint
+        bool is_analyzed = header.lsn >= table_lsn;
+        if (header.type == kCommit || header.type == kEnd) {
+            if (is_analyzed) {
+                losers.erase(header.transaction);
+            }
+            continue;
+        }
+        if (header.type != kFormat && is_analyzed) {
+            auto& loser = losers[header.transaction];
+            loser.id = header.transaction;
+            loser.last_lsn = header.lsn;
+        }
+        pages.insert(header.page_id);
+        if (!is_analyzed) {
+            auto it = dirty_pages.find(header.page_id);
+            if (it == dirty_pages.end() || header.lsn < it->second) {
+                /// the page was written with the change before the checkpoint
+                continue;
+            }
+        }
+        auto& segment = get_segment(header.page_id);
+        PageGuard page(buffer_manager, header.page_id, true);
+        if (segment.get_page_lsn(page.get_data()) >= header.lsn) {
+            continue;
+        }
+        if (header.type == kFormat) {
+            segment.init_page(page.get_data());
+        } else {
+            uint32_t image_offset = sizeof(RecordHeader) + header.before_size;
+            segment.apply_slot_image(page, header.slot_id, record + image_offset, header.size - image_offset);
+        }
+        segment.set_page_lsn(page, header.lsn);
+        page.mark_dirty();
+        ++statistics.redone_records;
+    }
+
+    /// records behind the end were written partially, they must not be mistaken for new records later
+    file->resize(offset);
+    {
+        std::lock_guard<std::mutex> guard(log_latch);
+        buffer_offset = offset;
+        flushed_offset = offset;
+        next_transaction = last_transaction + 1;
+        checkpoint_offset = begin_offset;
+        recovered = true;
+    }
+
+    /// undo the losers, always the change with the largest LSN first
+    std::vector<std::pair<Transaction, uint64_t>> undo_lsns;
+    for (auto& [id, transaction] : losers) {
+        undo_lsns.emplace_back(transaction, transaction.last_lsn);
+    }
+    while (true) {
+        auto next = std::max_element(undo_lsns.begin(), undo_lsns.end(),
+                                     [](auto &a, auto &b) { return a.second < b.second; });
+        if (next == undo_lsns.end() || next->second == 0) {
+            break;
+        }
+        next->second = undo(next->first, next->second);
+    }
+    {
+        std::lock_guard<std::mutex> guard(log_latch);
+        for (auto& [transaction, lsn] : undo_lsns) {
+            append(kEnd, &transaction, 0, 0, nullptr, 0, nullptr, 0);
+        }
+    }
+    flush(~0ull);
+
+    /// the free-space inventories, zone maps and Bloom filters are not logged, they are rebuilt for the pages
+    for (auto page_id : pages) {
+        get_segment(page_id).recover_page(BufferManager::get_segment_page_id(page_id));
+    }
+    /// so are the forwarded records, which are found by their targets
+    for (auto& [id, segment] : segments) {
+        segment->load_forwards();
+    }
+}
+
+WALSegment::Statistics WALSegment::get_statistics() const {
+    std::lock_guard<std::mutex> guard(log_latch);
+    return statistics;
+}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "moderndbs/segment.h"
+
+using ZoneMapSegment = moderndbs::ZoneMapSegment;
+using Predicate = moderndbs::Predicate;
+using BufferFrame = moderndbs::BufferFrame;
+using Type = moderndbs::schema::Type;
+
+namespace {
+
+/// Entries start with a flag that tells whether the zones of the page are maintained
+constexpr uint64_t kValid = 1;
+
+}  // namespace
+
+ZoneMapSegment::ZoneMapSegment(uint16_t segment_id, BufferManager& buffer_manager, SchemaSegment &schema,
+                               const schema::Table &table)
+    : Segment(segment_id, buffer_manager) {
+    schema.get_segments(&table).zone_map_segment_id = segment_id;
+    for (uint32_t i = 0; i < table.columns.size(); ++i) {
+        auto tclass = table.columns[i].type.tclass;
+        if (tclass == Type::kInteger || tclass == Type::kTimestamp || tclass == Type::kNumeric) {
+            zone_indexes.push_back(static_cast<int32_t>(columns.size()));
+            columns.push_back(i);
+        } else {
+            zone_indexes.push_back(-1);
+        }
+    }
+    entry_size = sizeof(uint64_t) + columns.size() * sizeof(Zone);
+    entries_per_page = buffer_manager.get_page_size() / entry_size;
+}
+
+std::pair<BufferFrame*, size_t> ZoneMapSegment::fix_entry(uint64_t target_page, bool exclusive) {
+    uint64_t page_id = (static_cast<uint64_t>(segment_id) << 48) | (target_page / entries_per_page);
+    auto& page = buffer_manager.fix_page(page_id, exclusive);
+    return { &page, (target_page % entries_per_page) * entry_size };
+}
+
+void ZoneMapSegment::reset(uint64_t target_page) {
+    auto [page, offset] = fix_entry(target_page, true);
+    auto entry = page->get_data() + offset;
+    std::memcpy(entry, &kValid, sizeof(uint64_t));
+    auto zones = reinterpret_cast<Zone*>(entry + sizeof(uint64_t));
+    for (size_t i = 0; i < columns.size(); ++i) {
+        zones[i] = { std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min(), 0, 0 };
+    }
+    buffer_manager.unfix_page(*page, true);
+}
+
+void ZoneMapSegment::add(uint64_t target_page, const int64_t *values, const bool *nulls) {
+    auto [page, offset] = fix_entry(target_page, true);
+    auto entry = page->get_data() + offset;
+    if (*reinterpret_cast<uint64_t*>(entry) != kValid) {
+        /// pages without zones cannot be skipped anyway
+        buffer_manager.unfix_page(*page, false);
+        return;
+    }
+    auto zones = reinterpret_cast<Zone*>(entry + sizeof(uint64_t));
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (nulls[i]) {
+            ++zones[i].null_count;
+            continue;
+        }
+        zones[i].min = std::min(zones[i].min, values[i]);
+        zones[i].max = std::max(zones[i].max, values[i]);
+        ++zones[i].value_count;
+    }
+    buffer_manager.unfix_page(*page, true);
+}
+
+void ZoneMapSegment::remove(uint64_t target_page, const int64_t * /*values*/, const bool *nulls) {
+    auto [page, offset] = fix_entry(target_page, true);
+    auto entry = page->get_data() + offset;
+    if (*reinterpret_cast<uint64_t*>(entry) != kValid) {
+        buffer_manager.unfix_page(*page, false);
+        return;
+    }
+    auto zones = reinterpret_cast<Zone*>(entry + sizeof(uint64_t));
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (nulls[i]) {
+            --zones[i].null_count;
+        } else {
+            --zones[i].value_count;
+        }
+    }
+    buffer_manager.unfix_page(*page, true);
+}
+
+std::pair<bool, ZoneMapSegment::Zone> ZoneMapSegment::get_zone(uint64_t target_page, uint32_t column) {
+    if (column >= zone_indexes.size() || zone_indexes[column] < 0) {
+        return { false, Zone{} };
+    }
+    auto [page, offset] = fix_entry(target_page, false);
+    auto entry = page->get_data() + offset;
+    bool valid = *reinterpret_cast<uint64_t*>(entry) == kValid;
+    Zone zone = reinterpret_cast<Zone*>(entry + sizeof(uint64_t))[zone_indexes[column]];
+    buffer_manager.unfix_page(*page, false);
+    return { valid, zone };
+}
+
+bool ZoneMapSegment::may_match(uint64_t target_page, const std::vector<Predicate> &predicates) {
+    auto [page, offset] = fix_entry(target_page, false);
+    auto entry = page->get_data() + offset;
+    bool result = true;
+    if (*reinterpret_cast<uint64_t*>(entry) == kValid) {
+        auto zones = reinterpret_cast<Zone*>(entry + sizeof(uint64_t));
+        for (const auto& predicate : predicates) {
+            if (predicate.column >= zone_indexes.size() || zone_indexes[predicate.column] < 0) {
+                continue;
+            }
+            const auto& zone = zones[zone_indexes[predicate.column]];
+            /// NULL never satisfies a predicate
+            bool overlaps = zone.value_count > 0;
+            switch (predicate.comparison) {
+                case Predicate::kEqual:
+                    overlaps &= zone.min <= predicate.lower && predicate.lower <= zone.max;
+                    break;
+                case Predicate::kNotEqual:
+                    overlaps &= zone.min != predicate.lower || zone.max != predicate.lower;
+                    break;
+                case Predicate::kLess:          overlaps &= zone.min < predicate.lower; break;
+                case Predicate::kLessEqual:     overlaps &= zone.min <= predicate.lower; break;
+                case Predicate::kGreater:       overlaps &= zone.max > predicate.lower; break;
+                case Predicate::kGreaterEqual:  overlaps &= zone.max >= predicate.lower; break;
+                case Predicate::kBetween:
+                    overlaps &= zone.min <= predicate.upper && predicate.lower <= zone.max;
+                    break;
+            }
+            if (!overlaps) {
+                result = false;
+                break;
+            }
+        }
+    }
+    buffer_manager.unfix_page(*page, false);
+    return result;
+}
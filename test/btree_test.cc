@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "moderndbs/btree.h"
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/error.h"
+#include "moderndbs/record.h"
+#include "moderndbs/slotted_page.h"
+
+using BufferManager = moderndbs::BufferManager;
+using RecordCodec = moderndbs::RecordCodec;
+using TID = moderndbs::TID;
+using Value = moderndbs::Value;
+
+namespace schema = moderndbs::schema;
+
+namespace {
+
+/// A small page size yields deep trees with few keys
+using BTree = moderndbs::BTree<uint64_t, uint64_t, std::less<uint64_t>, 256>;
+
+/// Remove the file of a segment, so that the tree starts empty.
+void remove_segment(uint16_t segment_id) {
+    std::remove(std::to_string(segment_id).c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(BTreeTest, InsertLookup) {
+    remove_segment(151);
+    BufferManager buffer_manager(256, 100);
+    BTree tree(151, buffer_manager);
+    EXPECT_FALSE(tree.lookup(1).has_value());
+
+    EXPECT_TRUE(tree.insert(1, 10));
+    EXPECT_TRUE(tree.insert(3, 30));
+    EXPECT_TRUE(tree.insert(2, 20));
+    EXPECT_FALSE(tree.insert(2, 21));
+    EXPECT_EQ(10, tree.lookup(1));
+    EXPECT_EQ(20, tree.lookup(2));
+    EXPECT_EQ(30, tree.lookup(3));
+    EXPECT_FALSE(tree.lookup(0).has_value());
+    EXPECT_FALSE(tree.lookup(4).has_value());
+}
+
+// NOLINTNEXTLINE
+TEST(BTreeTest, Splits) {
+    remove_segment(152);
+    BufferManager buffer_manager(256, 10);
+    BTree tree(152, buffer_manager);
+    constexpr uint64_t key_count = 10000;
+
+    // Random order splits nodes at every position, ascending order always splits the rightmost node
+    std::vector<uint64_t> keys(key_count);
+    for (uint64_t i = 0; i < key_count; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::shuffle(keys.begin(), keys.begin() + key_count / 2, std::mt19937_64{0});
+    for (auto key : keys) {
+        ASSERT_TRUE(tree.insert(key, key + 1));
+    }
+    for (uint64_t i = 0; i < key_count; ++i) {
+        ASSERT_EQ(2 * i + 1, tree.lookup(2 * i));
+        ASSERT_FALSE(tree.lookup(2 * i + 1).has_value());
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(BTreeTest, Erase) {
+    remove_segment(153);
+    BufferManager buffer_manager(256, 10);
+    BTree tree(153, buffer_manager);
+    EXPECT_FALSE(tree.erase(1));
+    for (uint64_t key = 0; key < 1000; ++key) {
+        ASSERT_TRUE(tree.insert(key, key));
+    }
+    for (uint64_t key = 0; key < 1000; key += 2) {
+        ASSERT_TRUE(tree.erase(key));
+    }
+    EXPECT_FALSE(tree.erase(0));
+    for (uint64_t key = 0; key < 1000; ++key) {
+        ASSERT_EQ(key % 2 == 1, tree.lookup(key).has_value());
+    }
+
+    // Erased keys can be inserted again
+    EXPECT_TRUE(tree.insert(0, 42));
+    EXPECT_EQ(42, tree.lookup(0));
+}
+
+// NOLINTNEXTLINE
+TEST(BTreeTest, Scan) {
+    remove_segment(154);
+    BufferManager buffer_manager(256, 10);
+    BTree tree(154, buffer_manager);
+    for (uint64_t key = 0; key < 2000; key += 2) {
+        ASSERT_TRUE(tree.insert(key, key * 10));
+    }
+
+    std::vector<uint64_t> keys;
+    tree.scan(101, 1500, [&](uint64_t key, uint64_t value) {
+        EXPECT_EQ(key * 10, value);
+        keys.push_back(key);
+        return true;
+    });
+    ASSERT_EQ(700u, keys.size());
+    EXPECT_EQ(102u, keys.front());
+    EXPECT_EQ(1500u, keys.back());
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+
+    // The callback stops the scan
+    keys.clear();
+    tree.scan(0, 2000, [&](uint64_t key, uint64_t) {
+        keys.push_back(key);
+        return keys.size() < 5;
+    });
+    EXPECT_EQ((std::vector<uint64_t>{0, 2, 4, 6, 8}), keys);
+
+    keys.clear();
+    tree.scan(3000, 4000, [&](uint64_t key, uint64_t) {
+        keys.push_back(key);
+        return true;
+    });
+    EXPECT_TRUE(keys.empty());
+}
+
+// NOLINTNEXTLINE
+TEST(BTreeTest, Persistence) {
+    remove_segment(155);
+    {
+        BufferManager buffer_manager(256, 10);
+        BTree tree(155, buffer_manager);
+        for (uint64_t key = 0; key < 1000; ++key) {
+            ASSERT_TRUE(tree.insert(key, key + 7));
+        }
+    }
+    BufferManager buffer_manager(256, 10);
+    BTree tree(155, buffer_manager);
+    for (uint64_t key = 0; key < 1000; ++key) {
+        ASSERT_EQ(key + 7, tree.lookup(key));
+    }
+    EXPECT_TRUE(tree.insert(1000, 1007));
+    EXPECT_EQ(1007, tree.lookup(1000));
+}
+
+// NOLINTNEXTLINE
+TEST(BTreeTest, ConcurrentInserts) {
+    remove_segment(156);
+    BufferManager buffer_manager(256, 100);
+    BTree tree(156, buffer_manager);
+    constexpr uint64_t key_count = 20000;
+    constexpr unsigned thread_count = 8;
+
+    // Every thread inserts its own keys, erases some of them and reads the others' keys
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 engine{t};
+            for (uint64_t key = t; key < key_count; key += thread_count) {
+                ASSERT_TRUE(tree.insert(key, key));
+                if (key % 3 == 0) {
+                    ASSERT_TRUE(tree.erase(key));
+                }
+                auto other = engine() % key_count;
+                auto value = tree.lookup(other);
+                if (value.has_value()) {
+                    ASSERT_EQ(other, *value);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t count = 0;
+    uint64_t previous = 0;
+    tree.scan(0, key_count, [&](uint64_t key, uint64_t) {
+        EXPECT_TRUE(count == 0 || previous < key);
+        EXPECT_NE(0u, key % 3);
+        previous = key;
+        ++count;
+        return true;
+    });
+    EXPECT_EQ(key_count - (key_count + 2) / 3, count);
+}
+
+// NOLINTNEXTLINE
+TEST(BTreeTest, PrimaryKey) {
+    remove_segment(157);
+    schema::Table table("orders", std::vector<schema::Column>{
+        schema::Column("o_value", schema::Type::Integer()),
+        schema::Column("o_region", schema::Type::Char(4)),
+        schema::Column("o_id", schema::Type::Integer()),
+    }, std::vector<std::string>{ "o_region", "o_id" });
+    RecordCodec codec(table);
+    ASSERT_EQ(12u, codec.get_key_size());
+
+    using Key = moderndbs::IndexKey<16>;
+    BufferManager buffer_manager(1024, 10);
+    moderndbs::BTree<Key, TID, std::less<Key>, 1024> index(157, buffer_manager);
+    auto make_key = [&](const std::string &region, int64_t id) {
+        Key key;
+        codec.encode_key(std::vector<Value>{ region, id }, key.bytes.data());
+        return key;
+    };
+
+    // The keys of records and tuples match
+    auto record = codec.encode(std::vector<Value>{ int64_t{7}, std::string("EU"), int64_t{-3} });
+    Key record_key;
+    codec.encode_key(record.data(), record_key.bytes.data());
+    EXPECT_FALSE(record_key < make_key("EU", -3) || make_key("EU", -3) < record_key);
+
+    // Keys are ordered by region first, negative ids come first
+    std::vector<std::pair<std::string, int64_t>> keys;
+    for (const auto *region : { "US", "EU", "EUR", "ASIA" }) {
+        for (int64_t id = -100; id < 100; id += 7) {
+            keys.emplace_back(region, id);
+        }
+    }
+    for (uint64_t i = 0; i < keys.size(); ++i) {
+        ASSERT_TRUE(index.insert(make_key(keys[i].first, keys[i].second), TID(i, 0)));
+    }
+    for (uint64_t i = 0; i < keys.size(); ++i) {
+        auto tid = index.lookup(make_key(keys[i].first, keys[i].second));
+        ASSERT_TRUE(tid.has_value());
+        EXPECT_EQ(TID(i, 0).value, tid->value);
+    }
+    EXPECT_FALSE(index.lookup(make_key("EU", 0)).has_value());
+
+    std::vector<std::pair<std::string, int64_t>> scanned;
+    auto lower = make_key("EU", std::numeric_limits<int64_t>::min());
+    auto upper = make_key("EUR", std::numeric_limits<int64_t>::max());
+    index.scan(lower, upper, [&](const Key&, const TID &tid) {
+        scanned.push_back(keys[tid.get_page()]);
+        return true;
+    });
+    std::vector<std::pair<std::string, int64_t>> expected;
+    std::copy_if(keys.begin(), keys.end(), std::back_inserter(expected),
+                 [](const auto &key) { return key.first == "EU" || key.first == "EUR"; });
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, scanned);
+
+    // NULL keys cannot be indexed
+    Key null_key;
+    EXPECT_THROW(codec.encode_key(std::vector<Value>{ std::string("EU"), std::monostate{} }, null_key.bytes.data()),
+                 moderndbs::RecordCodecError);
+}
+
+}  // namespace
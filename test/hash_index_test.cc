@@ -0,0 +1,204 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "moderndbs/buffer_manager.h"
+#include "moderndbs/hash_index.h"
+#include "moderndbs/record.h"
+#include "moderndbs/slotted_page.h"
+
+using BufferManager = moderndbs::BufferManager;
+using RecordCodec = moderndbs::RecordCodec;
+using TID = moderndbs::TID;
+using Value = moderndbs::Value;
+
+namespace schema = moderndbs::schema;
+
+namespace {
+
+/// Small buckets split often, std::hash is the identity for integers
+using HashIndex = moderndbs::HashIndex<uint64_t, uint64_t, std::hash<uint64_t>, 512>;
+
+/// Remove the file of a segment, so that the index starts empty.
+void remove_segment(uint16_t segment_id) {
+    std::remove(std::to_string(segment_id).c_str());
+}
+
+// NOLINTNEXTLINE
+TEST(HashIndexTest, InsertLookupErase) {
+    remove_segment(160);
+    BufferManager buffer_manager(512, 100);
+    HashIndex index(160, buffer_manager);
+    EXPECT_FALSE(index.lookup(1).has_value());
+    EXPECT_FALSE(index.erase(1));
+
+    EXPECT_TRUE(index.insert(1, 10));
+    EXPECT_TRUE(index.insert(2, 20));
+    EXPECT_FALSE(index.insert(2, 21));
+    EXPECT_EQ(10, index.lookup(1));
+    EXPECT_EQ(20, index.lookup(2));
+    EXPECT_FALSE(index.lookup(3).has_value());
+
+    EXPECT_TRUE(index.erase(1));
+    EXPECT_FALSE(index.erase(1));
+    EXPECT_FALSE(index.lookup(1).has_value());
+    EXPECT_EQ(20, index.lookup(2));
+    EXPECT_TRUE(index.insert(1, 11));
+    EXPECT_EQ(11, index.lookup(1));
+}
+
+// NOLINTNEXTLINE
+TEST(HashIndexTest, GrowDirectory) {
+    remove_segment(161);
+    BufferManager buffer_manager(512, 10);
+    HashIndex index(161, buffer_manager);
+    constexpr uint64_t key_count = 10000;
+
+    // The directory spans several pages
+    for (uint64_t key = 0; key < key_count; ++key) {
+        ASSERT_TRUE(index.insert(key * 3, key));
+    }
+    for (uint64_t key = 0; key < 3 * key_count; ++key) {
+        auto value = index.lookup(key);
+        ASSERT_EQ(key % 3 == 0, value.has_value());
+        if (value.has_value()) {
+            ASSERT_EQ(key / 3, *value);
+        }
+    }
+    for (uint64_t key = 0; key < key_count; key += 2) {
+        ASSERT_TRUE(index.erase(key * 3));
+    }
+    for (uint64_t key = 0; key < key_count; ++key) {
+        ASSERT_EQ(key % 2 == 1, index.lookup(key * 3).has_value());
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(HashIndexTest, DirectoryFull) {
+    remove_segment(162);
+    BufferManager buffer_manager(256, 10);
+    moderndbs::HashIndex<uint64_t, uint64_t, std::hash<uint64_t>, 256> index(162, buffer_manager);
+
+    // 30 directory pages with 32 entries each hold at most 512 buckets with 15 entries each
+    uint64_t key = 0;
+    EXPECT_THROW({
+        for (; key < 1000000; ++key) {
+            index.insert(key, key);
+        }
+    }, std::length_error);
+
+    // The index can still be used
+    EXPECT_EQ(0, index.lookup(0));
+    EXPECT_EQ(key - 1, index.lookup(key - 1));
+    EXPECT_FALSE(index.lookup(key).has_value());
+}
+
+// NOLINTNEXTLINE
+TEST(HashIndexTest, Persistence) {
+    remove_segment(163);
+    {
+        BufferManager buffer_manager(512, 10);
+        HashIndex index(163, buffer_manager);
+        for (uint64_t key = 0; key < 5000; ++key) {
+            ASSERT_TRUE(index.insert(key, key + 7));
+        }
+    }
+    BufferManager buffer_manager(512, 10);
+    HashIndex index(163, buffer_manager);
+    for (uint64_t key = 0; key < 5000; ++key) {
+        ASSERT_EQ(key + 7, index.lookup(key));
+    }
+    EXPECT_TRUE(index.insert(5000, 5007));
+    EXPECT_EQ(5007, index.lookup(5000));
+}
+
+// NOLINTNEXTLINE
+TEST(HashIndexTest, ConcurrentInserts) {
+    remove_segment(164);
+    BufferManager buffer_manager(512, 100);
+    HashIndex index(164, buffer_manager);
+    constexpr uint64_t key_count = 20000;
+    constexpr unsigned thread_count = 8;
+
+    // Every thread inserts its own keys, erases some of them and reads the others' keys
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 engine{t};
+            for (uint64_t key = t; key < key_count; key += thread_count) {
+                ASSERT_TRUE(index.insert(key, key));
+                if (key % 3 == 0) {
+                    ASSERT_TRUE(index.erase(key));
+                }
+                auto other = engine() % key_count;
+                auto value = index.lookup(other);
+                if (value.has_value()) {
+                    ASSERT_EQ(other, *value);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (uint64_t key = 0; key < key_count; ++key) {
+        ASSERT_EQ(key % 3 != 0, index.lookup(key).has_value());
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(HashIndexTest, PrimaryKey) {
+    remove_segment(165);
+    schema::Table table("customer", std::vector<schema::Column>{
+        schema::Column("c_name", schema::Type::Varchar(16)),
+        schema::Column("c_id", schema::Type::Integer()),
+    }, std::vector<std::string>{ "c_name" });
+    RecordCodec codec(table);
+
+    using Key = moderndbs::IndexKey<16>;
+    BufferManager buffer_manager(1024, 10);
+    moderndbs::HashIndex<Key, TID, Key::Hash, 1024> index(165, buffer_manager);
+    auto make_key = [&](const std::string &name) {
+        Key key;
+        codec.encode_key(std::vector<Value>{ name }, key.bytes.data());
+        return key;
+    };
+    for (uint64_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(index.insert(make_key("customer" + std::to_string(i)), TID(i, 1)));
+    }
+    EXPECT_FALSE(index.insert(make_key("customer7"), TID(0, 0)));
+    for (uint64_t i = 0; i < 1000; ++i) {
+        auto tid = index.lookup(make_key("customer" + std::to_string(i)));
+        ASSERT_TRUE(tid.has_value());
+        EXPECT_EQ(TID(i, 1).value, tid->value);
+    }
+    EXPECT_FALSE(index.lookup(make_key("customer")).has_value());
+}
+
+
+/// Exposes the hash function of an index over encoded keys.
+struct KeyHashIndex : moderndbs::HashIndex<moderndbs::IndexKey<16>, TID, moderndbs::IndexKey<16>::Hash, 1024> {
+    using HashIndex::get_hash;
+};
+
+// NOLINTNEXTLINE
+TEST(HashIndexTest, PortableHash) {
+    // The hash values decide the bucket and the fingerprint of a key on disk, so they must never change.
+    auto hash = [](const std::string &bytes) {
+        moderndbs::IndexKey<16> key;
+        std::memcpy(key.bytes.data(), bytes.data(), bytes.size());
+        return KeyHashIndex::get_hash(key);
+    };
+    EXPECT_EQ(0x180301564b43715full, hash(""));
+    EXPECT_EQ(0xd499f2772f6bfcd8ull, hash("customer7"));
+    EXPECT_EQ(0x712f51ce83dc0928ull, hash("0123456789abcdef"));
+}
+
+}  // namespace
@@ -7,6 +7,10 @@
 # ---------------------------------------------------------------------------
 
 set(TEST_CC
+    test/btree_test.cc
+    test/hash_index_test.cc
+    test/predicate_test.cc
+    test/record_test.cc
     test/segment_test.cc
 )
 
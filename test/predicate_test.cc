@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "moderndbs/predicate.h"
+
+using Predicate = moderndbs::Predicate;
+
+namespace simd = moderndbs::simd;
+
+namespace {
+
+// NOLINTNEXTLINE
+TEST(PredicateTest, KernelsMatchScalar) {
+    std::mt19937_64 engine(42);
+    std::uniform_int_distribution<int64_t> distribution(-100, 100);
+    for (uint32_t count : { 0u, 1u, 63u, 64u, 65u, 200u, 1000u }) {
+        std::vector<int64_t> values(count);
+        for (auto& value : values) {
+            value = distribution(engine);
+        }
+        for (auto comparison : { Predicate::kEqual, Predicate::kNotEqual, Predicate::kLess, Predicate::kLessEqual,
+                                 Predicate::kGreater, Predicate::kGreaterEqual, Predicate::kBetween }) {
+            std::vector<uint64_t> expected((count + 63) / 64, ~0ull);
+            std::vector<uint64_t> mask((count + 63) / 64, ~0ull);
+            simd::filter_int64_scalar(values.data(), count, comparison, -10, 20, expected.data());
+            simd::filter_int64(values.data(), count, comparison, -10, 20, mask.data());
+            EXPECT_EQ(expected, mask) << simd::get_kernel_name() << " comparison " << static_cast<int>(comparison);
+        }
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(PredicateTest, Between) {
+    std::vector<int64_t> values { 5, 10, 15, 20, 25, -5 };
+    std::vector<uint64_t> mask { ~0ull };
+    simd::filter_int64(values.data(), values.size(), Predicate::kBetween, 10, 20, mask.data());
+    std::vector<uint16_t> selection(values.size());
+    ASSERT_EQ(3, simd::to_selection_vector(mask.data(), values.size(), selection.data()));
+    EXPECT_EQ(1, selection[0]);
+    EXPECT_EQ(2, selection[1]);
+    EXPECT_EQ(3, selection[2]);
+}
+
+// NOLINTNEXTLINE
+TEST(PredicateTest, Char) {
+    const char values[] = "ab\0\0abc\0ab\0\0xyz\0";
+    const char constant[] = "ab\0\0";
+    std::vector<uint64_t> mask { ~0ull };
+    simd::filter_char(reinterpret_cast<const std::byte*>(values), 4, 4,
+                      reinterpret_cast<const std::byte*>(constant), true, mask.data());
+    EXPECT_EQ(0x5, mask[0]);
+    mask[0] = ~0ull;
+    simd::filter_char(reinterpret_cast<const std::byte*>(values), 4, 4,
+                      reinterpret_cast<const std::byte*>(constant), false, mask.data());
+    EXPECT_EQ(0xA, mask[0]);
+}
+
+}  // namespace
@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "moderndbs/error.h"
+#include "moderndbs/record.h"
+#include "moderndbs/schema.h"
+
+using RecordCodec = moderndbs::RecordCodec;
+using Value = moderndbs::Value;
+
+namespace schema = moderndbs::schema;
+
+namespace {
+
+schema::Table getCustomerTable() {
+    return schema::Table(
+        "customer",
+        {
+            schema::Column("c_custkey", schema::Type::Integer()),
+            schema::Column("c_name", schema::Type::Varchar(25)),
+            schema::Column("c_address", schema::Type::Varchar(40)),
+            schema::Column("c_nationkey", schema::Type::Integer()),
+            schema::Column("c_phone", schema::Type::Char(15)),
+            schema::Column("c_acctbal", schema::Type::Numeric(12, 2)),
+        },
+        {
+            "c_custkey"
+        }
+    );
+}
+
+// NOLINTNEXTLINE
+TEST(RecordTest, Layout) {
+    auto table = getCustomerTable();
+    RecordCodec codec(table);
+    EXPECT_EQ(6, codec.get_column_count());
+    EXPECT_EQ(1, codec.get_null_bytes());
+    EXPECT_EQ(2, codec.get_varchar_count());
+    EXPECT_FALSE(codec.is_fixed_width());
+    // null bitmap, 3 x 8 byte integers and a char(15)
+    EXPECT_EQ(1 + 3 * 8 + 15, codec.get_fixed_size());
+    EXPECT_EQ(1, codec.get_column(0).offset);
+    EXPECT_EQ(9, codec.get_column(3).offset);
+    EXPECT_EQ(17, codec.get_column(4).offset);
+    EXPECT_EQ(32, codec.get_column(5).offset);
+    EXPECT_EQ(1, codec.get_column(2).var_index);
+    EXPECT_EQ(codec.get_fixed_size() + 2 * 2 + 25 + 40, codec.get_max_size());
+    EXPECT_EQ(3, codec.find_column("c_nationkey"));
+    EXPECT_EQ(6, codec.find_column("c_comment"));
+}
+
+// NOLINTNEXTLINE
+TEST(RecordTest, EncodeDecode) {
+    auto table = getCustomerTable();
+    RecordCodec codec(table);
+    std::vector<Value> tuple {
+        int64_t{42}, std::string("Customer#42"), std::string(), int64_t{-7}, std::string("25-989-741-2988"), int64_t{71156}
+    };
+    auto record = codec.encode(tuple);
+    EXPECT_EQ(codec.get_fixed_size() + 2 * 2 + 11, record.size());
+    EXPECT_EQ(record.size(), codec.get_record_size(record.data()));
+    EXPECT_EQ(tuple, codec.decode(record.data()));
+
+    EXPECT_EQ(42, codec.get<schema::Type::kInteger>(record.data(), 0));
+    EXPECT_EQ("Customer#42", codec.get<schema::Type::kVarchar>(record.data(), 1));
+    EXPECT_EQ("", codec.get<schema::Type::kVarchar>(record.data(), 2));
+    EXPECT_EQ(-7, codec.get<schema::Type::kInteger>(record.data(), 3));
+    EXPECT_EQ("25-989-741-2988", codec.get<schema::Type::kChar>(record.data(), 4));
+    EXPECT_EQ(71156, codec.get<schema::Type::kNumeric>(record.data(), 5));
+}
+
+// NOLINTNEXTLINE
+TEST(RecordTest, Nulls) {
+    auto table = getCustomerTable();
+    RecordCodec codec(table);
+    std::vector<Value> tuple {
+        int64_t{1}, std::monostate{}, std::string("Street 1"), std::monostate{}, std::string("123"), int64_t{0}
+    };
+    auto record = codec.encode(tuple);
+    EXPECT_FALSE(codec.is_null(record.data(), 0));
+    EXPECT_TRUE(codec.is_null(record.data(), 1));
+    EXPECT_TRUE(codec.is_null(record.data(), 3));
+    EXPECT_EQ("Street 1", codec.get<schema::Type::kVarchar>(record.data(), 2));
+    EXPECT_EQ(tuple, codec.decode(record.data()));
+}
+
+// NOLINTNEXTLINE
+TEST(RecordTest, InvalidTuples) {
+    auto table = getCustomerTable();
+    RecordCodec codec(table);
+    std::vector<Value> too_short { int64_t{1} };
+    EXPECT_THROW(codec.encode(too_short), moderndbs::RecordCodecError);
+    std::vector<Value> wrong_type {
+        std::string("1"), std::string(), std::string(), int64_t{0}, std::string(), int64_t{0}
+    };
+    EXPECT_THROW(codec.encode(wrong_type), moderndbs::RecordCodecError);
+    std::vector<Value> too_long {
+        int64_t{1}, std::string(26, 'x'), std::string(), int64_t{0}, std::string(), int64_t{0}
+    };
+    EXPECT_THROW(codec.encode(too_long), moderndbs::RecordCodecError);
+}
+
+// NOLINTNEXTLINE
+TEST(RecordTest, KeysOfShortRecords) {
+    auto table = getCustomerTable();
+    std::vector<Value> tuple {
+        int64_t{7}, std::string("Customer#7"), std::string(), int64_t{0}, std::string("123"), int64_t{0}
+    };
+    for (const char *key_column : { "c_custkey", "c_name" }) {
+        RecordCodec codec(schema::Table(table.id, table.columns, { key_column }));
+        auto record = codec.encode(tuple);
+        auto size = static_cast<uint32_t>(record.size());
+        std::vector<std::byte> expected(codec.get_key_size());
+        std::vector<std::byte> key(codec.get_key_size());
+        codec.encode_key(record.data(), expected.data());
+        ASSERT_TRUE(codec.try_encode_key(record.data(), size, key.data()));
+        EXPECT_EQ(expected, key);
+
+        // The key column is missing
+        EXPECT_FALSE(codec.try_encode_key(record.data(), 0, key.data()));
+        EXPECT_FALSE(codec.try_encode_key(record.data(), codec.get_null_bytes() + 4, key.data()));
+        if (key_column == std::string("c_name")) {
+            EXPECT_FALSE(codec.try_encode_key(record.data(), size - 1, key.data()));
+        }
+
+        // The key column is NULL
+        record[0] = std::byte{0xFF};
+        EXPECT_FALSE(codec.try_encode_key(record.data(), size, key.data()));
+    }
+}
+
+}  // namespace
@@ -1,20 +1,41 @@
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <exception>
 #include <utility>
 #include <random>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
+#include "moderndbs/checkpointer.h"
+#include "moderndbs/error.h"
 #include "moderndbs/segment.h"
 #include "moderndbs/file.h"
 #include "moderndbs/buffer_manager.h"
+#include "moderndbs/record.h"
+#include "moderndbs/vacuum.h"
 
+using BloomFilterSegment = moderndbs::BloomFilterSegment;
 using BufferManager = moderndbs::BufferManager;
+using Checkpointer = moderndbs::Checkpointer;
 using FSISegment = moderndbs::FSISegment;
 using SPSegment = moderndbs::SPSegment;
+using SlottedPage = moderndbs::SlottedPage;
 using SchemaSegment = moderndbs::SchemaSegment;
+using RecordCodec = moderndbs::RecordCodec;
+using TID = moderndbs::TID;
+using WALSegment = moderndbs::WALSegment;
+using ZoneMapSegment = moderndbs::ZoneMapSegment;
+using Value = moderndbs::Value;
 
 namespace schema = moderndbs::schema;
 
@@ -162,6 +183,278 @@ TEST(SegmentTest, SchemaSerialiseTPCHLight) {
     EXPECT_EQ(schema_2->tables[2].primary_key[0], "r_regionkey");
 }
 
+// NOLINTNEXTLINE
+TEST(SegmentTest, SchemaCatalogHeader) {
+    std::remove("143");
+    {
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment_1(143, buffer_manager);
+        schema_segment_1.set_schema(getTPCHSchemaLight());
+        schema_segment_1.set_sp_segment(144);
+        schema_segment_1.set_fsi_segment(145);
+        schema_segment_1.write();
+        // Allocating slotted pages only changes the header in memory
+        schema_segment_1.increase_sp_count();
+        schema_segment_1.increase_sp_count();
+    }
+    {
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment_2(143, buffer_manager);
+        schema_segment_2.read();
+        EXPECT_EQ(144, schema_segment_2.get_sp_segment());
+        EXPECT_EQ(145, schema_segment_2.get_fsi_segment());
+        EXPECT_EQ(2, schema_segment_2.get_sp_count());
+        ASSERT_EQ(3, schema_segment_2.get_schema()->tables.size());
+    }
+
+    // A catalog of an unknown version is rejected
+    {
+        auto file = moderndbs::File::open_file("143", moderndbs::File::WRITE);
+        uint32_t version = 99;
+        file->write_block(reinterpret_cast<const char*>(&version), sizeof(uint32_t), sizeof(uint32_t));
+    }
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment_3(143, buffer_manager);
+    EXPECT_THROW(schema_segment_3.read(), moderndbs::SchemaParseError);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SchemaTableSegments) {
+    for (auto segment_id : { 146, 147, 148, 149, 150 }) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    {
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment(146, buffer_manager);
+        schema_segment.set_schema(getTPCHSchemaLight());
+        auto& customer = schema_segment.get_schema()->tables[0];
+        auto& nation = schema_segment.get_schema()->tables[1];
+        FSISegment customer_fsi(147, buffer_manager, schema_segment, FSISegment::kNextFit, FSISegment::kLinear,
+                                &customer);
+        SPSegment customer_sp(148, buffer_manager, schema_segment, customer_fsi, &customer);
+        FSISegment nation_fsi(149, buffer_manager, schema_segment, FSISegment::kNextFit, FSISegment::kLinear, &nation);
+        SPSegment nation_sp(150, buffer_manager, schema_segment, nation_fsi, &nation);
+
+        // Every table has its own slotted pages
+        for (int i = 0; i < 10; ++i) {
+            customer_sp.allocate(900);
+        }
+        auto tid = nation_sp.allocate(100);
+        EXPECT_EQ(0, tid.get_page());
+        EXPECT_EQ(10, schema_segment.get_segments(&customer).sp_count);
+        EXPECT_EQ(1, schema_segment.get_segments(&nation).sp_count);
+        EXPECT_EQ(0, schema_segment.get_sp_count());
+        schema_segment.write();
+    }
+
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(146, buffer_manager);
+    schema_segment.read();
+    EXPECT_EQ(1, schema_segment.find_table("nation"));
+    EXPECT_EQ(SchemaSegment::kNotFound, schema_segment.find_table("lineitem"));
+    EXPECT_EQ(5, schema_segment.find_column(0, "c_acctbal"));
+    EXPECT_EQ(SchemaSegment::kNotFound, schema_segment.find_column(0, "n_name"));
+    EXPECT_EQ(8, schema_segment.get_codec(0).get_column_count());
+
+    auto& customer = schema_segment.get_schema()->tables[0];
+    EXPECT_EQ(148, schema_segment.get_segments(&customer).sp_segment_id);
+    EXPECT_EQ(147, schema_segment.get_segments(&customer).fsi_segment_id);
+    EXPECT_EQ(10, schema_segment.get_segments(&customer).sp_count);
+    EXPECT_EQ(1, schema_segment.get_segments(&schema_segment.get_schema()->tables[1]).sp_count);
+
+    // Tables keep their segments when the schema changes
+    std::vector<schema::Table> tables;
+    tables.emplace_back("region", std::vector<schema::Column>{ schema::Column("r_regionkey") },
+                        std::vector<std::string>{ "r_regionkey" });
+    tables.emplace_back("customer", std::vector<schema::Column>{ schema::Column("c_custkey") },
+                        std::vector<std::string>{ "c_custkey" });
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::move(tables)));
+    EXPECT_EQ(1, schema_segment.find_table("customer"));
+    EXPECT_EQ(10, schema_segment.get_segments(&schema_segment.get_schema()->tables[1]).sp_count);
+    EXPECT_EQ(0, schema_segment.get_segments(&schema_segment.get_schema()->tables[0]).sp_count);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, FSIFind) {
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(130, buffer_manager);
+    FSISegment fsi_segment(131, buffer_manager, schema_segment);
+    EXPECT_FALSE(fsi_segment.find(0).first);
+
+    // 10000 full pages span several leaf pages
+    for (uint64_t page = 0; page < 10000; ++page) {
+        schema_segment.increase_sp_count();
+        fsi_segment.update(page, 0);
+    }
+    EXPECT_EQ(0, fsi_segment.find(0).second);
+    EXPECT_FALSE(fsi_segment.find(1).first);
+
+    fsi_segment.update(9000, 300);
+    fsi_segment.update(7000, 600);
+    EXPECT_EQ(7000, fsi_segment.find(200).second);
+    EXPECT_EQ(7000, fsi_segment.find(500).second);
+    EXPECT_FALSE(fsi_segment.find(700).first);
+
+    // Pages are only reused if they are guaranteed to have enough space
+    fsi_segment.update(7000, 0);
+    EXPECT_EQ(9000, fsi_segment.find(192).second);
+    EXPECT_FALSE(fsi_segment.find(300).first);
+
+    // Pages are added on demand
+    while (schema_segment.get_sp_count() <= 300000) {
+        schema_segment.increase_sp_count();
+    }
+    fsi_segment.update(300000, 1000);
+    EXPECT_EQ(300000, fsi_segment.find(900).second);
+
+    // The search continues at the page that was found last and wraps around
+    EXPECT_EQ(300000, fsi_segment.find(64).second);
+    fsi_segment.update(300000, 0);
+    EXPECT_EQ(9000, fsi_segment.find(64).second);
+    fsi_segment.update(5000, 300);
+    EXPECT_EQ(9000, fsi_segment.find(64).second);
+    fsi_segment.update(9000, 0);
+    EXPECT_EQ(5000, fsi_segment.find(64).second);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, FSIPolicies) {
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(138, buffer_manager);
+    FSISegment first_fit(139, buffer_manager, schema_segment, FSISegment::kFirstFit);
+    FSISegment best_fit(140, buffer_manager, schema_segment, FSISegment::kBestFit, FSISegment::kLogarithmic);
+    for (uint64_t page = 0; page < 5000; ++page) {
+        schema_segment.increase_sp_count();
+        first_fit.update(page, 0);
+        best_fit.update(page, 0);
+    }
+    for (auto [page, free_space] : { std::pair{ 100u, 900u }, std::pair{ 2000u, 40u }, std::pair{ 4000u, 100u } }) {
+        first_fit.update(page, free_space);
+        best_fit.update(page, free_space);
+    }
+
+    // First fit always starts at the first page
+    EXPECT_EQ(100, first_fit.find(30).second);
+    EXPECT_EQ(100, first_fit.find(30).second);
+    // Linear classes cannot tell 40 bytes from 0
+    EXPECT_EQ(100, first_fit.find(10).second);
+
+    // Best fit takes the page with the smallest class that suffices
+    EXPECT_EQ(2000, best_fit.find(30).second);
+    EXPECT_EQ(4000, best_fit.find(80).second);
+    EXPECT_EQ(100, best_fit.find(500).second);
+    EXPECT_FALSE(best_fit.find(950).first);
+
+    // Logarithmic classes are finer for small amounts of free space
+    best_fit.update(2000, 5);
+    best_fit.update(4000, 8);
+    EXPECT_EQ(4000, best_fit.find(6).second);
+    EXPECT_EQ(4000, best_fit.find(8).second);
+    EXPECT_EQ(100, best_fit.find(9).second);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, FSIConcurrentUpdates) {
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(141, buffer_manager);
+    FSISegment fsi_segment(142, buffer_manager, schema_segment, FSISegment::kFirstFit);
+    constexpr uint64_t page_count = 5000;
+    constexpr unsigned thread_count = 8;
+    for (uint64_t page = 0; page < page_count; ++page) {
+        schema_segment.increase_sp_count();
+    }
+
+    // Neighbouring pages share their words, so the threads update the same words all the time
+    std::vector<uint32_t> free_space(page_count, 0);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 engine{t};
+            for (int round = 0; round < 4; ++round) {
+                for (uint64_t page = t; page < page_count; page += thread_count) {
+                    free_space[page] = static_cast<uint32_t>(engine() % 16) * 64;
+                    fsi_segment.update(page, free_space[page]);
+                }
+                fsi_segment.find(512);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (uint32_t required = 64; required < 1024; required += 64) {
+        auto expected = std::find_if(free_space.begin(), free_space.end(), [&](uint32_t f) { return f >= required; });
+        auto [found, page] = fsi_segment.find(required);
+        ASSERT_EQ(expected != free_space.end(), found);
+        if (found) {
+            EXPECT_EQ(static_cast<uint64_t>(expected - free_space.begin()), page);
+        }
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPInsertPages) {
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(135, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+    FSISegment fsi_segment(136, buffer_manager, schema_segment);
+    SPSegment sp_segment(137, buffer_manager, schema_segment, fsi_segment);
+
+    auto first = sp_segment.allocate(300);
+    EXPECT_EQ(0, first.get_page());
+
+    // Another thread keeps inserting into its own page although the first page has more space
+    std::thread thread([&] {
+        auto large = sp_segment.allocate(800);
+        EXPECT_EQ(1, large.get_page());
+        auto small = sp_segment.allocate(50);
+        EXPECT_EQ(1, small.get_page());
+        // Once the page is full, the thread falls back to the free-space inventory
+        auto fallback = sp_segment.allocate(150);
+        EXPECT_EQ(0, fallback.get_page());
+    });
+    thread.join();
+
+    EXPECT_EQ(0, sp_segment.allocate(100).get_page());
+    EXPECT_EQ(2, schema_segment.get_sp_count());
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, FSIPersistence) {
+    for (auto segment_id : { 132, 133, 134 }) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    uint64_t page_count;
+    {
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment(132, buffer_manager);
+        schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+        FSISegment fsi_segment(133, buffer_manager, schema_segment);
+        SPSegment sp_segment(134, buffer_manager, schema_segment, fsi_segment);
+        // Fill 40 pages, leave room on the 20th
+        for (int i = 0; i < 40; ++i) {
+            auto tid = sp_segment.allocate(900);
+            if (i == 20) {
+                sp_segment.resize(tid, 100);
+            }
+        }
+        page_count = schema_segment.get_sp_count();
+        EXPECT_EQ(40, page_count);
+    }
+
+    // The free-space inventory survives a restart
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(132, buffer_manager);
+    schema_segment.read();
+    FSISegment fsi_segment(133, buffer_manager, schema_segment);
+    SPSegment sp_segment(134, buffer_manager, schema_segment, fsi_segment);
+    EXPECT_EQ(page_count, schema_segment.get_sp_count());
+    auto tid = sp_segment.allocate(500);
+    EXPECT_EQ(20, tid.get_page());
+    EXPECT_EQ(page_count, schema_segment.get_sp_count());
+}
+
 // NOLINTNEXTLINE
 TEST(SegmentTest, SPRecordSingleAllocations) {
     auto schema = getTPCHSchemaLight();
@@ -282,4 +575,1304 @@ TEST(SegmentTest, SPRecordResizeFirstRedirect) {
     ASSERT_TRUE(buffer3_equals);
 }
 
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPRecordErase) {
+    auto schema = getTPCHSchemaLight();
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(117, buffer_manager);
+    schema_segment.set_schema(std::move(schema));
+    FSISegment fsi_segment(118, buffer_manager, schema_segment);
+    SPSegment sp_segment(119, buffer_manager, schema_segment, fsi_segment);
+
+    // Fill a page, erase every record and fill it again
+    std::vector<TID> tids;
+    for (int i = 0; i < 20; ++i) {
+        tids.push_back(sp_segment.allocate(42));
+    }
+    auto sp_count = schema_segment.get_sp_count();
+    for (auto tid : tids) {
+        sp_segment.erase(tid);
+    }
+    for (int i = 0; i < 20; ++i) {
+        auto tid = sp_segment.allocate(42);
+        std::vector<char> buffer(42, static_cast<char>(i));
+        sp_segment.write(tid, reinterpret_cast<std::byte*>(buffer.data()), 42);
+        std::vector<char> buffer2(42, 0x00);
+        EXPECT_EQ(42, sp_segment.read(tid, reinterpret_cast<std::byte*>(buffer2.data()), 42));
+        EXPECT_EQ(buffer, buffer2);
+    }
+    EXPECT_EQ(sp_count, schema_segment.get_sp_count());
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, PAXRecords) {
+    std::vector<schema::Table> tables {
+        schema::Table(
+            "events",
+            {
+                schema::Column("e_id", schema::Type::Integer()),
+                schema::Column("e_time", schema::Type::Timestamp()),
+                schema::Column("e_kind", schema::Type::Char(4)),
+                schema::Column("e_payload", schema::Type::Varchar(64)),
+            },
+            { "e_id" },
+            schema::Table::kPAX
+        ),
+    };
+    auto schema = std::make_unique<schema::Schema>(std::move(tables));
+    auto& table = schema->tables[0];
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(120, buffer_manager);
+    schema_segment.set_schema(std::move(schema));
+    FSISegment fsi_segment(121, buffer_manager, schema_segment);
+    SPSegment sp_segment(122, buffer_manager, schema_segment, fsi_segment, &table);
+    ASSERT_EQ(SPSegment::kPAX, sp_segment.get_page_format());
+    const RecordCodec& codec = *sp_segment.get_codec();
+
+    // Insert tuples
+    std::vector<std::pair<TID, std::vector<Value>>> records;
+    for (int64_t i = 0; i < 100; ++i) {
+        std::vector<Value> tuple { i, 1000 + i, std::string("k") + std::to_string(i % 10), std::string(i % 20, 'x') };
+        auto record = codec.encode(tuple);
+        auto tid = sp_segment.allocate(record.size());
+        sp_segment.write(tid, record.data(), record.size());
+        records.emplace_back(tid, tuple);
+    }
+    EXPECT_LT(1, schema_segment.get_sp_count());
+
+    // Grow a record until it has to be moved to another page
+    std::vector<Value> grown { int64_t{7}, int64_t{1007}, std::string("k7"), std::string(64, 'y') };
+    auto grown_record = codec.encode(grown);
+    sp_segment.resize(records[7].first, grown_record.size());
+    sp_segment.write(records[7].first, grown_record.data(), grown_record.size());
+    records[7].second = grown;
+
+    // Erase a record
+    sp_segment.erase(records[3].first);
+    records.erase(records.begin() + 3);
+
+    std::vector<std::byte> buffer(codec.get_max_size());
+    for (auto& [tid, tuple] : records) {
+        auto size = sp_segment.read(tid, buffer.data(), buffer.size());
+        EXPECT_EQ(codec.get_encoded_size(tuple), size);
+        EXPECT_EQ(tuple, codec.decode(buffer.data()));
+    }
+
+    // Scan a single column
+    int64_t sum = 0;
+    uint64_t count = 0;
+    sp_segment.scan_column(1, [&](TID, const std::byte* value) {
+        ASSERT_NE(nullptr, value);
+        int64_t time;
+        std::memcpy(&time, value, sizeof(time));
+        sum += time;
+        ++count;
+    });
+    EXPECT_EQ(99, count);
+    EXPECT_EQ(99 * 1000 + 99 * 100 / 2 - 3, sum);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPScanPredicates) {
+    for (auto layout : { schema::Table::kRowStore, schema::Table::kPAX }) {
+        std::vector<schema::Table> tables {
+            schema::Table(
+                "events",
+                {
+                    schema::Column("e_id", schema::Type::Integer()),
+                    schema::Column("e_time", schema::Type::Timestamp()),
+                    schema::Column("e_kind", schema::Type::Char(4)),
+                    schema::Column("e_payload", schema::Type::Varchar(16)),
+                },
+                { "e_id" },
+                layout
+            ),
+        };
+        auto schema = std::make_unique<schema::Schema>(std::move(tables));
+        auto& table = schema->tables[0];
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment(123, buffer_manager);
+        schema_segment.set_schema(std::move(schema));
+        FSISegment fsi_segment(124, buffer_manager, schema_segment);
+        SPSegment sp_segment(125, buffer_manager, schema_segment, fsi_segment, &table);
+        const RecordCodec& codec = *sp_segment.get_codec();
+
+        std::vector<TID> tids;
+        for (int64_t i = 0; i < 300; ++i) {
+            Value kind = i % 3 == 0 ? Value(std::string("odd")) : Value(std::string("even"));
+            Value time = i % 10 == 0 ? Value() : Value(i * 10);
+            auto record = codec.encode({ i, time, kind, std::string("payload") });
+            auto tid = sp_segment.allocate(record.size());
+            sp_segment.write(tid, record.data(), record.size());
+            tids.push_back(tid);
+        }
+
+        using Predicate = moderndbs::Predicate;
+        auto range = sp_segment.scan({ Predicate::Between(1, 1000, 1999) });
+        // 100 values in range, minus the 10 NULLs
+        EXPECT_EQ(90, range.size());
+
+        auto conjunction = sp_segment.scan({
+            Predicate::Compare(0, Predicate::kLess, 30),
+            Predicate::Equal(2, "odd"),
+        });
+        ASSERT_EQ(10, conjunction.size());
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_EQ(tids[i * 3].value, conjunction[i].value);
+        }
+
+        // A constant longer than the char column equals no value, even if its prefix does
+        EXPECT_EQ(200, sp_segment.scan({ Predicate::Equal(2, "even") }).size());
+        EXPECT_EQ(0, sp_segment.scan({ Predicate::Equal(2, "evenX") }).size());
+        EXPECT_EQ(300, sp_segment.scan({ Predicate::NotEqual(2, "evenX") }).size());
+
+        EXPECT_THROW(sp_segment.scan({ Predicate::Compare(2, Predicate::kLess, 0) }), std::invalid_argument);
+
+        // Records that are too short for a column hold NULL there (PAX pages always store the fixed-width columns)
+        if (layout == schema::Table::kRowStore) {
+            sp_segment.allocate(0);
+            std::vector<std::byte> short_record{ std::byte{0}, std::byte{0xFF}, std::byte{0xFF} };
+            auto short_tid = sp_segment.allocate(short_record.size());
+            sp_segment.write(short_tid, short_record.data(), short_record.size());
+            EXPECT_EQ(300, sp_segment.scan({ Predicate::Compare(0, Predicate::kGreaterEqual, INT64_MIN) }).size());
+            EXPECT_EQ(90, sp_segment.scan({ Predicate::Between(1, 1000, 1999) }).size());
+            EXPECT_EQ(200, sp_segment.scan({ Predicate::NotEqual(2, "odd") }).size());
+            size_t nulls = 0;
+            sp_segment.scan_column(0, [&](TID, const std::byte* value) {
+                nulls += value == nullptr;
+            });
+            EXPECT_EQ(2, nulls);
+        }
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPZoneMaps) {
+    for (auto layout : { schema::Table::kRowStore, schema::Table::kPAX }) {
+        std::vector<schema::Table> tables {
+            schema::Table(
+                "events",
+                {
+                    schema::Column("e_id", schema::Type::Integer()),
+                    schema::Column("e_time", schema::Type::Timestamp()),
+                    schema::Column("e_payload", schema::Type::Varchar(16)),
+                },
+                { "e_id" },
+                layout
+            ),
+        };
+        auto schema = std::make_unique<schema::Schema>(std::move(tables));
+        auto& table = schema->tables[0];
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment(126, buffer_manager);
+        schema_segment.set_schema(std::move(schema));
+        FSISegment fsi_segment(127, buffer_manager, schema_segment);
+        ZoneMapSegment zone_map_segment(128, buffer_manager, schema_segment, table);
+        SPSegment sp_segment(129, buffer_manager, schema_segment, fsi_segment, &table, &zone_map_segment);
+        const RecordCodec& codec = *sp_segment.get_codec();
+        EXPECT_EQ(128, schema_segment.get_segments(&table).zone_map_segment_id);
+        ASSERT_EQ(2, zone_map_segment.get_columns().size());
+
+        std::vector<TID> tids;
+        for (int64_t i = 0; i < 300; ++i) {
+            Value time = i % 10 == 0 ? Value() : Value(1000 + i);
+            auto record = codec.encode({ i, time, std::string("payload") });
+            auto tid = sp_segment.allocate(record.size());
+            sp_segment.write(tid, record.data(), record.size());
+            tids.push_back(tid);
+        }
+        ASSERT_GT(schema_segment.get_sp_count(), 2);
+
+        // The zones of the first page cover exactly its records
+        uint64_t first_page = tids[0].get_page();
+        int64_t last = 0;
+        while (last + 1 < 300 && tids[last + 1].get_page() == first_page) {
+            ++last;
+        }
+        auto [valid, zone] = zone_map_segment.get_zone(first_page, 1);
+        ASSERT_TRUE(valid);
+        EXPECT_EQ(1001, zone.min);
+        EXPECT_EQ(1000 + last - (last % 10 == 0 ? 1 : 0), zone.max);
+        EXPECT_EQ(last / 10 + 1, zone.null_count);
+        EXPECT_FALSE(zone_map_segment.get_zone(first_page, 2).first);
+
+        // Pages outside of the range are skipped, the result is unchanged
+        using Predicate = moderndbs::Predicate;
+        EXPECT_FALSE(zone_map_segment.may_match(first_page, { Predicate::Compare(1, Predicate::kGreater, 1200) }));
+        EXPECT_TRUE(zone_map_segment.may_match(first_page, { Predicate::Compare(1, Predicate::kLess, 1002) }));
+        EXPECT_EQ(90, sp_segment.scan({ Predicate::Between(1, 1200, 1299) }).size());
+        EXPECT_EQ(1, sp_segment.scan({ Predicate::Compare(0, Predicate::kEqual, 299) }).size());
+
+        // Updates widen the zones
+        auto record = codec.encode({ int64_t{0}, int64_t{5000}, std::string("payload") });
+        sp_segment.write(tids[0], record.data(), record.size());
+        EXPECT_TRUE(zone_map_segment.may_match(first_page, { Predicate::Compare(1, Predicate::kGreater, 1200) }));
+        auto updated = sp_segment.scan({ Predicate::Compare(1, Predicate::kGreater, 4000) });
+        ASSERT_EQ(1, updated.size());
+        EXPECT_EQ(tids[0].value, updated[0].value);
+
+        // Pages without values are skipped
+        for (int64_t i = 0; i <= last; ++i) {
+            sp_segment.erase(tids[i]);
+        }
+        EXPECT_FALSE(zone_map_segment.may_match(first_page, { Predicate::Compare(1, Predicate::kLess, 10000) }));
+        EXPECT_EQ(0, sp_segment.scan({ Predicate::Compare(1, Predicate::kLess, 1002) }).size());
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPRedirectReturnsHome) {
+    for (uint16_t segment_id = 173; segment_id <= 175; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(173, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+    FSISegment fsi_segment(174, buffer_manager, schema_segment);
+    SPSegment sp_segment(175, buffer_manager, schema_segment, fsi_segment);
+
+    // Fill the first page
+    std::vector<TID> tids;
+    for (int i = 0; i < 20; ++i) {
+        tids.push_back(sp_segment.allocate(42));
+        ASSERT_EQ(0, tids.back().get_page());
+    }
+    std::vector<char> buffer(300, 0x00);
+    std::vector<char> record(42, 0x2A);
+    sp_segment.write(tids[0], reinterpret_cast<std::byte*>(record.data()), 42);
+
+    // Growing records leave their page once, growing them further keeps a single redirect
+    sp_segment.resize(tids[0], 200);
+    EXPECT_EQ(1, sp_segment.get_redirect_statistics().moved_records);
+    EXPECT_EQ(1, sp_segment.count_redirected_records());
+    sp_segment.resize(tids[0], 300);
+    EXPECT_EQ(1, sp_segment.get_redirect_statistics().moved_records);
+    EXPECT_EQ(1, sp_segment.count_redirected_records());
+    EXPECT_EQ(300, sp_segment.read(tids[0], reinterpret_cast<std::byte*>(buffer.data()), 300));
+    EXPECT_TRUE(std::equal(record.begin(), record.end(), buffer.begin()));
+    EXPECT_EQ(2, sp_segment.get_redirect_statistics().redirected_accesses);
+
+    // Once the first page has room again, the next write moves the record back
+    for (int i = 1; i < 9; ++i) {
+        sp_segment.erase(tids[i]);
+    }
+    sp_segment.write(tids[0], reinterpret_cast<std::byte*>(record.data()), 42);
+    auto statistics = sp_segment.get_redirect_statistics();
+    EXPECT_EQ(1, statistics.returned_records);
+    EXPECT_EQ(3, statistics.redirected_accesses);
+    EXPECT_EQ(0, sp_segment.count_redirected_records());
+    std::fill(buffer.begin(), buffer.end(), 0x00);
+    EXPECT_EQ(300, sp_segment.read(tids[0], reinterpret_cast<std::byte*>(buffer.data()), 300));
+    EXPECT_TRUE(std::equal(record.begin(), record.end(), buffer.begin()));
+    EXPECT_EQ(3, sp_segment.get_redirect_statistics().redirected_accesses);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPVacuum) {
+    for (uint16_t segment_id = 176; segment_id <= 178; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(1024, 100);
+    SchemaSegment schema_segment(176, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+    FSISegment fsi_segment(177, buffer_manager, schema_segment);
+    SPSegment sp_segment(178, buffer_manager, schema_segment, fsi_segment);
+    auto read_key = [&](TID tid) {
+        uint64_t key = 0;
+        sp_segment.read(tid, reinterpret_cast<std::byte*>(&key), sizeof(uint64_t));
+        return key;
+    };
+
+    // Every tenth record grows and moves to the end of the segment, the others are erased
+    std::vector<TID> tids;
+    for (uint64_t key = 0; key < 200; ++key) {
+        tids.push_back(sp_segment.allocate(42));
+        sp_segment.write(tids.back(), reinterpret_cast<std::byte*>(&key), sizeof(uint64_t));
+    }
+    auto home_pages = schema_segment.get_sp_count();
+    for (uint64_t key = 0; key < 200; key += 10) {
+        sp_segment.resize(tids[key], 300);
+    }
+    auto page_count = schema_segment.get_sp_count();
+    EXPECT_LT(home_pages, page_count);
+    for (uint64_t key = 0; key < 200; ++key) {
+        if (key % 10 != 0) {
+            sp_segment.erase(tids[key]);
+        }
+    }
+    EXPECT_EQ(20, sp_segment.count_redirected_records());
+
+    // The vacuum moves the records back and removes the empty pages at the end
+    auto statistics = sp_segment.vacuum(2 * page_count);
+    EXPECT_EQ(2 * page_count, statistics.visited_pages);
+    EXPECT_EQ(20, statistics.moved_records);
+    EXPECT_EQ(page_count - home_pages, statistics.truncated_pages);
+    EXPECT_EQ(home_pages, schema_segment.get_sp_count());
+    EXPECT_EQ(0, sp_segment.count_redirected_records());
+    EXPECT_GE(home_pages * 1024, moderndbs::File::open_file("178", moderndbs::File::READ)->size());
+    for (uint64_t key = 0; key < 200; key += 10) {
+        ASSERT_EQ(key, read_key(tids[key]));
+    }
+
+    // The background vacuum runs while the records keep changing
+    {
+        moderndbs::Vacuum vacuum(sp_segment, 4, std::chrono::milliseconds(1));
+        std::vector<std::thread> threads;
+        for (uint64_t t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937_64 engine{t};
+                for (int i = 0; i < 500; ++i) {
+                    auto key = (engine() % 20) * 10;
+                    if (key % 40 == t * 10) {
+                        sp_segment.resize(tids[key], 8 + engine() % 800);
+                    }
+                    ASSERT_EQ(key, read_key(tids[key]));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    for (uint64_t key = 0; key < 200; key += 10) {
+        ASSERT_EQ(key, read_key(tids[key]));
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPVacuumForwarding) {
+    for (uint16_t segment_id = 210; segment_id <= 213; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    std::vector<TID> tids;
+    std::vector<uint64_t> kept;
+    auto check_keys = [&](SPSegment& sp_segment) {
+        for (auto key : kept) {
+            uint64_t value = 0;
+            ASSERT_EQ(8, sp_segment.read(tids[key], reinterpret_cast<std::byte*>(&value), sizeof(uint64_t)));
+            ASSERT_EQ(key, value);
+        }
+        std::vector<TID> probe;
+        for (auto key : kept) {
+            probe.push_back(tids[key]);
+        }
+        std::vector<std::byte> records(probe.size() * 8);
+        std::vector<uint32_t> sizes(probe.size());
+        sp_segment.read_batch(probe.data(), probe.size(), records.data(), 8, sizes.data());
+        for (size_t i = 0; i < kept.size(); ++i) {
+            uint64_t value = 0;
+            std::memcpy(&value, records.data() + i * 8, sizeof(uint64_t));
+            ASSERT_EQ(8, sizes[i]);
+            ASSERT_EQ(kept[i], value);
+        }
+    };
+
+    uint64_t page_count = 0;
+    {
+        BufferManager buffer_manager(1024, 100);
+        SchemaSegment schema_segment(210, buffer_manager);
+        schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+        FSISegment fsi_segment(211, buffer_manager, schema_segment);
+        WALSegment wal(213, buffer_manager);
+        SPSegment sp_segment(212, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+
+        // Nine out of ten records are erased, none of them grows
+        for (uint64_t key = 0; key < 1000; ++key) {
+            tids.push_back(sp_segment.allocate(42));
+            sp_segment.write(tids.back(), reinterpret_cast<std::byte*>(&key), sizeof(uint64_t));
+        }
+        page_count = schema_segment.get_sp_count();
+        for (uint64_t key = 0; key < 1000; ++key) {
+            if (key % 10 != 0) {
+                sp_segment.erase(tids[key]);
+            } else {
+                kept.push_back(key);
+            }
+        }
+        EXPECT_EQ(0, sp_segment.count_redirected_records());
+
+        // The vacuum forwards the records of the sparse pages at the end and removes these pages
+        auto statistics = sp_segment.vacuum(2 * page_count);
+        EXPECT_LT(0, statistics.forwarded_records);
+        EXPECT_LT(0, statistics.truncated_pages);
+        auto sp_count = schema_segment.get_sp_count();
+        EXPECT_GE(page_count / 4, sp_count);
+        EXPECT_GE(sp_count * 1024, moderndbs::File::open_file("212", moderndbs::File::READ)->size());
+        EXPECT_LT(0, sp_segment.count_redirected_records());
+        check_keys(sp_segment);
+
+        // An aborted transaction leaves the forwarded records as they were
+        wal.begin();
+        sp_segment.erase(tids[990]);
+        sp_segment.resize(tids[980], 300);
+        uint64_t other = 7;
+        sp_segment.write(tids[970], reinterpret_cast<std::byte*>(&other), sizeof(uint64_t));
+        wal.abort();
+        check_keys(sp_segment);
+
+        // Forwarded records can still be erased and grow
+        sp_segment.erase(tids[990]);
+        kept.pop_back();
+        sp_segment.resize(tids[980], 300);
+        sp_segment.resize(tids[980], 42);
+        check_keys(sp_segment);
+    }
+
+    // The forwarded records are found again after a restart, and the pages at the end are created again without
+    // handing out their TIDs twice
+    {
+        BufferManager buffer_manager(1024, 100);
+        SchemaSegment schema_segment(210, buffer_manager);
+        schema_segment.read();
+        FSISegment fsi_segment(211, buffer_manager, schema_segment);
+        WALSegment wal(213, buffer_manager);
+        SPSegment sp_segment(212, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+        wal.recover();
+        check_keys(sp_segment);
+
+        for (uint64_t key = 1000; key < 2000; ++key) {
+            tids.push_back(sp_segment.allocate(42));
+            sp_segment.write(tids.back(), reinterpret_cast<std::byte*>(&key), sizeof(uint64_t));
+            kept.push_back(key);
+        }
+        EXPECT_LE(page_count, schema_segment.get_sp_count());
+        std::vector<uint64_t> values;
+        for (auto key : kept) {
+            values.push_back(tids[key].value);
+        }
+        std::sort(values.begin(), values.end());
+        EXPECT_EQ(values.end(), std::adjacent_find(values.begin(), values.end()));
+        check_keys(sp_segment);
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPInlineRecords) {
+    for (uint16_t segment_id = 179; segment_id <= 181; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(179, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+    FSISegment fsi_segment(180, buffer_manager, schema_segment);
+    SPSegment sp_segment(181, buffer_manager, schema_segment, fsi_segment);
+
+    // Records of up to seven bytes only occupy their slot, so 120 of them fit on a page
+    std::vector<TID> tids;
+    for (uint32_t i = 0; i < 120; ++i) {
+        tids.push_back(sp_segment.allocate(4));
+        ASSERT_EQ(0, tids.back().get_page());
+        sp_segment.write(tids.back(), reinterpret_cast<std::byte*>(&i), 4);
+    }
+    for (uint32_t i = 0; i < 120; ++i) {
+        uint32_t value = 0;
+        ASSERT_EQ(4, sp_segment.read(tids[i], reinterpret_cast<std::byte*>(&value), 4));
+        ASSERT_EQ(i, value);
+    }
+
+    // Records keep their data when they grow out of their slot and shrink into it again
+    std::vector<char> record(7, 0x11);
+    sp_segment.resize(tids[5], 7);
+    sp_segment.write(tids[5], reinterpret_cast<std::byte*>(record.data()), 7);
+    sp_segment.resize(tids[5], 20);
+    std::vector<char> buffer(20, 0x00);
+    EXPECT_EQ(20, sp_segment.read(tids[5], reinterpret_cast<std::byte*>(buffer.data()), 20));
+    EXPECT_TRUE(std::equal(record.begin(), record.end(), buffer.begin()));
+    sp_segment.resize(tids[5], 3);
+    std::fill(buffer.begin(), buffer.end(), 0x00);
+    EXPECT_EQ(3, sp_segment.read(tids[5], reinterpret_cast<std::byte*>(buffer.data()), 20));
+    EXPECT_TRUE(std::equal(record.begin(), record.begin() + 3, buffer.begin()));
+
+    // Erased inline records free their slot
+    sp_segment.erase(tids[7]);
+    auto tid = sp_segment.allocate(6);
+    EXPECT_EQ(tids[7].value, tid.value);
+    for (uint32_t i = 8; i < 120; ++i) {
+        uint32_t value = 0;
+        sp_segment.read(tids[i], reinterpret_cast<std::byte*>(&value), 4);
+        ASSERT_EQ(i, value);
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPFixedWidthRecords) {
+    for (uint16_t segment_id = 182; segment_id <= 184; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    std::vector<schema::Table> tables {
+        schema::Table(
+            "readings",
+            {
+                schema::Column("r_id", schema::Type::Integer()),
+                schema::Column("r_value", schema::Type::Integer()),
+                schema::Column("r_unit", schema::Type::Char(4)),
+            },
+            { "r_id" }
+        ),
+    };
+    auto schema = std::make_unique<schema::Schema>(std::move(tables));
+    auto& table = schema->tables[0];
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(182, buffer_manager);
+    schema_segment.set_schema(std::move(schema));
+    FSISegment fsi_segment(183, buffer_manager, schema_segment);
+    SPSegment sp_segment(184, buffer_manager, schema_segment, fsi_segment, &table);
+    const RecordCodec& codec = *sp_segment.get_codec();
+    ASSERT_EQ(SPSegment::kFixed, sp_segment.get_page_format());
+
+    // Without slots, more records fit on the first page than on a slotted page
+    uint32_t record_size = codec.get_fixed_size();
+    uint32_t slotted_capacity = (1024 - sizeof(SlottedPage)) / (record_size + sizeof(SlottedPage::Slot));
+    std::vector<TID> tids;
+    for (int64_t i = 0; i < 300; ++i) {
+        auto record = codec.encode({ i, i * 10, std::string(i % 2 == 0 ? "mm" : "kg") });
+        ASSERT_EQ(record_size, record.size());
+        auto tid = sp_segment.allocate(record.size());
+        sp_segment.write(tid, record.data(), record.size());
+        tids.push_back(tid);
+    }
+    uint32_t first_page = std::count_if(tids.begin(), tids.end(), [](TID tid) { return tid.get_page() == 0; });
+    EXPECT_GT(first_page, slotted_capacity);
+    for (int64_t i = 0; i < 300; ++i) {
+        std::vector<std::byte> record(record_size);
+        ASSERT_EQ(record_size, sp_segment.read(tids[i], record.data(), record_size));
+        EXPECT_EQ(Value(i * 10), codec.decode(record.data())[1]);
+    }
+
+    // Erased slots are not scanned, and the free slots of the insert page are reused
+    sp_segment.erase(tids[3]);
+    sp_segment.erase(tids[295]);
+    sp_segment.erase(tids[297]);
+    EXPECT_EQ(tids[295].value, sp_segment.allocate(record_size).value);
+    EXPECT_EQ(tids[297].value, sp_segment.allocate(record_size).value);
+    auto record = codec.encode({ int64_t{295}, int64_t{2950}, std::string("kg") });
+    sp_segment.write(tids[295], record.data(), record.size());
+    record = codec.encode({ int64_t{297}, int64_t{-1}, std::string("kg") });
+    sp_segment.write(tids[297], record.data(), record.size());
+
+    // Scans only see occupied slots
+    using Predicate = moderndbs::Predicate;
+    auto negative = sp_segment.scan({ Predicate::Compare(1, Predicate::kLess, 0) });
+    ASSERT_EQ(1, negative.size());
+    EXPECT_EQ(tids[297].value, negative[0].value);
+    EXPECT_EQ(150, sp_segment.scan({ Predicate::Equal(2, "mm") }).size());
+
+    // Records cannot grow
+    sp_segment.resize(tids[7], record_size);
+    EXPECT_THROW(sp_segment.resize(tids[7], record_size + 1), std::length_error);
+    EXPECT_THROW(sp_segment.allocate(record_size + 1), std::length_error);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPReadBatch) {
+    for (uint16_t segment_id = 185; segment_id <= 187; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(185, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+    FSISegment fsi_segment(186, buffer_manager, schema_segment);
+    SPSegment sp_segment(187, buffer_manager, schema_segment, fsi_segment);
+
+    // Records on several pages, every tenth of them grows and is redirected
+    std::vector<TID> tids;
+    for (uint32_t i = 0; i < 400; ++i) {
+        tids.push_back(sp_segment.allocate(16));
+        std::vector<uint32_t> record(4, i);
+        sp_segment.write(tids.back(), reinterpret_cast<std::byte*>(record.data()), 16);
+    }
+    for (uint32_t i = 0; i < 400; i += 10) {
+        sp_segment.resize(tids[i], 200);
+    }
+    ASSERT_GT(sp_segment.count_redirected_records(), 0);
+
+    // A probe in random order with duplicates reads the same as single reads
+    std::vector<TID> probe(tids.begin(), tids.end());
+    probe.insert(probe.end(), tids.begin(), tids.begin() + 50);
+    std::shuffle(probe.begin(), probe.end(), std::mt19937_64{0});
+    std::vector<std::byte> records(probe.size() * 32);
+    std::vector<uint32_t> sizes(probe.size());
+    sp_segment.read_batch(probe.data(), probe.size(), records.data(), 32, sizes.data());
+    for (size_t i = 0; i < probe.size(); ++i) {
+        std::vector<std::byte> record(32);
+        ASSERT_EQ(sp_segment.read(probe[i], record.data(), 32), sizes[i]);
+        ASSERT_TRUE(std::equal(record.begin(), record.begin() + sizes[i], records.begin() + i * 32));
+    }
+    uint32_t first;
+    std::memcpy(&first, records.data(), sizeof(first));
+    EXPECT_EQ(probe[0].value, tids[first].value);
+
+    sp_segment.read_batch(probe.data(), 0, records.data(), 32, sizes.data());
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPConcurrentReadersAndWriters) {
+    for (uint16_t segment_id = 170; segment_id <= 172; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(1024, 100);
+    SchemaSegment schema_segment(170, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+    FSISegment fsi_segment(171, buffer_manager, schema_segment);
+    SPSegment sp_segment(172, buffer_manager, schema_segment, fsi_segment);
+    constexpr uint64_t thread_count = 8;
+    constexpr uint64_t record_count = 500;
+
+    // Every thread writes and resizes its own records, which moves them between pages,
+    // while it reads the records of the other threads
+    std::vector<std::atomic<uint64_t>> tids(thread_count * record_count);
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 engine{t};
+            for (uint64_t i = 0; i < record_count; ++i) {
+                uint64_t key = t * record_count + i;
+                auto tid = sp_segment.allocate(sizeof(uint64_t));
+                sp_segment.write(tid, reinterpret_cast<std::byte*>(&key), sizeof(uint64_t));
+                tids[key].store(tid.value + 1);
+
+                auto own = t * record_count + engine() % (i + 1);
+                sp_segment.resize(TID(tids[own].load() - 1), sizeof(uint64_t) + engine() % 400);
+
+                auto other = engine() % tids.size();
+                auto other_tid = tids[other].load();
+                if (other_tid != 0) {
+                    uint64_t value = 0;
+                    sp_segment.read(TID(other_tid - 1), reinterpret_cast<std::byte*>(&value), sizeof(uint64_t));
+                    ASSERT_EQ(other, value);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (uint64_t key = 0; key < tids.size(); ++key) {
+        uint64_t value = 0;
+        sp_segment.read(TID(tids[key].load() - 1), reinterpret_cast<std::byte*>(&value), sizeof(uint64_t));
+        ASSERT_EQ(key, value);
+    }
+    for (uint64_t key = 0; key < tids.size(); key += 2) {
+        sp_segment.erase(TID(tids[key].load() - 1));
+    }
+    for (uint64_t key = 1; key < tids.size(); key += 2) {
+        uint64_t value = 0;
+        sp_segment.read(TID(tids[key].load() - 1), reinterpret_cast<std::byte*>(&value), sizeof(uint64_t));
+        ASSERT_EQ(key, value);
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPBloomFilter) {
+    for (uint16_t segment_id = 166; segment_id <= 169; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    std::vector<schema::Table> tables {
+        schema::Table(
+            "users",
+            {
+                schema::Column("u_name", schema::Type::Char(12)),
+                schema::Column("u_id", schema::Type::Integer()),
+            },
+            { "u_id", "u_name" }
+        ),
+    };
+    auto schema = std::make_unique<schema::Schema>(std::move(tables));
+    auto& table = schema->tables[0];
+    BufferManager buffer_manager(1024, 10);
+    SchemaSegment schema_segment(166, buffer_manager);
+    schema_segment.set_schema(std::move(schema));
+    FSISegment fsi_segment(167, buffer_manager, schema_segment);
+    constexpr int64_t key_count = 2000;
+    BloomFilterSegment bloom_filter(168, buffer_manager, schema_segment, table, key_count, 0.01);
+    SPSegment sp_segment(169, buffer_manager, schema_segment, fsi_segment, &table, nullptr, &bloom_filter);
+    const RecordCodec& codec = *sp_segment.get_codec();
+    EXPECT_EQ(168, schema_segment.get_segments(&table).bloom_filter_segment_id);
+    EXPECT_EQ(BloomFilterSegment::get_block_count(key_count, 0.01), bloom_filter.get_block_count());
+    EXPECT_THROW(BloomFilterSegment::get_block_count(key_count, 0), std::invalid_argument);
+
+    std::vector<TID> tids;
+    for (int64_t i = 0; i < key_count; ++i) {
+        auto record = codec.encode({ std::string("user"), i });
+        auto tid = sp_segment.allocate(record.size());
+        sp_segment.write(tid, record.data(), record.size());
+        tids.push_back(tid);
+    }
+
+    // There are no false negatives and about 1% false positives
+    for (int64_t i = 0; i < key_count; ++i) {
+        ASSERT_TRUE(sp_segment.may_contain({ i, std::string("user") }));
+    }
+    auto count_false_positives = [&] {
+        int64_t false_positives = 0;
+        for (int64_t i = key_count; i < 11 * key_count; ++i) {
+            false_positives += sp_segment.may_contain({ i, std::string("user") });
+        }
+        return false_positives;
+    };
+    EXPECT_LT(count_false_positives(), 10 * key_count / 50);
+
+    // Erased keys stay in the filter until the vacuum rebuilds it at the end of its pass
+    for (int64_t i = 0; i < key_count; i += 2) {
+        sp_segment.erase(tids[i]);
+    }
+    EXPECT_TRUE(sp_segment.may_contain({ int64_t{0}, std::string("user") }));
+    auto page_count = schema_segment.get_sp_count();
+    EXPECT_EQ(1, sp_segment.vacuum(page_count).rebuilt_filters);
+    EXPECT_EQ(0, sp_segment.vacuum(page_count).rebuilt_filters);
+    int64_t erased_positives = 0;
+    for (int64_t i = 0; i < key_count; ++i) {
+        if (i % 2 == 1) {
+            ASSERT_TRUE(sp_segment.may_contain({ i, std::string("user") }));
+        } else {
+            erased_positives += sp_segment.may_contain({ i, std::string("user") });
+        }
+    }
+    EXPECT_LT(erased_positives, key_count / 50);
+
+    // Lookups do not miss a key while the filter is rebuilt, not even the keys that are added meanwhile
+    int64_t misses = 0;
+    {
+        std::thread rebuild([&] {
+            for (int round = 0; round < 3; ++round) {
+                sp_segment.rebuild_bloom_filter();
+            }
+        });
+        for (int64_t i = 1; i < key_count; i += 2) {
+            auto record = codec.encode({ std::string("user"), key_count + i });
+            auto tid = sp_segment.allocate(record.size());
+            sp_segment.write(tid, record.data(), record.size());
+            misses += !sp_segment.may_contain({ i, std::string("user") });
+        }
+        rebuild.join();
+    }
+    EXPECT_EQ(0, misses);
+    for (int64_t i = 1; i < key_count; i += 2) {
+        ASSERT_TRUE(sp_segment.may_contain({ i, std::string("user") }));
+        ASSERT_TRUE(sp_segment.may_contain({ key_count + i, std::string("user") }));
+    }
+
+    // A short write keeps the trailing bytes of the record and with them its key, records without a key are skipped
+    std::vector<std::byte> short_record{ std::byte{0} };
+    sp_segment.write(tids[1], short_record.data(), static_cast<uint32_t>(short_record.size()));
+    sp_segment.allocate(0);
+    sp_segment.rebuild_bloom_filter();
+    EXPECT_TRUE(sp_segment.may_contain({ int64_t{1}, std::string("user") }));
+
+    // The SIMD probe matches the scalar one
+    std::mt19937_64 engine{0};
+    alignas(64) uint64_t block[BloomFilterSegment::kBlockWords];
+    for (int round = 0; round < 1000; ++round) {
+        for (auto& word : block) {
+            word = engine() | engine() | engine();
+        }
+        auto hash = static_cast<uint32_t>(engine());
+        auto bytes = reinterpret_cast<const std::byte*>(block);
+        ASSERT_EQ(BloomFilterSegment::block_contains_scalar(bytes, hash),
+                  BloomFilterSegment::block_contains(bytes, hash));
+    }
+
+    // The filter sets the same bits with every standard library, since it is stored on disk
+    std::remove("209");
+    {
+        BloomFilterSegment small_filter(209, buffer_manager, schema_segment, table, 1, 0.01);
+        ASSERT_EQ(1, small_filter.get_block_count());
+        std::string_view key = "moderndbs";
+        small_filter.add(reinterpret_cast<const std::byte*>(key.data()), static_cast<uint32_t>(key.size()));
+    }
+    std::array<uint64_t, BloomFilterSegment::kBlockWords> expected_words{};
+    std::array<unsigned, BloomFilterSegment::kBlockWords> bits{ 35, 26, 20, 39, 53, 56, 41, 9 };
+    for (size_t i = 0; i < bits.size(); ++i) {
+        expected_words[i] = uint64_t{1} << bits[i];
+    }
+    auto& page = buffer_manager.fix_page((uint64_t{209} << 48) | 1, false);
+    std::array<uint64_t, BloomFilterSegment::kBlockWords> words;
+    std::memcpy(words.data(), page.get_data(), sizeof(words));
+    buffer_manager.unfix_page(page, false);
+    EXPECT_EQ(expected_words, words);
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPWriteAheadLogRecovery) {
+    for (uint16_t segment_id = 188; segment_id <= 191; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    auto get_record = [](uint32_t value, uint32_t size) {
+        return std::vector<std::byte>(size, static_cast<std::byte>(value));
+    };
+    auto expect_record = [](SPSegment &sp_segment, TID tid, const std::vector<std::byte> &expected) {
+        std::vector<std::byte> record(400);
+        auto size = sp_segment.read(tid, record.data(), static_cast<uint32_t>(record.size()));
+        record.resize(size);
+        EXPECT_EQ(record, expected);
+    };
+
+    // The records are written cleanly first
+    std::vector<TID> tids;
+    {
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment(188, buffer_manager);
+        schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+        FSISegment fsi_segment(189, buffer_manager, schema_segment);
+        WALSegment wal(191, buffer_manager);
+        SPSegment sp_segment(190, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+        for (uint32_t i = 0; i < 300; ++i) {
+            tids.push_back(sp_segment.allocate(20));
+            auto record = get_record(i, 20);
+            sp_segment.write(tids.back(), record.data(), 20);
+        }
+    }
+
+    // A child process commits one transaction and crashes in the middle of another one, after a small buffer
+    // wrote some of its changes
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        try {
+            BufferManager buffer_manager(1024, 10);
+            SchemaSegment schema_segment(188, buffer_manager);
+            schema_segment.read();
+            FSISegment fsi_segment(189, buffer_manager, schema_segment);
+            WALSegment wal(191, buffer_manager);
+            SPSegment sp_segment(190, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+            wal.recover();
+
+            wal.begin();
+            for (uint32_t i = 0; i < 100; ++i) {
+                auto record = get_record(i + 1, 20);
+                sp_segment.write(tids[i], record.data(), 20);
+            }
+            for (uint32_t i = 100; i < 120; ++i) {
+                sp_segment.resize(tids[i], 300);
+                auto record = get_record(7, 300);
+                sp_segment.write(tids[i], record.data(), 300);
+            }
+            std::vector<TID> new_tids;
+            for (uint32_t i = 0; i < 50; ++i) {
+                new_tids.push_back(sp_segment.allocate(40));
+                auto record = get_record(3, 40);
+                sp_segment.write(new_tids.back(), record.data(), 40);
+            }
+            wal.commit();
+
+            wal.begin();
+            for (uint32_t i = 200; i < 220; ++i) {
+                sp_segment.erase(tids[i]);
+            }
+            for (uint32_t i = 220; i < 240; ++i) {
+                auto record = get_record(99, 20);
+                sp_segment.write(tids[i], record.data(), 20);
+            }
+            for (uint32_t i = 240; i < 260; ++i) {
+                sp_segment.resize(tids[i], 300);
+            }
+            for (uint32_t i = 0; i < 200; ++i) {
+                sp_segment.allocate(100);
+            }
+            auto size = new_tids.size() * sizeof(TID);
+            _exit(write(fds[1], new_tids.data(), size) == static_cast<ssize_t>(size) ? 0 : 1);
+        } catch (...) {
+            _exit(1);
+        }
+    }
+    close(fds[1]);
+    std::vector<TID> new_tids(50, TID(0));
+    ASSERT_EQ(read(fds[0], new_tids.data(), new_tids.size() * sizeof(TID)),
+              static_cast<ssize_t>(new_tids.size() * sizeof(TID)));
+    close(fds[0]);
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // Recovery redoes the committed transaction and undoes the other one
+    for (int run = 0; run < 2; ++run) {
+        BufferManager buffer_manager(1024, 10);
+        SchemaSegment schema_segment(188, buffer_manager);
+        schema_segment.read();
+        FSISegment fsi_segment(189, buffer_manager, schema_segment);
+        WALSegment wal(191, buffer_manager);
+        SPSegment sp_segment(190, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+        wal.recover();
+        auto statistics = wal.get_statistics();
+        if (run == 0) {
+            EXPECT_GT(statistics.redone_records, 0);
+            EXPECT_GT(statistics.undone_records, 0);
+        } else {
+            // Nothing is left to do the second time
+            EXPECT_EQ(statistics.undone_records, 0);
+        }
+
+        for (uint32_t i = 0; i < 100; ++i) {
+            expect_record(sp_segment, tids[i], get_record(i + 1, 20));
+        }
+        for (uint32_t i = 100; i < 120; ++i) {
+            expect_record(sp_segment, tids[i], get_record(7, 300));
+        }
+        for (uint32_t i = 120; i < 300; ++i) {
+            expect_record(sp_segment, tids[i], get_record(i, 20));
+        }
+        for (auto tid : new_tids) {
+            expect_record(sp_segment, tid, get_record(3, 40));
+        }
+        // Only the committed resizes may have left redirects
+        EXPECT_LE(sp_segment.count_redirected_records(), 20);
+
+        // The segment can be used again
+        auto tid = sp_segment.allocate(20);
+        sp_segment.erase(tid);
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPWriteAheadLogAbort) {
+    for (uint16_t segment_id = 192; segment_id <= 195; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(1024, 100);
+    SchemaSegment schema_segment(192, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{
+        schema::Table("t", std::vector<schema::Column>{
+            schema::Column("id", schema::Type::Integer()),
+            schema::Column("name", schema::Type::Varchar(100)),
+        }, std::vector<std::string>{ "id" }, schema::Table::kPAX),
+    }));
+    const auto &table = schema_segment.get_schema()->tables[0];
+    FSISegment fsi_segment(193, buffer_manager, schema_segment, FSISegment::kNextFit, FSISegment::kLinear, &table);
+    WALSegment wal(195, buffer_manager);
+    SPSegment sp_segment(194, buffer_manager, schema_segment, fsi_segment, &table, nullptr, nullptr, &wal);
+    const auto &codec = *sp_segment.get_codec();
+
+    std::vector<TID> tids;
+    std::vector<std::vector<std::byte>> records;
+    for (int64_t i = 0; i < 200; ++i) {
+        records.push_back(codec.encode({ i, std::string(10, 'a') }));
+        tids.push_back(sp_segment.allocate(static_cast<uint32_t>(records.back().size())));
+        sp_segment.write(tids.back(), records.back().data(), static_cast<uint32_t>(records.back().size()));
+    }
+
+    // Every kind of change is rolled back
+    wal.begin();
+    EXPECT_THROW(wal.begin(), std::logic_error);
+    for (int64_t i = 0; i < 20; ++i) {
+        sp_segment.erase(tids[i]);
+    }
+    for (int64_t i = 20; i < 60; ++i) {
+        auto record = codec.encode({ -i, std::string(100, 'b') });
+        sp_segment.resize(tids[i], static_cast<uint32_t>(record.size()));
+        sp_segment.write(tids[i], record.data(), static_cast<uint32_t>(record.size()));
+    }
+    for (int64_t i = 0; i < 50; ++i) {
+        sp_segment.allocate(50);
+    }
+    EXPECT_GT(sp_segment.count_redirected_records(), 0);
+    wal.abort();
+    EXPECT_THROW(wal.commit(), std::logic_error);
+    EXPECT_EQ(sp_segment.count_redirected_records(), 0);
+    for (size_t i = 0; i < tids.size(); ++i) {
+        std::vector<std::byte> record(200);
+        record.resize(sp_segment.read(tids[i], record.data(), static_cast<uint32_t>(record.size())));
+        EXPECT_EQ(record, records[i]);
+    }
+
+    // An operation that fails outside of a transaction leaves no changes behind
+    auto undone_records = wal.get_statistics().undone_records;
+    EXPECT_THROW(sp_segment.allocate(4096), std::length_error);
+    EXPECT_EQ(wal.get_statistics().undone_records, undone_records);
+    EXPECT_EQ(sp_segment.scan({}).size(), tids.size());
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPWriteAheadLogGroupCommit) {
+    for (uint16_t segment_id = 196; segment_id <= 199; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    BufferManager buffer_manager(1024, 100);
+    SchemaSegment schema_segment(196, buffer_manager);
+    schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+    FSISegment fsi_segment(197, buffer_manager, schema_segment);
+    WALSegment wal(199, buffer_manager);
+    SPSegment sp_segment(198, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+    constexpr uint64_t thread_count = 8;
+    constexpr uint64_t transaction_count = 50;
+
+    // Threads that commit at the same time share the writes of the log
+    std::vector<std::vector<TID>> tids(thread_count);
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            for (uint64_t i = 0; i < transaction_count; ++i) {
+                wal.begin();
+                tids[t].push_back(sp_segment.allocate(16));
+                std::vector<uint64_t> record{ t, i };
+                sp_segment.write(tids[t].back(), reinterpret_cast<std::byte*>(record.data()), 16);
+                wal.commit();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto statistics = wal.get_statistics();
+    EXPECT_EQ(statistics.commits, thread_count * transaction_count);
+    EXPECT_LT(statistics.flushes, statistics.commits);
+    for (uint64_t t = 0; t < thread_count; ++t) {
+        for (uint64_t i = 0; i < transaction_count; ++i) {
+            std::vector<uint64_t> record(2);
+            sp_segment.read(tids[t][i], reinterpret_cast<std::byte*>(record.data()), 16);
+            EXPECT_EQ(record, (std::vector<uint64_t>{ t, i }));
+        }
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, SPWriteAheadLogCheckpoint) {
+    for (uint16_t segment_id = 200; segment_id <= 203; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    auto get_record = [](uint32_t value) {
+        return std::vector<std::byte>(20, static_cast<std::byte>(value));
+    };
+    constexpr uint32_t kRecords = 1000;
+    constexpr uint32_t kThreads = 4;
+    constexpr uint32_t kRounds = 10;
+
+    std::vector<TID> tids;
+    {
+        BufferManager buffer_manager(1024, 32);
+        SchemaSegment schema_segment(200, buffer_manager);
+        schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+        FSISegment fsi_segment(201, buffer_manager, schema_segment);
+        WALSegment wal(203, buffer_manager);
+        SPSegment sp_segment(202, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+        for (uint32_t i = 0; i < kRecords; ++i) {
+            tids.push_back(sp_segment.allocate(20));
+            auto record = get_record(i);
+            sp_segment.write(tids.back(), record.data(), 20);
+        }
+    }
+
+    // A child process writes while checkpoints are taken in the background and crashes in a transaction
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        try {
+            BufferManager buffer_manager(1024, 32);
+            SchemaSegment schema_segment(200, buffer_manager);
+            schema_segment.read();
+            FSISegment fsi_segment(201, buffer_manager, schema_segment);
+            WALSegment wal(203, buffer_manager);
+            SPSegment sp_segment(202, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+            wal.recover();
+            Checkpointer checkpointer(wal, 16 << 10, std::chrono::milliseconds(5));
+
+            std::vector<std::thread> threads;
+            for (uint32_t t = 0; t < kThreads; ++t) {
+                threads.emplace_back([&, t] {
+                    for (uint32_t round = 1; round <= kRounds; ++round) {
+                        for (uint32_t i = t; i < kRecords; i += 10 * kThreads) {
+                            wal.begin();
+                            for (uint32_t j = i; j < std::min(i + 10 * kThreads, kRecords); j += kThreads) {
+                                auto record = get_record(j + round);
+                                sp_segment.write(tids[j], record.data(), 20);
+                            }
+                            wal.commit();
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            // Wait until a checkpoint is the last thing in the log
+            while (wal.get_checkpoint_distance() != 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            wal.begin();
+            for (uint32_t i = 0; i < 10; ++i) {
+                sp_segment.erase(tids[i]);
+            }
+            for (uint32_t i = 10; i < 20; ++i) {
+                auto record = get_record(99);
+                sp_segment.write(tids[i], record.data(), 20);
+            }
+            for (uint32_t i = 0; i < 50; ++i) {
+                sp_segment.allocate(20);
+            }
+            wal.flush(~0ull);
+            _exit(0);
+        } catch (...) {
+            _exit(1);
+        }
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // Recovery starts at the last checkpoint, long after most of the changes
+    for (int run = 0; run < 2; ++run) {
+        BufferManager buffer_manager(1024, 32);
+        SchemaSegment schema_segment(200, buffer_manager);
+        schema_segment.read();
+        FSISegment fsi_segment(201, buffer_manager, schema_segment);
+        WALSegment wal(203, buffer_manager);
+        SPSegment sp_segment(202, buffer_manager, schema_segment, fsi_segment, nullptr, nullptr, nullptr, &wal);
+        wal.recover();
+        auto statistics = wal.get_statistics();
+        EXPECT_LT(statistics.scanned_records, kRecords);
+        if (run == 0) {
+            EXPECT_GT(statistics.undone_records, 0);
+        } else {
+            EXPECT_EQ(statistics.undone_records, 0);
+        }
+
+        for (uint32_t i = 0; i < kRecords; ++i) {
+            std::vector<std::byte> record(20);
+            ASSERT_EQ(sp_segment.read(tids[i], record.data(), 20), 20);
+            EXPECT_EQ(record, get_record(i + kRounds));
+        }
+        // The free-space inventory and the page count survived, new records go behind the old ones
+        auto tid = sp_segment.allocate(20);
+        EXPECT_TRUE(std::none_of(tids.begin(), tids.end(), [&](TID old_tid) { return old_tid.value == tid.value; }));
+        sp_segment.erase(tid);
+        // A checkpoint after recovery leaves nothing to undo or redo
+        wal.checkpoint();
+    }
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, BufferIOWithoutDirectoryLatch) {
+    std::remove("208");
+    BufferManager buffer_manager(1024, 2);
+    std::atomic<bool> is_flushing = false;
+    std::atomic<bool> is_hit_done = false;
+    std::atomic<bool> was_hit_done = false;
+    buffer_manager.set_log([&](uint64_t) {
+        is_flushing = true;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!is_hit_done && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        was_hit_done = is_hit_done.load();
+    });
+    uint64_t first_page = uint64_t{208} << 48;
+    auto& dirty_page = buffer_manager.fix_page(first_page, true);
+    dirty_page.get_data()[0] = 42;
+    dirty_page.set_lsn(1);
+    buffer_manager.unfix_page(dirty_page, true);
+    buffer_manager.unfix_page(buffer_manager.fix_page(first_page + 1, false), false);
+
+    // A third page evicts the dirty page, whose write waits for the log
+    std::thread evicting([&] {
+        buffer_manager.unfix_page(buffer_manager.fix_page(first_page + 2, false), false);
+    });
+    while (!is_flushing) {
+        std::this_thread::yield();
+    }
+    // Other pages can be fixed meanwhile
+    buffer_manager.unfix_page(buffer_manager.fix_page(first_page + 1, false), false);
+    is_hit_done = true;
+    evicting.join();
+    EXPECT_TRUE(was_hit_done);
+    EXPECT_EQ(buffer_manager.get_fifo_list(), std::vector<uint64_t>{ first_page + 2 });
+    EXPECT_EQ(buffer_manager.get_lru_list(), std::vector<uint64_t>{ first_page + 1 });
+
+    // The page was written before it was evicted
+    auto& page = buffer_manager.fix_page(first_page, false);
+    EXPECT_EQ(page.get_data()[0], 42);
+    buffer_manager.unfix_page(page, false);
+    std::remove("208");
+}
+
+// NOLINTNEXTLINE
+TEST(SegmentTest, BufferWarmUp) {
+    for (uint16_t segment_id = 204; segment_id <= 207; ++segment_id) {
+        std::remove(std::to_string(segment_id).c_str());
+    }
+    auto get_record = [](uint32_t value) {
+        return std::vector<std::byte>(100, static_cast<std::byte>(value));
+    };
+
+    // The first records are hot, the others are evicted
+    std::vector<TID> tids;
+    {
+        BufferManager buffer_manager(1024, 64);
+        buffer_manager.warm_up(207);
+        buffer_manager.wait_for_warm_up();
+        EXPECT_EQ(buffer_manager.get_statistics().warmed_pages, 0);
+        SchemaSegment schema_segment(204, buffer_manager);
+        schema_segment.set_schema(std::make_unique<schema::Schema>(std::vector<schema::Table>{}));
+        FSISegment fsi_segment(205, buffer_manager, schema_segment);
+        SPSegment sp_segment(206, buffer_manager, schema_segment, fsi_segment);
+        for (uint32_t i = 0; i < 2000; ++i) {
+            tids.push_back(sp_segment.allocate(100));
+            auto record = get_record(i);
+            sp_segment.write(tids.back(), record.data(), 100);
+        }
+        std::vector<std::byte> record(100);
+        for (int round = 0; round < 3; ++round) {
+            for (uint32_t i = 0; i < 200; ++i) {
+                sp_segment.read(tids[i], record.data(), 100);
+            }
+        }
+    }
+
+    auto read_hot_records = [&](BufferManager &buffer_manager, uint32_t offset) {
+        SchemaSegment schema_segment(204, buffer_manager);
+        schema_segment.read();
+        FSISegment fsi_segment(205, buffer_manager, schema_segment);
+        SPSegment sp_segment(206, buffer_manager, schema_segment, fsi_segment);
+        std::vector<std::byte> record(100);
+        for (uint32_t i = 0; i < 200; ++i) {
+            ASSERT_EQ(sp_segment.read(tids[i], record.data(), 100), 100);
+            EXPECT_EQ(record, get_record(i + offset));
+        }
+    };
+
+    // A cold buffer reads every hot page
+    uint64_t cold_misses;
+    {
+        BufferManager buffer_manager(1024, 64);
+        read_hot_records(buffer_manager, 0);
+        cold_misses = buffer_manager.get_statistics().misses;
+        EXPECT_GE(cold_misses, 20);
+    }
+
+    // A warm buffer has the hot pages already
+    {
+        BufferManager buffer_manager(1024, 64);
+        buffer_manager.warm_up(207);
+        buffer_manager.wait_for_warm_up();
+        auto statistics = buffer_manager.get_statistics();
+        EXPECT_FALSE(statistics.is_warming_up);
+        EXPECT_GE(statistics.warmed_pages, cold_misses);
+        EXPECT_LE(statistics.warmed_pages, 64);
+        read_hot_records(buffer_manager, 0);
+        EXPECT_EQ(buffer_manager.get_statistics().misses, 0);
+    }
+
+    // Records that change during the warm-up keep their changes
+    {
+        BufferManager buffer_manager(1024, 64);
+        buffer_manager.warm_up(207);
+        {
+            SchemaSegment schema_segment(204, buffer_manager);
+            schema_segment.read();
+            FSISegment fsi_segment(205, buffer_manager, schema_segment);
+            SPSegment sp_segment(206, buffer_manager, schema_segment, fsi_segment);
+            for (uint32_t i = 0; i < 200; ++i) {
+                auto record = get_record(i + 1);
+                sp_segment.write(tids[i], record.data(), 100);
+            }
+        }
+        buffer_manager.wait_for_warm_up();
+        read_hot_records(buffer_manager, 1);
+    }
+    BufferManager buffer_manager(1024, 64);
+    read_hot_records(buffer_manager, 1);
+}
+
 }  // namespace